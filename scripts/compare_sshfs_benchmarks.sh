@@ -0,0 +1,29 @@
+#!/usr/bin/env bash
+# Compare two results.csv files written by run_sshfs_benchmarks.sh
+#
+# Usage: ./scripts/compare_sshfs_benchmarks.sh baseline.csv candidate.csv
+#
+# Positive p50/p99 changes are slower, positive MB/s changes are faster.
+
+set -euo pipefail
+
+if [ $# -ne 2 ]; then
+  echo "Usage: $0 baseline.csv candidate.csv"
+  exit 1
+fi
+
+DUCKDB="${DUCKDB:-./build/release/duckdb}"
+
+"$DUCKDB" <<EOF
+.mode box
+SELECT case_name,
+  old.p50_ms AS old_p50_ms, new.p50_ms AS new_p50_ms,
+  round((new.p50_ms - old.p50_ms) / old.p50_ms * 100, 1) AS p50_change_pct,
+  round((new.p99_ms - old.p99_ms) / old.p99_ms * 100, 1) AS p99_change_pct,
+  old.mb_per_s AS old_mb_per_s, new.mb_per_s AS new_mb_per_s,
+  round((new.mb_per_s - old.mb_per_s) / old.mb_per_s * 100, 1)
+    AS mb_per_s_change_pct
+FROM read_csv('$1') old
+FULL OUTER JOIN read_csv('$2') new USING (case_name)
+ORDER BY case_name;
+EOF
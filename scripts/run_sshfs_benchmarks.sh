@@ -0,0 +1,264 @@
+#!/usr/bin/env bash
+# Throughput and latency benchmarks of the read, write and metadata paths
+# against the docker test server.
+#
+# Usage:
+#   ./scripts/run_sshfs_test_server.sh
+#   BENCH_DELAY_MS=20 BENCH_RATE=200mbit ./scripts/run_sshfs_benchmarks.sh
+#
+# Every case runs in its own DuckDB process: one warm-up run (connects and
+# fills the server's page cache), then BENCH_RUNS timed runs with the block,
+# metadata and external file caches disabled so every run goes to the server.
+# Results are written to $BENCH_OUTPUT_DIR/results.csv - compare two builds
+# with ./scripts/compare_sshfs_benchmarks.sh old.csv new.csv
+#
+# Settings (environment variables):
+#   DUCKDB                     DuckDB CLI with sshfs (./build/release/duckdb)
+#   BENCH_OUTPUT_DIR           Where results go (build/benchmark)
+#   BENCH_FILTER               Only run cases matching this regex (.)
+#   BENCH_RUNS                 Timed runs per case (5)
+#   BENCH_SKIP_SETUP=1         Reuse the data uploaded by a previous run
+#   BENCH_SEQ_SIZES_KB         Whole-file read sizes ("64 1024 16384 262144")
+#   BENCH_RANDOM_READS         Random point lookups in a Parquet file (50)
+#   BENCH_POINT_ROWS           Rows of the point lookup file (1000000)
+#   BENCH_SCAN_ROWS            Rows of the Parquet scan file (5000000)
+#   BENCH_SCAN_THREADS         DuckDB threads for Parquet scans ("1 4 16")
+#   BENCH_UPLOAD_ROWS          Rows written per COPY upload (2000000)
+#   BENCH_CHUNK_SIZES_MB       sshfs_chunk_size_mb values ("8 32")
+#   BENCH_UPLOAD_CONCURRENCY   sshfs_max_concurrent_uploads values ("1 4")
+#   BENCH_GLOB_DIRS/FILES      Directories and files per directory (10/20)
+#   BENCH_DELAY_MS, BENCH_JITTER_MS, BENCH_RATE, BENCH_LOSS_PCT
+#                              Network conditions (see scripts/sshfs_netem.sh)
+
+set -euo pipefail
+
+DUCKDB="${DUCKDB:-./build/release/duckdb}"
+BENCH_OUTPUT_DIR="${BENCH_OUTPUT_DIR:-build/benchmark}"
+BENCH_FILTER="${BENCH_FILTER:-.}"
+BENCH_RUNS="${BENCH_RUNS:-5}"
+BENCH_SKIP_SETUP="${BENCH_SKIP_SETUP:-0}"
+BENCH_SEQ_SIZES_KB="${BENCH_SEQ_SIZES_KB:-64 1024 16384 262144}"
+BENCH_RANDOM_READS="${BENCH_RANDOM_READS:-50}"
+BENCH_POINT_ROWS="${BENCH_POINT_ROWS:-1000000}"
+BENCH_SCAN_ROWS="${BENCH_SCAN_ROWS:-5000000}"
+BENCH_SCAN_THREADS="${BENCH_SCAN_THREADS:-1 4 16}"
+BENCH_UPLOAD_ROWS="${BENCH_UPLOAD_ROWS:-2000000}"
+BENCH_CHUNK_SIZES_MB="${BENCH_CHUNK_SIZES_MB:-8 32}"
+BENCH_UPLOAD_CONCURRENCY="${BENCH_UPLOAD_CONCURRENCY:-1 4}"
+BENCH_GLOB_DIRS="${BENCH_GLOB_DIRS:-10}"
+BENCH_GLOB_FILES="${BENCH_GLOB_FILES:-20}"
+
+SSHFS_TEST_USERNAME="${SSHFS_TEST_USERNAME:-duckdb_sshfs_user}"
+SSHFS_TEST_PORT="${SSHFS_TEST_PORT:-2222}"
+HOST="${SSHFS_TEST_USERNAME}@localhost:${SSHFS_TEST_PORT}"
+BASE_URL="sshfs://${HOST}/upload/bench"
+
+if [ ! -x "$DUCKDB" ]; then
+  echo "DuckDB CLI not found at $DUCKDB. Run: make release"
+  exit 1
+fi
+if ! docker ps --format '{{.Names}}' | grep -q "duckdb-sshfs"; then
+  echo "SSHFS test server doesn't appear to be running."
+  echo "Run: ./scripts/run_sshfs_test_server.sh"
+  exit 1
+fi
+
+mkdir -p "$BENCH_OUTPUT_DIR"
+rm -f "$BENCH_OUTPUT_DIR"/*.runs.csv "$BENCH_OUTPUT_DIR"/*.stats.csv
+
+if [ -n "${BENCH_DELAY_MS:-}${BENCH_RATE:-}${BENCH_LOSS_PCT:-}" ]; then
+  ./scripts/sshfs_netem.sh apply
+  trap './scripts/sshfs_netem.sh clear' EXIT
+fi
+
+preamble() {
+  cat <<EOF
+LOAD sshfs;
+CREATE SECRET bench (
+    TYPE SSH,
+    USERNAME '${SSHFS_TEST_USERNAME}',
+    KEY_PATH 'scripts/test-ssh-key',
+    PORT ${SSHFS_TEST_PORT}
+);
+SET sshfs_block_cache_size_mb = 0;
+SET sshfs_metadata_cache_ttl_ms = 0;
+SET enable_external_file_cache = false;
+EOF
+}
+
+run_sql() {
+  local sql=$1 log=$2
+  if ! "$DUCKDB" -unsigned -bail <"$sql" >"$log" 2>&1; then
+    echo "Failed, see $log"
+    tail -5 "$log"
+    exit 1
+  fi
+}
+
+# Timed statements are bracketed by now(), which is the start time of each
+# autocommit transaction, so the timing covers exactly one statement.
+timed_run() {
+  local name=$1 run=$2 statement=$3
+  echo "CREATE OR REPLACE TEMP TABLE bench_mark AS SELECT now() AS started;"
+  echo "${statement};"
+  echo "INSERT INTO bench_runs SELECT '${name}', ${run}," \
+    "epoch_us(now()) - epoch_us(started) FROM bench_mark;"
+}
+
+save_results() {
+  local name=$1 file=$2
+  echo "COPY bench_runs TO '${BENCH_OUTPUT_DIR}/${file}.runs.csv';"
+  echo "COPY (SELECT '${name}' AS case_name, metric, value FROM sshfs_stats()" \
+    "WHERE host = '${HOST}') TO '${BENCH_OUTPUT_DIR}/${file}.stats.csv';"
+}
+
+# run_case NAME SETTINGS STATEMENT [RUNS]
+# @RUN@ and @ID@ (a random point lookup id) are replaced in STATEMENT
+run_case() {
+  local name=$1 settings=$2 statement=$3 runs=${4:-$BENCH_RUNS}
+  if [[ ! "$name" =~ $BENCH_FILTER ]]; then
+    return 0
+  fi
+  echo "Running $name ($runs runs)..."
+
+  local sql="$BENCH_OUTPUT_DIR/$name.sql"
+  {
+    preamble
+    echo "$settings"
+    echo "CREATE TEMP TABLE bench_runs (case_name VARCHAR, run INTEGER," \
+      "elapsed_us BIGINT);"
+    local warmup=${statement//@RUN@/0}
+    echo "${warmup//@ID@/0};"
+    echo "SELECT count(*) FROM sshfs_stats(reset := true);"
+    for run in $(seq 1 "$runs"); do
+      local id=$(((RANDOM * 32768 + RANDOM) % BENCH_POINT_ROWS))
+      local expanded=${statement//@RUN@/$run}
+      timed_run "$name" "$run" "${expanded//@ID@/$id}"
+    done
+    save_results "$name" "$name"
+  } >"$sql"
+  run_sql "$sql" "$BENCH_OUTPUT_DIR/$name.log"
+}
+
+# Connection setup needs a fresh process per run: handshake, authentication,
+# SFTP channel and the first read of a small file
+run_connect_case() {
+  local name=connect
+  if [[ ! "$name" =~ $BENCH_FILTER ]]; then
+    return 0
+  fi
+  echo "Running $name ($BENCH_RUNS runs)..."
+  for run in $(seq 1 "$BENCH_RUNS"); do
+    local sql="$BENCH_OUTPUT_DIR/$name.$run.sql"
+    {
+      preamble
+      echo "CREATE TEMP TABLE bench_runs (case_name VARCHAR, run INTEGER," \
+        "elapsed_us BIGINT);"
+      timed_run "$name" "$run" "CREATE OR REPLACE TEMP TABLE bench_sink AS
+SELECT octet_length(content) FROM read_blob('${BASE_URL}/seq_64kb.txt')"
+      save_results "$name" "$name.$run"
+    } >"$sql"
+    run_sql "$sql" "$BENCH_OUTPUT_DIR/$name.$run.log"
+  done
+}
+
+setup_data() {
+  echo "Uploading benchmark data to ${BASE_URL}..."
+  local sql="$BENCH_OUTPUT_DIR/setup.sql"
+  {
+    preamble
+    # 1 KB lines, read back whole with read_blob
+    for size in $BENCH_SEQ_SIZES_KB; do
+      echo "COPY (SELECT repeat('x', 1023) FROM range(${size})) TO" \
+        "'${BASE_URL}/seq_${size}kb.txt' (HEADER false, QUOTE '');"
+    done
+    # Sorted ids in small row groups: a lookup reads the footer and one chunk
+    echo "COPY (SELECT i AS id, i * 2 AS a, md5(i::VARCHAR) AS b" \
+      "FROM range(${BENCH_POINT_ROWS}) t(i)) TO '${BASE_URL}/points.parquet'" \
+      "(FORMAT parquet, ROW_GROUP_SIZE 8192);"
+    echo "COPY (SELECT i AS id, i * 2 AS a, random() AS b," \
+      "md5(i::VARCHAR) AS c FROM range(${BENCH_SCAN_ROWS}) t(i)) TO" \
+      "'${BASE_URL}/scan.parquet' (FORMAT parquet);"
+    for dir in $(seq 1 "$BENCH_GLOB_DIRS"); do
+      for file in $(seq 1 "$BENCH_GLOB_FILES"); do
+        echo "COPY (SELECT ${dir} AS dir, ${file} AS file, i FROM range(100)" \
+          "t(i)) TO '${BASE_URL}/glob/dir${dir}/file${file}.csv';"
+      done
+    done
+  } >"$sql"
+  run_sql "$sql" "$BENCH_OUTPUT_DIR/setup.log"
+}
+
+if [ "$BENCH_SKIP_SETUP" != "1" ]; then
+  setup_data
+fi
+
+run_connect_case
+
+for size in $BENCH_SEQ_SIZES_KB; do
+  run_case "seq_read_${size}kb" "" \
+    "CREATE OR REPLACE TEMP TABLE bench_sink AS SELECT octet_length(content)
+FROM read_blob('${BASE_URL}/seq_${size}kb.txt')"
+done
+
+run_case "random_read_parquet" "" \
+  "CREATE OR REPLACE TEMP TABLE bench_sink AS SELECT sum(a)
+FROM read_parquet('${BASE_URL}/points.parquet') WHERE id = @ID@" \
+  "$BENCH_RANDOM_READS"
+
+for threads in $BENCH_SCAN_THREADS; do
+  run_case "parquet_scan_${threads}_threads" "SET threads = ${threads};" \
+    "CREATE OR REPLACE TEMP TABLE bench_sink AS SELECT sum(a), sum(b), max(c)
+FROM read_parquet('${BASE_URL}/scan.parquet')"
+done
+
+for chunk in $BENCH_CHUNK_SIZES_MB; do
+  for uploads in $BENCH_UPLOAD_CONCURRENCY; do
+    run_case "upload_chunk_${chunk}mb_${uploads}_uploads" \
+      "SET sshfs_chunk_size_mb = ${chunk};
+SET sshfs_max_concurrent_uploads = ${uploads};" \
+      "COPY (SELECT i, md5(i::VARCHAR) AS b FROM range(${BENCH_UPLOAD_ROWS})
+t(i)) TO '${BASE_URL}/upload_@RUN@.csv'"
+  done
+done
+
+run_case "glob_list" "" \
+  "CREATE OR REPLACE TEMP TABLE bench_sink AS SELECT count(*)
+FROM glob('${BASE_URL}/glob/*/*.csv')"
+
+run_case "glob_scan" "" \
+  "CREATE OR REPLACE TEMP TABLE bench_sink AS SELECT count(*)
+FROM read_csv('${BASE_URL}/glob/*/*.csv')"
+
+# MB/s is the payload sent over SFTP during the timed runs, latency
+# percentiles are per statement (p50_ms, p99_ms) and per SFTP request
+"$DUCKDB" <<EOF
+COPY (
+  WITH runs AS (
+    SELECT * FROM read_csv('${BENCH_OUTPUT_DIR}/*.runs.csv')
+  ), stats AS (
+    SELECT case_name,
+      sum(value) FILTER (metric IN ('bytes_read', 'bytes_written')) AS bytes,
+      max(value) FILTER (metric IN ('read_latency_p50_us',
+                                    'write_latency_p50_us')) AS request_p50_us,
+      max(value) FILTER (metric IN ('read_latency_p99_us',
+                                    'write_latency_p99_us')) AS request_p99_us
+    FROM read_csv('${BENCH_OUTPUT_DIR}/*.stats.csv')
+    GROUP BY case_name
+  )
+  SELECT case_name, count(*) AS runs,
+    round(quantile_cont(elapsed_us, 0.5) / 1000, 2) AS p50_ms,
+    round(quantile_cont(elapsed_us, 0.99) / 1000, 2) AS p99_ms,
+    round(any_value(bytes) / 1048576 / (sum(elapsed_us) / 1e6), 1)
+      AS mb_per_s,
+    any_value(request_p50_us) AS request_p50_us,
+    any_value(request_p99_us) AS request_p99_us
+  FROM runs LEFT JOIN stats USING (case_name)
+  GROUP BY case_name
+  ORDER BY case_name
+) TO '${BENCH_OUTPUT_DIR}/results.csv';
+.mode box
+FROM '${BENCH_OUTPUT_DIR}/results.csv';
+EOF
+
+echo "Results written to ${BENCH_OUTPUT_DIR}/results.csv"
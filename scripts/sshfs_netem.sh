@@ -0,0 +1,75 @@
+#!/usr/bin/env bash
+# Inject latency, bandwidth limits and packet loss on the SSHFS test servers
+# with tc/netem, to benchmark under WAN-like conditions.
+#
+# Usage: ./scripts/sshfs_netem.sh apply|clear
+#
+#   BENCH_DELAY_MS=40     Delay added to every packet the servers send (RTT + 40ms)
+#   BENCH_JITTER_MS=5     Random variation of the delay
+#   BENCH_RATE=100mbit    Bandwidth limit of the servers' uplink (tc rate units)
+#   BENCH_LOSS_PCT=0.1    Packet loss in percent
+#
+# The rules are applied from a helper container sharing each server's network
+# namespace, so the server images do not need iproute2 or extra capabilities.
+
+set -euo pipefail
+
+action="${1:-}"
+services="sshfs sshfs_sftp_only"
+
+container_id() {
+  docker compose -f scripts/sshfs.yml -p duckdb-sshfs ps -q "$1"
+}
+
+run_tc() {
+  local container=$1
+  shift
+  docker run --rm --network "container:${container}" --cap-add NET_ADMIN \
+    alpine:latest sh -c "apk add --no-cache iproute2 >/dev/null && $*"
+}
+
+case "$action" in
+  apply)
+    netem=""
+    if [ -n "${BENCH_DELAY_MS:-}" ]; then
+      netem="$netem delay ${BENCH_DELAY_MS}ms"
+      if [ -n "${BENCH_JITTER_MS:-}" ]; then
+        netem="$netem ${BENCH_JITTER_MS}ms"
+      fi
+    fi
+    if [ -n "${BENCH_RATE:-}" ]; then
+      netem="$netem rate ${BENCH_RATE}"
+    fi
+    if [ -n "${BENCH_LOSS_PCT:-}" ]; then
+      netem="$netem loss ${BENCH_LOSS_PCT}%"
+    fi
+    if [ -z "$netem" ]; then
+      echo "Nothing to apply: set BENCH_DELAY_MS, BENCH_RATE or BENCH_LOSS_PCT"
+      exit 1
+    fi
+
+    for service in $services; do
+      container=$(container_id "$service")
+      if [ -z "$container" ]; then
+        echo "Service $service is not running. Run: ./scripts/run_sshfs_test_server.sh"
+        exit 1
+      fi
+      run_tc "$container" "tc qdisc replace dev eth0 root netem$netem"
+      echo "Applied netem$netem to $service"
+    done
+    ;;
+  clear)
+    for service in $services; do
+      container=$(container_id "$service")
+      if [ -n "$container" ]; then
+        # Fails harmlessly when no rule is installed
+        run_tc "$container" "tc qdisc del dev eth0 root 2>/dev/null || true"
+        echo "Cleared netem on $service"
+      fi
+    done
+    ;;
+  *)
+    echo "Usage: $0 apply|clear"
+    exit 1
+    ;;
+esac
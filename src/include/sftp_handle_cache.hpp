@@ -0,0 +1,69 @@
+#pragma once
+
+#include "duckdb.hpp"
+#include <libssh2.h>
+#include <libssh2_sftp.h>
+#include <list>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace duckdb {
+
+// Cache of open SFTP read handles for one SSH connection, keyed by remote
+// path. Keeping the handle open saves the open + close round trips that every
+// read used to pay, and preserves libssh2's read-ahead for sequential reads.
+//
+// Handles belong to the connection's SFTP channel, so Acquire/Release must be
+// called while that channel is borrowed (see SSHClient::BorrowSFTPSession).
+// Invalidate may be called from any thread - handles are closed lazily the
+// next time the channel is used.
+class SFTPHandleCache {
+public:
+  explicit SFTPHandleCache(size_t max_handles) : max_handles(max_handles) {}
+  ~SFTPHandleCache() = default;
+
+  // Non-copyable
+  SFTPHandleCache(const SFTPHandleCache &) = delete;
+  SFTPHandleCache &operator=(const SFTPHandleCache &) = delete;
+
+  // Return a cached handle (refcount + 1) or open a new one, evicting the
+  // least recently used idle handle when over capacity. Returns nullptr if
+  // the file cannot be opened (check libssh2_sftp_last_error). Sets *opened
+  // when the handle had to be opened.
+  LIBSSH2_SFTP_HANDLE *Acquire(LIBSSH2_SFTP *sftp, const std::string &path,
+                               bool *opened = nullptr);
+  // Drop the reference; discard=true closes the handle (e.g. after an error)
+  void Release(LIBSSH2_SFTP_HANDLE *handle, bool discard = false);
+
+  // Forget the handle for a path that was written, renamed or removed
+  void Invalidate(const std::string &path);
+  // Close every handle (before the SFTP channel is shut down)
+  void CloseAll();
+
+  void SetMaxHandles(size_t new_max_handles);
+  size_t Size();
+
+private:
+  struct Entry {
+    LIBSSH2_SFTP_HANDLE *handle = nullptr;
+    size_t refcount = 0;
+    std::list<std::string>::iterator lru_position;
+  };
+
+  size_t max_handles;
+  std::unordered_map<std::string, Entry> entries;
+  std::list<std::string> lru; // Front = most recently used
+  // Handles invalidated while in use - closed on their last Release
+  std::unordered_map<LIBSSH2_SFTP_HANDLE *, size_t> detached;
+  // Handles invalidated from another thread - closed on next Acquire
+  std::vector<LIBSSH2_SFTP_HANDLE *> pending_close;
+  std::mutex mutex;
+
+  // Caller must hold mutex; evicted handles are appended to to_close
+  void EvictIdle(std::vector<LIBSSH2_SFTP_HANDLE *> &to_close);
+  static void CloseHandles(const std::vector<LIBSSH2_SFTP_HANDLE *> &handles);
+};
+
+} // namespace duckdb
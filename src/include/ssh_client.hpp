@@ -1,16 +1,39 @@
 #pragma once
 
 #include "duckdb.hpp"
+#include "sftp_handle_cache.hpp"
+#include "sshfs_stats.hpp"
+#include <atomic>
+#include <chrono>
 #include <condition_variable>
+#include <cstdint>
+#include <functional>
 #include <libssh2.h>
 #include <libssh2_sftp.h>
 #include <memory>
 #include <mutex>
 #include <queue>
 #include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
 
 namespace duckdb {
 
+// How reads of remote files are served (sshfs_read_backend)
+enum class SSHReadBackend {
+  SFTP, // SFTP read requests
+  DD,   // dd over parallel exec channels, SFTP if the server can't run it
+  AUTO  // dd for large reads on command-capable hosts, SFTP otherwise
+};
+
+// Compression of transfers (sshfs_compression)
+enum class SSHCompression {
+  NONE,
+  SSH, // zlib compression of the SSH transport (all SFTP and exec traffic)
+  GZIP // dd reads streamed through `gzip -c` on the server
+};
+
 struct SSHConnectionParams {
   std::string hostname;
   int port = 22;
@@ -28,16 +51,146 @@ struct SSHConnectionParams {
   // Crypto policy
   bool strict_crypto = false; // Restrict to non-NIST algorithms only
 
+  SSHCompression compression = SSHCompression::NONE;
+
+  // Cipher and MAC order: "default" (libssh2's), "throughput" (AEAD ciphers
+  // first, AES-GCM or chacha20-poly1305 by local speed), "compat" (CTR and
+  // CBC modes for old servers) or an explicit comma-separated cipher list
+  std::string cipher_preference = "default";
+
   // Connection tuning
   int timeout_seconds = 300; // 5 minutes for long uploads
   int max_retries = 3;       // Maximum connection retry attempts
   int initial_retry_delay_ms =
       1000; // Initial delay between retries (exponential backoff)
   int keepalive_interval = 60; // Send keepalive every 60 seconds (0 = disabled)
+  int idle_timeout_seconds = 0;  // Close connections unused this long (0 = never)
+  int max_connection_lifetime_seconds = 0; // Reconnect after this (0 = never)
+  size_t max_sessions = 1; // Independent SSH connections per host (1 = Hetzner
+                           // safe, higher values parallelize reads)
+  size_t multiplex_channels = 0; // Concurrent reads as channels of one
+                                 // leased session (0 = one read per lease)
+  size_t max_connections = 0; // Secret's MAX_CONNECTIONS: all connections to
+                              // the host (0 = sshfs_max_sessions decides)
+  size_t max_open_handles = 64; // Cached SFTP read handles per connection
+
+  // Transport tuning for high bandwidth-delay links. channel_window_size is
+  // the receive window of the channels we open (0 = sized from the measured
+  // round trip time), socket_buffer_size sets SO_SNDBUF/SO_RCVBUF (0 = OS
+  // autotuning)
+  size_t channel_window_size = 0;
+  size_t socket_buffer_size = 0;
+  bool tcp_nodelay = true;
+  uint64_t metadata_cache_ttl_ms = 10000; // Shared stat cache (0 = disabled)
 
   // Upload performance tuning
   size_t chunk_size = 50 * 1024 * 1024; // 50MB default chunk size
   size_t max_concurrent_uploads = 2;    // Conservative for SFTP
+  size_t upload_threads = 8;            // Uploads running at once (all hosts)
+  size_t max_host_uploads = 4;          // Uploads running at once per host
+  size_t upload_memory_limit = 1024 * 1024 * 1024; // Buffers of all files
+  // Stage chunks in mapped temp files under upload_spill_directory (DuckDB's
+  // temp_directory) instead of heap memory
+  bool upload_spill = false;
+  std::string upload_spill_directory;
+  bool atomic_uploads = false; // Upload to a temp file, rename on close
+  bool verify_uploads = false; // Compare chunk sha256 with the server's
+  // Testing (SSHFS_TESTING builds only): the first attempt of every Nth
+  // chunk upload writes corrupted data (0 = disabled)
+  size_t upload_fault_interval = 0;
+
+  // Read backend: dd reads are split into ranges streamed over up to
+  // dd_channels exec channels at once
+  SSHReadBackend read_backend = SSHReadBackend::SFTP;
+  size_t dd_channels = 4;
+
+  // Read pipelining: bytes of SFTP READ requests kept in flight per handle.
+  // libssh2 picks the packet size (at most ~30000 bytes) itself.
+  size_t read_window = 2 * 1024 * 1024;
+  // Concurrent reads of a file closer than this are merged (0 = disabled)
+  size_t read_coalesce_gap = 0;
+
+  // Block cache: reads go through fixed size blocks kept in a shared memory
+  // budget (0 = disabled); sequential scans prefetch readahead_blocks ahead
+  size_t block_cache_size = 256 * 1024 * 1024;
+  size_t block_size = 1024 * 1024;
+  size_t readahead_blocks = 4;
+
+  // Persistent disk cache shared across DuckDB processes (empty = disabled)
+  std::string cache_directory;
+  size_t cache_max_size = 10ULL * 1024 * 1024 * 1024;
+};
+
+// One directory entry with the attributes returned by the server
+struct SFTPDirEntry {
+  std::string name; // File name (relative path for FindFiles)
+  LIBSSH2_SFTP_ATTRIBUTES attrs;
+
+  bool IsDirectory() const {
+    return (attrs.flags & LIBSSH2_SFTP_ATTR_PERMISSIONS) &&
+           LIBSSH2_SFTP_S_ISDIR(attrs.permissions);
+  }
+  bool IsRegularFile() const {
+    return (attrs.flags & LIBSSH2_SFTP_ATTR_PERMISSIONS) &&
+           LIBSSH2_SFTP_S_ISREG(attrs.permissions);
+  }
+};
+
+// What earlier connections learned about a server, shared by every client of
+// the same user@host:port so later connects skip the probing
+struct SSHServerProfile {
+  bool capabilities_known = false;
+  bool supports_commands = false;
+  // Public key blob of the agent identity that authenticated last time
+  std::string agent_identity;
+};
+
+class GzipStreamDecoder;
+
+// Pull-based reader over the output of a remote command. The channel is read
+// in blocks of BUFFER_SIZE as the caller asks for data, so memory stays
+// bounded whatever the command prints and processing overlaps the transfer.
+// With gzip the output (e.g. of `... | gzip -c`) is inflated as it is read.
+// Created by SSHClient::OpenExecStream; the caller holds the client's
+// borrowed SFTP session until the stream is destroyed.
+class SSHExecStream {
+public:
+  static constexpr size_t BUFFER_SIZE = 64 * 1024;
+
+  ~SSHExecStream();
+
+  // Non-copyable
+  SSHExecStream(const SSHExecStream &) = delete;
+  SSHExecStream &operator=(const SSHExecStream &) = delete;
+
+  // Read up to size bytes. Returns 0 at the end of the output.
+  size_t Read(char *out, size_t size);
+  // Next line without the newline. Returns false at the end of the output.
+  bool ReadLine(std::string &line);
+  // Discard unread output, wait for the command to exit and return its exit
+  // status
+  int Finish();
+
+private:
+  friend class SSHClient;
+  SSHExecStream(LIBSSH2_CHANNEL *channel, bool gzip);
+
+  // Refill the buffer. Returns false at the end of the output.
+  bool Fill();
+  size_t ReadChannel(char *out, size_t size);
+
+  LIBSSH2_CHANNEL *channel;
+  std::vector<char> buffer;
+  size_t buffer_pos = 0;
+  size_t buffer_end = 0;
+  bool eof = false;
+  bool finished = false;
+  int exit_status = -1;
+  // Compressed input not inflated yet (gzip only)
+  std::unique_ptr<GzipStreamDecoder> decoder;
+  std::vector<char> compressed;
+  size_t compressed_pos = 0;
+  size_t compressed_end = 0;
 };
 
 class SSHClient {
@@ -45,12 +198,33 @@ public:
   explicit SSHClient(const SSHConnectionParams &params);
   ~SSHClient();
 
-  // Connection management
+  // Connection management (Connect is safe to call from several threads)
   void Connect();
   void Disconnect();
+  // Disconnect unless a caller is inside an operation or connecting right
+  // now, for clients used without a lease. Returns whether it disconnected.
+  bool DisconnectIfIdle();
   bool IsConnected() const { return connected; }
+  // Whether the host's MAX_CONNECTIONS leaves room for another connection
+  // (always true without MAX_CONNECTIONS)
+  bool HasConnectionSlot() const;
   bool ValidateConnection();
+  // Whether the server closed the TCP connection (local check, no round
+  // trip - ValidateConnection is the thorough one)
+  bool IsSocketClosed() const;
   LIBSSH2_SESSION *GetSession() const { return session; }
+  int GetSocket() const { return sock; }
+  // Receive window used for channels of this connection (after Connect)
+  uint32_t GetChannelWindow() const { return channel_window; }
+  // Grow the receive window of a freshly opened SFTP channel to
+  // GetChannelWindow() (libssh2 opens them with its 2MB default)
+  void TuneSFTPWindow(LIBSSH2_SFTP *sftp);
+
+  // Lifecycle bookkeeping for the maintenance thread (sshfs_idle_timeout_
+  // seconds, sshfs_max_connection_lifetime_seconds)
+  void Touch();
+  std::chrono::steady_clock::duration GetIdleTime() const;
+  std::chrono::steady_clock::duration GetConnectionAge() const;
 
   // Capability detection
   bool SupportsCommands() const { return supports_commands; }
@@ -58,22 +232,69 @@ public:
 
   // Command execution
   std::string ExecuteCommand(const std::string &command);
+  // Start a command and read its output as a stream (throws if the channel
+  // can't be opened). Caller holds the borrowed SFTP session.
+  std::unique_ptr<SSHExecStream> OpenExecStream(const std::string &command,
+                                                bool gzip = false);
+  // Run a command and pass its output to on_line one line at a time (without
+  // the newline), so large outputs are never held in memory. on_line returns
+  // false to stop early. Returns the exit status, -1 if stopped early.
+  // Caller holds the borrowed SFTP session.
+  int ExecuteCommandLines(
+      const std::string &command,
+      const std::function<bool(const std::string &)> &on_line);
 
   // File operations
+  // Write size bytes at offset. truncate=true creates (or truncates) the file
+  // and its parent directories first, otherwise the file must already exist.
+  // The SFTP handle stays open for later chunks until CloseWriteHandle.
+  // bytes_confirmed (optional) is the number of bytes the server acknowledged,
+  // also when a "Transient SFTP write error" is thrown.
   void UploadChunk(const std::string &remote_path, const char *data,
-                   size_t size, bool append = false);
+                   size_t size, uint64_t offset, bool truncate,
+                   size_t *bytes_confirmed = nullptr);
+  // sha256 of length bytes at offset, computed on the server with dd and
+  // sha256sum. Returns false if the server can't run them.
+  bool RemoteChecksum(const std::string &remote_path, uint64_t offset,
+                      size_t length, std::string &sha256_hex);
+  // Close the write handle of a finished upload (no-op if none is open)
+  void CloseWriteHandle(const std::string &remote_path);
+  // Directories may have been removed or renamed - mkdir them again
+  void ForgetKnownDirectories();
   void RemoveFile(const std::string &remote_path);
   void RenameFile(const std::string &source_path,
                   const std::string &target_path);
+  // RenameFile, falling back to mv on the server when the SFTP rename is
+  // refused (e.g. across filesystems). Throws the rename error if mv is not
+  // available or fails as well.
+  void MoveFileRemote(const std::string &source_path,
+                      const std::string &target_path);
+  // Copy a file on the server with cp (a reflink clone on filesystems that
+  // support it), so the data never crosses the network. Creates the parent
+  // directories of target_path. Returns false if the server can't run cp.
+  bool CopyFileRemote(const std::string &source_path,
+                      const std::string &target_path);
   LIBSSH2_SFTP_ATTRIBUTES GetFileStats(const std::string &remote_path);
+  // Like GetFileStats, but returns false instead of throwing if the path
+  // does not exist
+  bool TryGetFileStats(const std::string &remote_path,
+                       LIBSSH2_SFTP_ATTRIBUTES &attrs);
 
-  // Read operations using dd
+  // Read operations using dd. Large reads are split into ranges, each
+  // streamed by its own dd on up to max_channels exec channels at once.
+  // Falls back to SFTP (and disables dd) if the server refuses channels or
+  // commands; a lower channel limit of the server is remembered.
+  // gzip pipes dd's output through gzip on the server (falls back to plain dd
+  // if the server has no gzip).
   size_t ReadBytes(const std::string &remote_path, char *buffer, size_t offset,
-                   size_t length);
+                   size_t length, size_t max_channels = 1, bool gzip = false);
 
   // SFTP session pooling for efficient uploads
   LIBSSH2_SFTP *BorrowSFTPSession();
   void ReturnSFTPSession(LIBSSH2_SFTP *sftp);
+  // Borrow the SFTP session only if it is idle (nullptr otherwise). Does not
+  // count as a use of the connection.
+  LIBSSH2_SFTP *TryBorrowSFTPSession();
 
   // SFTP-only operations (no SSH command execution)
   void CreateDirectorySFTP(const std::string &remote_path);
@@ -81,16 +302,72 @@ public:
   void TruncateFileSFTP(const std::string &remote_path, int64_t new_size);
   size_t ReadBytesSFTP(const std::string &remote_path, char *buffer,
                        size_t offset, size_t length);
+  // List a directory (symlinks are resolved to their targets). Returns false
+  // if the directory does not exist.
+  bool ListDirectory(const std::string &remote_path,
+                     std::vector<SFTPDirEntry> &entries);
+
+  // List regular files below base_path with one remote `find` (max_depth < 0
+  // = unlimited). Names are relative to base_path. Returns false if the
+  // server can't run GNU find - callers fall back to ListDirectory.
+  bool FindFiles(const std::string &base_path, int max_depth,
+                 std::vector<SFTPDirEntry> &entries);
+  // Stream the files and directories below base_path (one level unless
+  // recursive) from one remote find to on_entry, with the sha256 of each
+  // file computed on the server if with_hash ("" for directories). Names are
+  // relative to base_path; on_entry returns false to stop. Returns false
+  // before any entry was delivered if the server can't run find -printf or
+  // the directory does not exist - callers fall back to ListDirectory.
+  bool FindEntries(
+      const std::string &base_path, bool recursive, bool with_hash,
+      const std::function<bool(const SFTPDirEntry &, const std::string &)>
+          &on_entry);
+
+  // Cached read handles (call while holding the borrowed SFTP session).
+  // AcquireReadHandle throws if the file cannot be opened.
+  LIBSSH2_SFTP_HANDLE *AcquireReadHandle(LIBSSH2_SFTP *sftp,
+                                         const std::string &remote_path);
+  void ReleaseReadHandle(LIBSSH2_SFTP_HANDLE *handle, bool discard = false);
+  // Drop the cached handle of a path that was written, renamed or removed
+  void InvalidateReadHandle(const std::string &remote_path);
+
+  // Pipelined read from an open SFTP handle at its current offset. Keeps
+  // about read_window bytes of READ requests in flight and returns bytes
+  // read (short only at EOF). Throws "Transient SFTP error" for retryable
+  // failures.
+  size_t ReadPipelined(LIBSSH2_SFTP_HANDLE *handle,
+                       const std::string &remote_path, char *buffer,
+                       size_t length);
+  // Size of the libssh2_sftp_read calls that keep read_window in flight
+  static size_t ReadCallSize(const SSHConnectionParams &params);
 
 private:
   SSHConnectionParams params;
+  // Shared with the host's session pool (sshfs_stats)
+  std::shared_ptr<SSHFSHostStats> stats;
   int sock = -1;
   LIBSSH2_SESSION *session = nullptr;
-  bool connected = false;
+  std::atomic<bool> connected{false};
+  // Serializes Connect (e.g. sshfs_prewarm racing the first query)
+  std::mutex connect_mutex;
+  // Holds one of the host's MAX_CONNECTIONS slots while connected
+  bool holds_connection_slot = false;
+  // steady_clock times since epoch of the last use and of the connect
+  std::atomic<int64_t> last_used{0};
+  std::atomic<int64_t> connected_at{0};
+  // Round trip time estimated from the TCP connect, and the channel window
+  // derived from it
+  int64_t connect_rtt_us = 0;
+  uint32_t channel_window = LIBSSH2_CHANNEL_WINDOW_DEFAULT;
   bool supports_commands = false; // Auto-detected: can execute SSH commands
   bool dd_disabled =
-      false;               // Disabled after channel failures (use SFTP instead)
-  std::mutex upload_mutex; // Protect concurrent SFTP operations
+      false; // Disabled after channel failures (use SFTP instead)
+  // Disabled if the server has no gzip (dd reads stay uncompressed)
+  bool gzip_disabled = false;
+  // Exec channels the server allowed at once (learned from failed opens)
+  size_t dd_channel_limit = SIZE_MAX;
+  // Reads are not split into dd ranges smaller than this
+  static constexpr size_t DD_MIN_RANGE_SIZE = 1024 * 1024;
 
   // SFTP session pool
   std::queue<LIBSSH2_SFTP *> sftp_pool;
@@ -99,11 +376,72 @@ private:
   size_t pool_size = 1; // Single SFTP session - reused across reads
   bool pool_initialized = false;
 
+  // Open read handles on the pooled SFTP session (LRU, refcounted)
+  SFTPHandleCache read_handle_cache;
+
+  // Streaming uploads: write handles kept open between chunks of a file and
+  // directories already created on this connection. Only used while the SFTP
+  // session is borrowed, write_mutex guards against CloseWriteHandle and
+  // disconnects.
+  static constexpr size_t MAX_WRITE_HANDLES = 64;
+  std::unordered_map<std::string, LIBSSH2_SFTP_HANDLE *> write_handles;
+  std::unordered_set<std::string> known_directories;
+  std::mutex write_mutex;
+
+  // Open a session channel and exec command on it (throws on failure)
+  LIBSSH2_CHANNEL *OpenExecChannel(const std::string &command);
+  // Session channel with our receive window (nullptr on failure)
+  LIBSSH2_CHANNEL *OpenSessionChannel();
+  // Connection attempts with exponential backoff (Connect holds the lock and
+  // the connection slot)
+  void ConnectWithRetries();
+  // Wait for and take one of the host's MAX_CONNECTIONS slots. Returns false
+  // without MAX_CONNECTIONS.
+  bool ReserveConnectionSlot();
+  // Give back the slot this client holds, if any
+  void ReleaseConnectionSlot();
+  void ConfigureSocket();
+  uint32_t ComputeChannelWindow() const;
   void InitializeSession();
   void Authenticate();
+  // Try the agent's identities, the one that worked last time first
+  bool AuthenticateWithAgent(LIBSSH2_AGENT *agent);
+  // Run the `pwd` probe. Returns false if the result is not conclusive.
+  bool ProbeCapabilities();
   void CleanupSession();
   void InitializeSFTPPool();
+  // Close the cached read and write handles of the pooled SFTP session
+  void CloseCachedHandles();
   void CleanupSFTPPool();
+  bool StatPath(const std::string &remote_path, LIBSSH2_SFTP_ATTRIBUTES &attrs,
+                bool missing_ok);
+  // Caller must hold write_mutex and the borrowed SFTP session
+  LIBSSH2_SFTP_HANDLE *AcquireWriteHandle(LIBSSH2_SFTP *sftp,
+                                          const std::string &remote_path,
+                                          bool truncate);
+  void CloseWriteHandleLocked(const std::string &remote_path);
+  void CreateParentDirectories(LIBSSH2_SFTP *sftp,
+                               const std::string &remote_path);
+};
+
+// RAII borrow of a client's pooled SFTP session. The session doubles as the
+// lock on the libssh2 session, so it must go back exactly once, on every
+// path out of the caller.
+class SFTPSessionGuard {
+public:
+  explicit SFTPSessionGuard(SSHClient &client)
+      : client(client), sftp(client.BorrowSFTPSession()) {}
+  ~SFTPSessionGuard() { client.ReturnSFTPSession(sftp); }
+
+  // Non-copyable
+  SFTPSessionGuard(const SFTPSessionGuard &) = delete;
+  SFTPSessionGuard &operator=(const SFTPSessionGuard &) = delete;
+
+  LIBSSH2_SFTP *Get() const { return sftp; }
+
+private:
+  SSHClient &client;
+  LIBSSH2_SFTP *sftp;
 };
 
 } // namespace duckdb
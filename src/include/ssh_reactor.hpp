@@ -0,0 +1,132 @@
+#pragma once
+
+#include "duckdb.hpp"
+#include "ssh_client.hpp"
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace duckdb {
+
+class SSHSessionPool;
+
+// Multiplexed reads over one SSH connection (sshfs_multiplex_channels).
+// The reactor opens no login of its own: while reads are queued its I/O
+// thread leases a session from the pool and borrows its SFTP session, which
+// is also the lock on the libssh2 session, so nothing else touches it. The
+// session then runs non-blocking with one SFTP channel per concurrent read:
+// the thread steps every read until libssh2 returns EAGAIN, then polls the
+// socket, so many reads progress together on one TCP connection instead of
+// queueing for a leased session. This works on hosts that allow a single
+// login (MAX_CONNECTIONS 1).
+//
+// The session goes back to the pool once the reads are done, or after
+// MAX_HOLD so writes and metadata operations waiting for it get a turn.
+// A connection failure fails the reads in flight with "Transient SFTP error"
+// (the caller's retry submits them again) and the next read reconnects.
+class SSHReactor {
+public:
+  SSHReactor(SSHSessionPool &pool, const SSHConnectionParams &params,
+             size_t max_channels);
+  // Fails pending reads, returns the session and joins the I/O thread. The
+  // pool must still be alive.
+  ~SSHReactor();
+
+  // Non-copyable
+  SSHReactor(const SSHReactor &) = delete;
+  SSHReactor &operator=(const SSHReactor &) = delete;
+
+  // Read length bytes at offset, blocking the caller until the I/O thread is
+  // done. Returns bytes read (short only at EOF).
+  size_t Read(const std::string &remote_path, uint64_t offset, char *buffer,
+              size_t length);
+
+  // Settings may change between queries - more channels are opened on the
+  // next connect, fewer apply as reads finish
+  void SetMaxChannels(size_t max_channels);
+  size_t GetInFlightCount();
+
+private:
+  using Clock = std::chrono::steady_clock;
+
+  struct ReadOp {
+    enum class State { OPEN, READ, CLOSE };
+
+    std::string remote_path;
+    uint64_t offset;
+    char *buffer;
+    size_t length;
+    size_t bytes_read = 0;
+
+    // Only touched by the I/O thread
+    State state = State::OPEN;
+    LIBSSH2_SFTP_HANDLE *handle = nullptr;
+    std::exception_ptr failure; // Reported once the handle is closed
+
+    // Guarded by mutex
+    bool finished = false;
+    std::exception_ptr error;
+  };
+
+  struct Channel {
+    LIBSSH2_SFTP *sftp = nullptr;
+    // Opened by the reactor (the borrowed SFTP session is not)
+    bool owned = false;
+    std::shared_ptr<ReadOp> op;
+  };
+
+  SSHSessionPool &pool;
+  SSHConnectionParams params;
+  // Only touched by the I/O thread. client is leased from the pool and
+  // borrowed is its SFTP session while reads run.
+  std::shared_ptr<SSHClient> client;
+  LIBSSH2_SFTP *borrowed = nullptr;
+  std::vector<Channel> channels;
+  Clock::time_point last_progress;
+  Clock::time_point leased_at;
+  Clock::time_point last_busy;
+  // Set once the session was held for MAX_HOLD: no new reads are started
+  // until it has been returned
+  bool draining = false;
+  // Set by Step when the session failed - every read in flight is lost
+  std::string connection_error;
+
+  std::mutex mutex;
+  std::condition_variable done_cv;
+  std::deque<std::shared_ptr<ReadOp>> queue;
+  size_t max_channels;
+  size_t in_flight = 0;
+  bool stopping = false;
+  std::thread thread;
+  // Wakes the I/O thread's poll() when a read is submitted or on stop
+  int wake_pipe[2] = {-1, -1};
+
+  void Loop();
+  // Lease a session and open the SFTP channels in blocking mode, then switch
+  // the session to non-blocking. Queued reads fail if that is not possible.
+  bool Connect();
+  // Close the extra channels and return the session to the pool. Only
+  // called with no reads in flight.
+  void ReleaseSession();
+  // Hand queued reads to idle channels
+  void Dispatch();
+  // Advance one read until it needs the socket. Returns true on progress.
+  bool Step(Channel &channel);
+  void Finish(Channel &channel, std::exception_ptr error);
+  void FailQueued(std::exception_ptr error);
+  // Fail every read in flight and return the session (disconnected if it
+  // failed)
+  void ResetConnection(std::exception_ptr error, bool disconnect = true);
+  // Sleep until the socket is ready in the direction libssh2 is waiting for
+  // (busy) or a read is submitted
+  void Wait(bool busy);
+  void Wake();
+};
+
+} // namespace duckdb
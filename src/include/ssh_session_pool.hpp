@@ -0,0 +1,247 @@
+#pragma once
+
+#include "duckdb.hpp"
+#include "ssh_client.hpp"
+#include "ssh_reactor.hpp"
+#include "sshfs_block_cache.hpp"
+#include "sshfs_buffer_pool.hpp"
+#include "sshfs_metadata_cache.hpp"
+#include "sshfs_read_coalescer.hpp"
+#include "sshfs_readahead_scheduler.hpp"
+#include "sshfs_stats.hpp"
+#include "sshfs_upload_scheduler.hpp"
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace duckdb {
+
+// Pool of independent SSH connections to a single host (one per
+// connection key). Every SSHClient owns its own socket and LIBSSH2_SESSION,
+// so operations on different clients run in parallel while operations on the
+// same client stay serialized by its SFTP session pool.
+//
+// max_sessions=1 keeps the conservative single-connection behavior needed for
+// servers with strict connection limits (e.g., Hetzner Storage Boxes).
+class SSHSessionPool {
+public:
+  explicit SSHSessionPool(const SSHConnectionParams &params);
+  ~SSHSessionPool();
+
+  // Primary client - always present, used for metadata operations and uploads
+  std::shared_ptr<SSHClient> GetPrimary() const { return primary; }
+
+  // Borrow a client for exclusive use (connects lazily). Blocks while all
+  // max_sessions clients are busy; blocked callers are served in FIFO order.
+  std::shared_ptr<SSHClient> Acquire();
+  void Release(const std::shared_ptr<SSHClient> &client);
+
+  // Connect the primary and grow the pool to `sessions` clients (capped at
+  // max_sessions) on a background thread, so the first query skips the
+  // handshake (sshfs_prewarm). Returns false if a warm-up is still running.
+  bool Prewarm(size_t sessions);
+  // Block until a running warm-up has finished
+  void WaitForPrewarm();
+
+  enum class Health {
+    HEALTHY, // In use, alive, or not connected yet
+    IDLE,    // Primary unused for longer than idle_timeout
+    EXPIRED, // Primary connected for longer than max_lifetime
+    DEAD     // Primary failed its keepalive
+  };
+  // Health check of the clients nobody is using, called by the filesystem's
+  // maintenance thread (0 disables a limit). Extra sessions are handled
+  // here: idle ones are closed, dead or expired ones reconnected. The
+  // primary is only reported on - replacing it means replacing the pool.
+  Health Maintain(std::chrono::seconds idle_timeout,
+                  std::chrono::seconds max_lifetime);
+
+  // Called when the filesystem replaces this pool: idle connections close
+  // now and the rest when released, so handles still holding the pool don't
+  // keep the host above MAX_CONNECTIONS next to the replacement
+  void Retire();
+
+  const SSHConnectionParams &GetParams() const { return params; }
+
+  // Read length bytes at offset from a leased session, retrying transient
+  // errors with a reconnect. Returns bytes read (short only at EOF). With
+  // multiplex_channels > 0 reads share one leased session, driven
+  // non-blocking by the reactor, instead.
+  // With a coalescing gap, concurrent nearby reads of the same file are
+  // merged into one request first.
+  size_t ReadRange(const std::string &remote_path, idx_t offset, char *buffer,
+                   size_t length);
+
+  // Write size bytes at offset over a leased session, so chunks of the same
+  // file upload in parallel on up to max_sessions connections. truncate=true
+  // creates or truncates the file first. Transient errors reconnect and
+  // resume after the last byte the server confirmed (up to max_retries).
+  // With verify_uploads the chunk's sha256 is compared with the server's
+  // (or with the range read back over SFTP) and the whole range is resent on
+  // mismatch.
+  void WriteRange(const std::string &remote_path, idx_t offset,
+                  const char *data, size_t size, bool truncate);
+
+  // Close the write handles a finished upload left open on every session
+  void CloseWriteHandles(const std::string &remote_path);
+
+  // Stat through the metadata cache (positive and negative entries).
+  // Returns false if the path does not exist.
+  bool StatCached(const std::string &remote_path,
+                  LIBSSH2_SFTP_ATTRIBUTES &attrs);
+  // Stat on the server, refreshing the metadata cache
+  bool StatFresh(const std::string &remote_path,
+                 LIBSSH2_SFTP_ATTRIBUTES &attrs);
+
+  // Drop cached read handles, blocks and attributes for a path on every
+  // session (after a write, rename or remove). Cached attributes of parent
+  // directories are dropped too, since writes may have created them.
+  void InvalidatePath(const std::string &remote_path);
+  // Same, plus the attributes of everything below a directory
+  void InvalidateTree(const std::string &remote_path);
+
+  // Block cache shared by all pools of the filesystem (may be null)
+  void SetBlockCache(std::shared_ptr<SSHFSBlockCache> cache) {
+    block_cache = std::move(cache);
+  }
+  const std::shared_ptr<SSHFSBlockCache> &GetBlockCache() const {
+    return block_cache;
+  }
+  // Attribute cache shared by all pools of the filesystem (may be null)
+  void SetMetadataCache(std::shared_ptr<SSHFSMetadataCache> cache) {
+    metadata_cache = std::move(cache);
+  }
+  const std::shared_ptr<SSHFSMetadataCache> &GetMetadataCache() const {
+    return metadata_cache;
+  }
+  // Upload staging buffers shared by all pools of the filesystem (may be null)
+  void SetBufferPool(std::shared_ptr<SSHFSBufferPool> pool) {
+    buffer_pool = std::move(pool);
+  }
+  const std::shared_ptr<SSHFSBufferPool> &GetBufferPool() const {
+    return buffer_pool;
+  }
+  // Upload workers shared by all pools of the filesystem (may be null)
+  void SetUploadScheduler(std::shared_ptr<SSHFSUploadScheduler> scheduler) {
+    upload_scheduler = std::move(scheduler);
+  }
+  const std::shared_ptr<SSHFSUploadScheduler> &GetUploadScheduler() const {
+    return upload_scheduler;
+  }
+  // Readahead worker shared by all pools of the filesystem (may be null)
+  void SetReadaheadScheduler(
+      std::shared_ptr<SSHFSReadaheadScheduler> scheduler) {
+    readahead_scheduler = std::move(scheduler);
+  }
+  const std::shared_ptr<SSHFSReadaheadScheduler> &
+  GetReadaheadScheduler() const {
+    return readahead_scheduler;
+  }
+  // I/O counters of this host (sshfs_stats)
+  const std::shared_ptr<SSHFSHostStats> &GetStats() const { return stats; }
+  // Cache key of a remote file on this host (user@host:port/path)
+  std::string GetCacheKey(const std::string &remote_path) const;
+
+  // Settings may change between queries - the pool grows on demand but never
+  // closes connections that are already open
+  void SetMaxSessions(size_t max_sessions);
+  size_t GetMaxSessions();
+  size_t GetSessionCount();
+  // Whether Acquire would return a session right away (nobody waiting, one
+  // idle or the pool may grow) - speculative work only runs then
+  bool HasIdleSession();
+  // SSH transport compression is fixed per pool (part of the connection key)
+  void SetReadBackend(SSHReadBackend read_backend, size_t dd_channels,
+                      SSHCompression compression);
+  // 0 disables read coalescing
+  void SetCoalesceGap(size_t read_coalesce_gap);
+  // sshfs_verify_uploads and the testing fault interval for WriteRange
+  void SetUploadVerification(bool verify_uploads,
+                             size_t upload_fault_interval);
+  // 0 switches reads back to one read per leased session
+  void SetMultiplexChannels(size_t multiplex_channels);
+
+private:
+  struct PooledClient {
+    std::shared_ptr<SSHClient> client;
+    bool busy = false;
+  };
+
+  SSHConnectionParams params;
+  std::shared_ptr<SSHClient> primary;
+  std::shared_ptr<SSHFSHostStats> stats;
+  std::vector<PooledClient> clients;
+  std::shared_ptr<SSHFSBlockCache> block_cache;
+  std::shared_ptr<SSHFSMetadataCache> metadata_cache;
+  std::shared_ptr<SSHFSUploadScheduler> upload_scheduler;
+  std::shared_ptr<SSHFSReadaheadScheduler> readahead_scheduler;
+  std::shared_ptr<SSHFSBufferPool> buffer_pool;
+  // Multiplexed reads over a leased session, created on the first read that
+  // uses it
+  std::unique_ptr<SSHReactor> reactor;
+  size_t multiplex_channels;
+  SSHReadBackend read_backend;
+  size_t dd_channels;
+  SSHCompression compression;
+  SSHFSReadCoalescer coalescer;
+  size_t read_coalesce_gap;
+  bool verify_uploads;
+  size_t upload_fault_interval;
+  // WriteRange calls so far, for upload_fault_interval
+  uint64_t write_calls = 0;
+  size_t max_sessions;
+  // Set when the server refused an additional connection - we stop growing
+  // past the number of sessions that were successfully opened until
+  // grow_retry_at, in case the refusal was temporary
+  bool limit_reached = false;
+  std::chrono::steady_clock::time_point grow_retry_at;
+  // Replaced by a new pool (Retire)
+  bool retired = false;
+  std::mutex mutex;
+  std::condition_variable cv;
+  // Tickets of the callers blocked in Acquire, served in arrival order
+  std::deque<uint64_t> waiters;
+  uint64_t next_ticket = 0;
+  // Background connects of Prewarm (joined on destruction)
+  std::thread prewarm_thread;
+  bool prewarming = false;
+
+  void RunPrewarm(size_t sessions);
+  // Whether another connection may be opened below limit sessions, and
+  // remember a refused one (caller must hold mutex)
+  bool CanGrow(size_t limit);
+  void SetLimitReached();
+  // Reactor for reads, or null to lease a session
+  SSHReactor *GetReactor();
+  // Whether a read of length bytes goes to dd (sshfs_read_backend)
+  bool UseDD(size_t length);
+  // ReadRange without coalescing
+  size_t ReadRangeDirect(const std::string &remote_path, idx_t offset,
+                         char *buffer, size_t length);
+};
+
+// RAII lease of one pooled SSHClient
+class SSHClientLease {
+public:
+  explicit SSHClientLease(SSHSessionPool &pool)
+      : pool(pool), client(pool.Acquire()) {}
+  ~SSHClientLease() { pool.Release(client); }
+
+  // Non-copyable
+  SSHClientLease(const SSHClientLease &) = delete;
+  SSHClientLease &operator=(const SSHClientLease &) = delete;
+
+  SSHClient &operator*() const { return *client; }
+  SSHClient *operator->() const { return client.get(); }
+  const std::shared_ptr<SSHClient> &Get() const { return client; }
+
+private:
+  SSHSessionPool &pool;
+  std::shared_ptr<SSHClient> client;
+};
+
+} // namespace duckdb
@@ -0,0 +1,111 @@
+#pragma once
+
+#include "duckdb.hpp"
+#include <condition_variable>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+namespace duckdb {
+
+class SSHFSDiskCache;
+
+// Identity of the remote file contents a block was read from. Taken from the
+// LIBSSH2_SFTP_ATTRIBUTES returned by GetFileStats, so a file that changed on
+// the server (new size or mtime) never matches blocks read before the change.
+struct SSHFSFileVersion {
+  uint64_t size = 0;
+  uint64_t mtime = 0;
+  size_t block_size = 0;
+
+  bool operator==(const SSHFSFileVersion &other) const {
+    return size == other.size && mtime == other.mtime &&
+           block_size == other.block_size;
+  }
+  bool operator!=(const SSHFSFileVersion &other) const {
+    return !(*this == other);
+  }
+};
+
+// In-memory cache of fixed size blocks of remote files, shared by all handles
+// of one SSHFSFileSystem. Keyed by (file key, block index) where the file key
+// is user@host:port/path, and bounded by a global memory budget with LRU
+// eviction. Blocks being fetched are marked in flight so concurrent readers
+// (and readahead) never download the same block twice.
+class SSHFSBlockCache {
+public:
+  using Block = std::shared_ptr<const std::vector<char>>;
+
+  explicit SSHFSBlockCache(size_t capacity_bytes)
+      : capacity_bytes(capacity_bytes) {}
+  ~SSHFSBlockCache() = default;
+
+  // Non-copyable
+  SSHFSBlockCache(const SSHFSBlockCache &) = delete;
+  SSHFSBlockCache &operator=(const SSHFSBlockCache &) = delete;
+
+  // Return the cached block, waiting if another thread is fetching it. On a
+  // miss the block is reserved for the caller (reserved=true, returns
+  // nullptr), who must then call EndFetch.
+  Block GetOrReserve(const std::string &file_key,
+                     const SSHFSFileVersion &version, idx_t block_index,
+                     bool &reserved);
+  // Reserve a block without waiting (readahead). Returns false if the block
+  // is already cached or in flight.
+  bool TryReserve(const std::string &file_key, const SSHFSFileVersion &version,
+                  idx_t block_index);
+  // Complete a reservation. A null block (failed fetch) just releases it.
+  // Blocks of a file invalidated while in flight are dropped.
+  void EndFetch(const std::string &file_key, const SSHFSFileVersion &version,
+                idx_t block_index, Block block);
+
+  // Drop all blocks of a file that was written, renamed or removed
+  void InvalidateFile(const std::string &file_key);
+
+  // Optional persistent tier consulted before the network (may be null)
+  void SetDiskCache(std::shared_ptr<SSHFSDiskCache> cache);
+  std::shared_ptr<SSHFSDiskCache> GetDiskCache();
+
+  // Settings may change between queries - shrinking evicts immediately
+  void SetCapacity(size_t new_capacity_bytes);
+  size_t GetCapacity();
+  size_t GetMemoryUsage();
+
+private:
+  using LRUList = std::list<std::pair<std::string, idx_t>>;
+
+  struct CachedBlock {
+    Block data;
+    LRUList::iterator lru_position;
+  };
+
+  struct FileEntry {
+    SSHFSFileVersion version;
+    std::unordered_map<idx_t, CachedBlock> blocks;
+    std::unordered_set<idx_t> in_flight;
+    // In flight blocks of an invalidated version - discarded on EndFetch
+    std::unordered_set<idx_t> stale;
+  };
+
+  size_t capacity_bytes;
+  size_t used_bytes = 0;
+  std::shared_ptr<SSHFSDiskCache> disk_cache;
+  std::unordered_map<std::string, FileEntry> files;
+  LRUList lru; // Front = most recently used
+  std::mutex mutex;
+  std::condition_variable fetch_cv;
+
+  // Caller must hold mutex. Returns the entry for the file, dropping its
+  // blocks first if they belong to a different version.
+  FileEntry &GetEntry(const std::string &file_key,
+                      const SSHFSFileVersion &version);
+  void DropBlocks(FileEntry &entry);
+  void EvictToCapacity();
+};
+
+} // namespace duckdb
@@ -0,0 +1,104 @@
+#pragma once
+
+#include "duckdb.hpp"
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace duckdb {
+
+// Staging memory of one upload chunk: a heap vector, or in spill mode
+// (sshfs_upload_spill) a shared mapping of an unlinked temp file. Mapped pages
+// are page cache the kernel can write back and reclaim, so staged data does
+// not have to stay resident until its upload runs. Move-only.
+class SSHFSStagingBuffer {
+public:
+  SSHFSStagingBuffer() = default;
+  ~SSHFSStagingBuffer();
+
+  SSHFSStagingBuffer(SSHFSStagingBuffer &&other) noexcept;
+  SSHFSStagingBuffer &operator=(SSHFSStagingBuffer &&other) noexcept;
+  SSHFSStagingBuffer(const SSHFSStagingBuffer &) = delete;
+  SSHFSStagingBuffer &operator=(const SSHFSStagingBuffer &) = delete;
+
+  // Heap buffer with capacity bytes reserved
+  static SSHFSStagingBuffer Allocate(size_t capacity);
+  // Buffer of exactly capacity bytes mapped from a temp file in directory
+  static SSHFSStagingBuffer MapTempFile(const std::string &directory,
+                                        size_t capacity);
+
+  const char *Data() const { return mapping ? mapping : heap.data(); }
+  size_t Size() const { return mapping ? mapped_size : heap.size(); }
+  size_t Capacity() const {
+    return mapping ? mapped_capacity : heap.capacity();
+  }
+  bool Empty() const { return Size() == 0; }
+  bool IsMapped() const { return mapping != nullptr; }
+
+  // A mapped buffer can't grow past its capacity
+  void Append(const char *data, size_t length);
+  // Drop the contents and keep the capacity. A mapped buffer also frees its
+  // pages, so an idle buffer holds neither memory nor disk space.
+  void Clear();
+
+private:
+  std::vector<char> heap;
+  char *mapping = nullptr;
+  size_t mapped_size = 0;
+  size_t mapped_capacity = 0;
+  int fd = -1;
+
+  void Unmap();
+};
+
+// Upload staging buffers shared by all file handles of one SSHFSFileSystem.
+// Buffers that finished uploading are recycled instead of freed, so writing
+// a large file does not allocate (and page fault in) a fresh chunk_size
+// vector per chunk. Memory used by all buffers is capped
+// (sshfs_upload_memory_limit_mb): writers block in Acquire until an upload
+// returns its buffer. With a spill directory the buffers are mapped temp
+// files and the limit caps their disk space instead.
+class SSHFSBufferPool {
+public:
+  explicit SSHFSBufferPool(size_t limit_bytes) : limit_bytes(limit_bytes) {}
+  ~SSHFSBufferPool() = default;
+
+  // Non-copyable
+  SSHFSBufferPool(const SSHFSBufferPool &) = delete;
+  SSHFSBufferPool &operator=(const SSHFSBufferPool &) = delete;
+
+  // Empty buffer with at least capacity bytes reserved. Blocks while the limit
+  // is reached and buffers owned by uploads will be returned; if only staging
+  // buffers of open handles hold the memory the limit is exceeded instead,
+  // since waiting could deadlock a thread that writes many files.
+  SSHFSStagingBuffer Acquire(size_t capacity);
+  // The buffer was handed to an upload and will be released when it is done
+  void MarkUploading(const SSHFSStagingBuffer &buffer);
+  // Return a buffer from Acquire (uploading = after MarkUploading)
+  void Release(SSHFSStagingBuffer buffer, bool uploading);
+
+  void SetLimit(size_t new_limit_bytes);
+  size_t GetLimit();
+  // Directory for mapped buffers (empty = heap buffers)
+  void SetSpillDirectory(const std::string &directory);
+  // Bytes held by all buffers, including idle recycled ones
+  size_t GetMemoryUsage();
+
+private:
+  // Idle buffers kept for reuse - beyond this they are freed
+  static constexpr size_t MAX_FREE_BUFFERS = 8;
+
+  size_t limit_bytes;
+  size_t used_bytes = 0;
+  size_t uploading_bytes = 0;
+  std::string spill_directory;
+  std::vector<SSHFSStagingBuffer> free_buffers;
+  std::mutex mutex;
+  std::condition_variable released_cv;
+
+  // Caller must hold mutex
+  void TrimFreeBuffers();
+};
+
+} // namespace duckdb
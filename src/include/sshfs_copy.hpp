@@ -0,0 +1,17 @@
+#pragma once
+
+#include "duckdb.hpp"
+
+namespace duckdb {
+
+class ExtensionLoader;
+class SSHFSFileSystem;
+
+// sshfs_copy(source, target) table function. Copies a remote file without
+// downloading it when both URLs are on the same host (cp on the server),
+// otherwise streams it between the hosts over SFTP.
+struct SSHFSCopyFunction {
+  static void Register(ExtensionLoader &loader, SSHFSFileSystem &fs);
+};
+
+} // namespace duckdb
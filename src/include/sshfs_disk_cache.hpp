@@ -0,0 +1,77 @@
+#pragma once
+
+#include "duckdb.hpp"
+#include "sshfs_block_cache.hpp"
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+namespace duckdb {
+
+// Persistent second tier of the block cache (sshfs_cache_directory). Each
+// block is one file named after the remote file key hash, size, mtime, block
+// size and block index, so a changed remote file never matches old blocks and
+// several DuckDB processes can share one directory. Total size is capped with
+// LRU eviction; the LRU order survives restarts through the file mtimes.
+class SSHFSDiskCache {
+public:
+  // Creates the directory if needed and indexes the blocks already in it.
+  // Throws IOException if the directory cannot be created.
+  SSHFSDiskCache(std::string directory, size_t max_bytes);
+  ~SSHFSDiskCache() = default;
+
+  // Non-copyable
+  SSHFSDiskCache(const SSHFSDiskCache &) = delete;
+  SSHFSDiskCache &operator=(const SSHFSDiskCache &) = delete;
+
+  // Returns nullptr on a miss (or a corrupt / foreign block file)
+  SSHFSBlockCache::Block Get(const std::string &file_key,
+                             const SSHFSFileVersion &version,
+                             idx_t block_index);
+  // Best effort - write errors (e.g. disk full) only skip caching
+  void Put(const std::string &file_key, const SSHFSFileVersion &version,
+           idx_t block_index, const std::vector<char> &data);
+
+  // Remove the indexed blocks of a file that was written, renamed or removed
+  void InvalidateFile(const std::string &file_key);
+
+  void SetMaxSize(size_t new_max_bytes);
+  const std::string &GetDirectory() const { return directory; }
+  size_t GetUsedBytes();
+
+private:
+  struct IndexEntry {
+    size_t size = 0;
+    std::list<std::string>::iterator lru_position;
+  };
+
+  std::string directory;
+  size_t max_bytes;
+  // Counted as block file sizes on disk, header included
+  size_t used_bytes = 0;
+  // Block file name -> size, most recently used first
+  std::unordered_map<std::string, IndexEntry> index;
+  std::list<std::string> lru;
+  // FilePrefix -> names of the indexed blocks of that remote file
+  std::unordered_map<std::string, std::unordered_set<std::string>> file_blocks;
+  size_t temp_counter = 0;
+  std::mutex mutex;
+
+  static std::string FilePrefix(const std::string &file_key);
+  // Size of a block file holding data_size bytes of file_key
+  static size_t BlockFileSize(const std::string &file_key, size_t data_size);
+  static std::string BlockFileName(const std::string &file_key,
+                                   const SSHFSFileVersion &version,
+                                   idx_t block_index);
+  void LoadIndex();
+  // Caller must hold mutex
+  void Touch(const std::string &name, size_t size);
+  void Remove(const std::string &name);
+  void EvictToCapacity();
+};
+
+} // namespace duckdb
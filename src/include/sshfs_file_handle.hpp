@@ -3,32 +3,40 @@
 #include "duckdb.hpp"
 #include "duckdb/common/file_system.hpp"
 #include "ssh_client.hpp"
+#include "ssh_session_pool.hpp"
+#include "sshfs_buffer_pool.hpp"
+#include "sshfs_upload_scheduler.hpp"
 #include <atomic>
-#include <condition_variable>
-#include <exception>
 #include <libssh2.h>
 #include <libssh2_sftp.h>
 #include <memory>
-#include <mutex>
 #include <vector>
 
 namespace duckdb {
 
 class SSHFSFileSystem;
 
-// Buffer for async chunk uploads (similar to S3WriteBuffer)
+// Buffer for async chunk uploads (similar to S3WriteBuffer). The data goes
+// back to the shared buffer pool once the upload no longer references it.
 struct SSHFSWriteBuffer {
+  ~SSHFSWriteBuffer() {
+    if (pool) {
+      pool->Release(std::move(data), true);
+    }
+  }
+
   size_t part_no;
-  std::vector<char> data;
-  std::atomic<bool> uploading{false};
+  idx_t offset; // Position of the chunk in the remote file
+  SSHFSStagingBuffer data;
+  std::shared_ptr<SSHFSBufferPool> pool;
   std::atomic<bool> uploaded{false};
-  std::exception_ptr upload_error;
 };
 
 class SSHFSFileHandle : public FileHandle {
 public:
   SSHFSFileHandle(FileSystem &file_system, std::string path,
-                  FileOpenFlags flags, std::shared_ptr<SSHClient> client,
+                  FileOpenFlags flags,
+                  std::shared_ptr<SSHSessionPool> session_pool,
                   const SSHConnectionParams &params);
   ~SSHFSFileHandle() override;
 
@@ -47,58 +55,100 @@ public:
 
   // Getters for stats
   std::shared_ptr<SSHClient> GetClient() const { return ssh_client; }
+  std::shared_ptr<SSHSessionPool> GetSessionPool() const {
+    return session_pool;
+  }
   const std::string &GetRemotePath() const { return path; }
+  // Where writes go - a temp file next to the target with sshfs_atomic_uploads
+  const std::string &GetUploadPath() const { return upload_path; }
 
   // Get cached file stats (initializes cache on first call)
   LIBSSH2_SFTP_ATTRIBUTES GetCachedFileStats();
+  // Seed the cache with attributes that are already known (e.g. from Glob)
+  void SetCachedFileStats(const LIBSSH2_SFTP_ATTRIBUTES &attrs) {
+    cached_file_stats = attrs;
+    stats_cached = true;
+  }
 
   // Override GetProgress for better progress indication during uploads
   idx_t GetProgress() override;
 
 private:
   std::string path;
-  std::shared_ptr<SSHClient> ssh_client;
+  std::shared_ptr<SSHSessionPool> session_pool; // Parallel read sessions
+  std::shared_ptr<SSHClient> ssh_client;        // Primary client of the pool
   SSHConnectionParams connection_params;
 
   // File position tracking
   idx_t file_position = 0;
 
-  // Buffering for chunked writes
-  std::vector<char> write_buffer;
+  // Buffering for chunked writes. write_buffer comes from the filesystem's
+  // SSHFSBufferPool on the first write after each flushed chunk.
+  SSHFSStagingBuffer write_buffer;
+  std::shared_ptr<SSHFSBufferPool> buffer_pool;
+  bool has_write_buffer = false;
   bool buffer_dirty = false;
   size_t chunk_size = 50 * 1024 * 1024; // 50MB default
   size_t chunk_count = 0;
-
-  // Read handle caching - keep SFTP session open across reads
-  LIBSSH2_SFTP *read_sftp = nullptr;
-  LIBSSH2_SFTP_HANDLE *read_handle = nullptr;
-  bool read_initialized = false;
+  idx_t bytes_flushed = 0; // Offset of the next chunk
 
   // File stats caching - avoid repeated SFTP stat calls
   LIBSSH2_SFTP_ATTRIBUTES cached_file_stats;
   bool stats_cached = false;
 
-  // Streaming upload members (async chunk uploads like S3)
-  std::vector<std::shared_ptr<SSHFSWriteBuffer>> write_buffers;
-  std::mutex buffers_lock;
-  std::condition_variable upload_complete_cv;
-  std::atomic<size_t> uploads_in_progress{0};
-  std::atomic<size_t> chunks_uploaded{0};
-  std::atomic<size_t> bytes_uploaded{
-      0}; // Track bytes actually uploaded for progress
-  std::atomic<bool> has_upload_error{false};
-  std::exception_ptr first_upload_error;
+  // Streaming upload members (async chunk uploads like S3). Chunks run on
+  // the filesystem's shared SSHFSUploadScheduler; the group is created on the
+  // first flushed chunk.
+  std::shared_ptr<SSHFSUploadGroup> upload_group;
+  // sshfs_atomic_uploads: chunks go to upload_path, renamed to path on a
+  // successful Close and removed on failure
+  std::string upload_path;
+  bool atomic_upload = false;
+  bool upload_committed = false;
   size_t max_concurrent_uploads = 2; // Conservative for SFTP
   size_t total_bytes_written =
       0; // Total bytes written by DuckDB (for progress)
 
-  void FlushChunk();
-  void OpenForRead();     // Lazily open SFTP and file handle
-  void CloseReadHandle(); // Close read handle
+  // Block cache (shared by all handles of the filesystem)
+  bool use_block_cache = false;
+  // The version is checked with a real stat once per handle - the metadata
+  // cache may be up to its TTL old
+  bool version_validated = false;
+  std::string cache_key; // user@host:port/path
+  size_t block_size;
+  size_t readahead_blocks;
+  // Sequential access detection for readahead
+  idx_t last_read_end = 0;
+  size_t sequential_reads = 0;
+
+  // last=true when called from Close: a file that fits in one chunk is
+  // created by that chunk's upload
+  void FlushChunk(bool last = false);
+  // Staging buffer from the pool (blocks at sshfs_upload_memory_limit_mb)
+  void AcquireWriteBuffer();
+  void ReleaseWriteBuffer();
+
+  // Block cache reads: version from the cached file stats (false if the size
+  // is unknown), then serve [position, position + length) through the cache
+  bool GetFileVersion(SSHFSFileVersion &version);
+  size_t ReadCached(const SSHFSFileVersion &version, idx_t position,
+                    char *buffer, size_t length);
+  void ScheduleReadahead(const SSHFSFileVersion &version, idx_t position);
 
   // Streaming upload methods
-  void UploadChunkAsync(std::shared_ptr<SSHFSWriteBuffer> buffer);
+  static std::string TempUploadPath(const std::string &remote_path);
+  void CommitAtomicUpload();
+  void AbortAtomicUpload();
+  void EnsureFileCreated();
+  SSHFSUploadGroup &GetUploadGroup();
+  // Upload whole chunks from the caller's memory (no staging copy); returns
+  // once they are on the server
+  void WriteDirect(const char *data, size_t length);
+  // truncate=true for the chunk that creates the file
+  void UploadChunkAsync(std::shared_ptr<SSHFSWriteBuffer> buffer,
+                        bool truncate);
   void CheckUploadErrors();
+  size_t GetBytesUploaded();
 };
 
 } // namespace duckdb
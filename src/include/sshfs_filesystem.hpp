@@ -3,15 +3,57 @@
 #include "duckdb.hpp"
 #include "duckdb/common/file_system.hpp"
 #include "ssh_client.hpp"
+#include "ssh_session_pool.hpp"
+#include "sshfs_block_cache.hpp"
+#include "sshfs_buffer_pool.hpp"
+#include "sshfs_metadata_cache.hpp"
+#include "sshfs_readahead_scheduler.hpp"
+#include "sshfs_upload_scheduler.hpp"
+#include <condition_variable>
 #include <memory>
+#include <thread>
 #include <unordered_map>
 
 namespace duckdb {
 
+// Settings of the caches, upload workers and maintenance thread shared by all
+// hosts. They are read from the global configuration (not SET SESSION).
+struct SSHFSSharedSettings {
+  explicit SSHFSSharedSettings(const SSHConnectionParams &params);
+
+  size_t block_cache_size;
+  uint64_t metadata_cache_ttl_ms;
+  size_t upload_threads;
+  size_t max_host_uploads;
+  size_t upload_memory_limit;
+  string upload_spill_directory; // Empty when sshfs_upload_spill is off
+  string cache_directory;
+  size_t cache_max_size;
+  int idle_timeout_seconds;
+  int max_connection_lifetime_seconds;
+};
+
+// Settings of one host's pool that may change between queries
+struct SSHFSPoolSettings {
+  explicit SSHFSPoolSettings(const SSHConnectionParams &params);
+  bool operator==(const SSHFSPoolSettings &other) const;
+  bool operator!=(const SSHFSPoolSettings &other) const {
+    return !(*this == other);
+  }
+
+  size_t max_sessions;
+  size_t multiplex_channels;
+  SSHReadBackend read_backend;
+  size_t dd_channels;
+  size_t read_coalesce_gap;
+  bool verify_uploads;
+  size_t upload_fault_interval;
+};
+
 class SSHFSFileSystem : public FileSystem {
 public:
   SSHFSFileSystem();
-  ~SSHFSFileSystem() override = default;
+  ~SSHFSFileSystem() override;
 
   // FileSystem interface implementation
   unique_ptr<FileHandle>
@@ -59,6 +101,10 @@ public:
   vector<OpenFileInfo> Glob(const string &path,
                             FileOpener *opener = nullptr) override;
 
+  bool ListFiles(const string &directory,
+                 const std::function<void(const string &, bool)> &callback,
+                 FileOpener *opener = nullptr) override;
+
   bool CanHandleFile(const string &fpath) override;
 
   timestamp_t GetLastModifiedTime(FileHandle &handle) override;
@@ -74,12 +120,85 @@ public:
   // SSHFS specific methods
   std::shared_ptr<SSHClient> GetOrCreateClient(const string &path,
                                                FileOpener *opener);
+  std::shared_ptr<SSHSessionPool> GetOrCreateSessionPool(const string &path,
+                                                         FileOpener *opener);
   SSHConnectionParams ParseURL(const string &path, FileOpener *opener);
+  // Copy a remote file to another remote URL. On the same host the server
+  // copies it with cp; otherwise (or without command support) the data is
+  // streamed through this process over SFTP. Returns the bytes copied and
+  // sets method to "cp" or "sftp".
+  idx_t CopyFile(const string &source, const string &target,
+                 FileOpener *opener, string &method);
+  // List a remote directory for sshfs_ls (recursive = the whole tree).
+  // Streams from one remote find when the server can run it, otherwise
+  // lists with SFTP readdir. with_hash adds each file's sha256, computed by
+  // sha256sum on the server or else by reading the file over SFTP. Names
+  // passed to on_entry are relative to remote_path; it returns false to
+  // stop.
+  void ListTree(SSHSessionPool &pool, const string &remote_path,
+                bool recursive, bool with_hash,
+                const std::function<bool(const SFTPDirEntry &, const string &)>
+                    &on_entry);
+
+protected:
+  // Opens files returned by Glob with their size/mtime already known
+  unique_ptr<FileHandle>
+  OpenFileExtended(const OpenFileInfo &file, FileOpenFlags flags,
+                   optional_ptr<FileOpener> opener) override;
+  bool SupportsOpenFileExtended() const override { return true; }
+
+  // Entries carry file_size, last_modified and type from readdir
+  bool
+  ListFilesExtended(const string &directory,
+                    const std::function<void(OpenFileInfo &info)> &callback,
+                    optional_ptr<FileOpener> opener) override;
+  bool SupportsListFilesExtended() const override { return true; }
 
 private:
-  // Connection pool
-  std::unordered_map<string, std::shared_ptr<SSHClient>> client_pool;
+  // A host's pool and the settings last applied to it
+  struct PoolEntry {
+    std::shared_ptr<SSHSessionPool> pool;
+    SSHFSPoolSettings settings;
+  };
+  // Connection pool (one session pool per user@host:port)
+  std::unordered_map<string, PoolEntry> client_pool;
   std::mutex pool_mutex;
+  // Block cache shared by all hosts (sshfs_block_cache_size_mb)
+  std::shared_ptr<SSHFSBlockCache> block_cache;
+  // File attributes shared by all handles (sshfs_metadata_cache_ttl_ms)
+  std::shared_ptr<SSHFSMetadataCache> metadata_cache;
+  // Chunk upload workers shared by all hosts (sshfs_upload_threads)
+  std::shared_ptr<SSHFSUploadScheduler> upload_scheduler;
+  // Block prefetches of all handles (sshfs_readahead_blocks)
+  std::shared_ptr<SSHFSReadaheadScheduler> readahead_scheduler;
+  // Upload staging buffers (sshfs_upload_memory_limit_mb)
+  std::shared_ptr<SSHFSBufferPool> buffer_pool;
+
+  // Health checks, idle reaping and reconnects of the pools, off the query
+  // path (started with the first pool)
+  std::thread maintenance_thread;
+  std::mutex maintenance_mutex;
+  std::condition_variable maintenance_cv;
+  bool maintenance_stopping = false;
+  // Shared settings the caches and the maintenance thread currently use
+  // (guarded by settings_mutex)
+  SSHFSSharedSettings shared_settings;
+  std::mutex settings_mutex;
+
+  std::shared_ptr<SSHSessionPool>
+  GetOrCreateSessionPool(const SSHConnectionParams &params);
+  // Caller holds pool_mutex
+  std::shared_ptr<SSHSessionPool>
+  CreateSessionPool(const string &connection_key,
+                    const SSHConnectionParams &params);
+
+  void MaintenanceLoop();
+  void RunMaintenance();
+
+  // Applies the settings that differ from shared_settings - the caches are
+  // only resized, and the disk cache only rebuilt, when a value changed
+  void ApplySharedSettings(const SSHConnectionParams &params);
+  void ConfigureDiskCache(const SSHFSSharedSettings &settings);
 
   string ExtractConnectionKey(const SSHConnectionParams &params);
 };
@@ -0,0 +1,37 @@
+#pragma once
+
+#include "duckdb.hpp"
+#include <string>
+#include <vector>
+
+namespace duckdb {
+
+// A remote glob pattern split at the first segment containing a wildcard:
+// /data/2024/*/part-*.parquet -> base "/data/2024", segments
+// ["*", "part-*.parquet"]. An empty base means the login directory
+// (SCP-style relative paths).
+struct SSHFSGlobPattern {
+  std::string base;
+  std::vector<std::string> segments;
+
+  // True if any segment is "**" (matches zero or more directories)
+  bool IsRecursive() const;
+};
+
+SSHFSGlobPattern ParseGlobPattern(const std::string &remote_path);
+
+// Match one path segment against *, ? and [...] (fnmatch semantics)
+bool GlobMatchSegment(const std::string &pattern, const std::string &name);
+
+// Match a relative path (split into segments) against the pattern segments,
+// with "**" matching any number of directories
+bool GlobMatchPath(const std::vector<std::string> &pattern,
+                   const std::vector<std::string> &path);
+
+// Split a /-separated relative path into its non-empty segments
+std::vector<std::string> SplitRemotePath(const std::string &path);
+
+// Join a directory and an entry name ("" = login directory)
+std::string JoinRemotePath(const std::string &dir, const std::string &name);
+
+} // namespace duckdb
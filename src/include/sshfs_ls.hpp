@@ -0,0 +1,18 @@
+#pragma once
+
+#include "duckdb.hpp"
+
+namespace duckdb {
+
+class ExtensionLoader;
+class SSHFSFileSystem;
+
+// sshfs_ls(url [, recursive := true] [, with_hash := true]) table function.
+// Lists a remote directory with sizes, modification times and optionally
+// sha256 hashes computed on the server, for comparing remote files with
+// local ones without downloading them.
+struct SSHFSListFunction {
+  static void Register(ExtensionLoader &loader, SSHFSFileSystem &fs);
+};
+
+} // namespace duckdb
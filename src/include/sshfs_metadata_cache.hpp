@@ -0,0 +1,68 @@
+#pragma once
+
+#include "duckdb.hpp"
+#include <chrono>
+#include <libssh2.h>
+#include <libssh2_sftp.h>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+namespace duckdb {
+
+// Short-lived cache of remote file attributes, keyed by user@host:port/path
+// (the same key as the block cache) and shared by all handles and
+// filesystem calls. Filled by directory listings (ListFiles, Glob) and every
+// stat, including misses, so the FileExists / DirectoryExists /
+// GetFileSize / GetLastModifiedTime calls DuckDB makes several times per file
+// while binding a scan cost at most one round trip per TTL
+// (sshfs_metadata_cache_ttl_ms).
+class SSHFSMetadataCache {
+public:
+  explicit SSHFSMetadataCache(uint64_t ttl_ms) : ttl_ms(ttl_ms) {}
+  ~SSHFSMetadataCache() = default;
+
+  // Non-copyable
+  SSHFSMetadataCache(const SSHFSMetadataCache &) = delete;
+  SSHFSMetadataCache &operator=(const SSHFSMetadataCache &) = delete;
+
+  void Put(const std::string &key, const LIBSSH2_SFTP_ATTRIBUTES &attrs);
+  // Negative entry - the path does not exist
+  void PutMissing(const std::string &key);
+
+  // Returns false on a miss or an expired entry; exists=false for a cached
+  // negative entry
+  bool Get(const std::string &key, LIBSSH2_SFTP_ATTRIBUTES &attrs,
+           bool &exists);
+  // Only positive entries
+  bool Get(const std::string &key, LIBSSH2_SFTP_ATTRIBUTES &attrs);
+
+  void Invalidate(const std::string &key);
+  // Drop every key starting with prefix (directory renamed or removed)
+  void InvalidatePrefix(const std::string &prefix);
+
+  void SetTTL(uint64_t new_ttl_ms);
+  size_t Size();
+
+private:
+  using Clock = std::chrono::steady_clock;
+
+  struct Entry {
+    LIBSSH2_SFTP_ATTRIBUTES attrs;
+    bool exists = true;
+    Clock::time_point expires;
+  };
+
+  // Bound memory on huge listings - expired entries are purged first
+  static constexpr size_t MAX_ENTRIES = 256 * 1024;
+
+  uint64_t ttl_ms;
+  std::unordered_map<std::string, Entry> entries;
+  std::mutex mutex;
+
+  // Caller must hold mutex
+  void Insert(const std::string &key, const Entry &entry);
+  void PurgeExpired(Clock::time_point now);
+};
+
+} // namespace duckdb
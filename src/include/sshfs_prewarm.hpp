@@ -0,0 +1,17 @@
+#pragma once
+
+#include "duckdb.hpp"
+
+namespace duckdb {
+
+class ExtensionLoader;
+class SSHFSFileSystem;
+
+// sshfs_prewarm(url [, sessions := n] [, wait := true]) table function.
+// Connects to the host of url in the background, so the first query against
+// it does not pay for the handshake, authentication and capability probing.
+struct SSHFSPrewarmFunction {
+  static void Register(ExtensionLoader &loader, SSHFSFileSystem &fs);
+};
+
+} // namespace duckdb
@@ -0,0 +1,99 @@
+#pragma once
+
+#include "duckdb.hpp"
+#include <chrono>
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace duckdb {
+
+// One merged request covering the reads listed in members (indexes into the
+// planned reads)
+struct SSHFSReadRange {
+  idx_t offset;
+  size_t length;
+  std::vector<size_t> members;
+};
+
+// Merge reads (offset, length) that overlap, touch or are separated by at
+// most max_gap bytes into ranges of at most max_size bytes (a single read
+// larger than that stays on its own). Ranges are sorted by offset.
+std::vector<SSHFSReadRange>
+PlanCoalescedReads(const std::vector<std::pair<idx_t, size_t>> &reads,
+                   size_t max_gap, size_t max_size);
+
+// Gathers reads of the same file issued by concurrent threads (e.g. the
+// column chunk and page index reads of a Parquet scan, or block cache misses
+// of neighbouring blocks) and sends each group of nearby reads as one
+// request (sshfs_read_coalesce_gap_kb). The first read of a file waits a
+// short window for others to join, plans the batch, and every merged range
+// is fetched by one of its own callers, so unrelated ranges of a batch still
+// download in parallel.
+class SSHFSReadCoalescer {
+public:
+  // Reads bytes at offset into buffer, returns bytes read (short at EOF)
+  using FetchFunction =
+      std::function<size_t(const std::string &remote_path, idx_t offset,
+                           char *buffer, size_t length)>;
+
+  // How long the first read of a batch waits for others to join
+  static constexpr std::chrono::microseconds WINDOW{1000};
+  // Upper bound of a merged request
+  static constexpr size_t MAX_MERGED_SIZE = 16 * 1024 * 1024;
+
+  SSHFSReadCoalescer() = default;
+
+  // Non-copyable
+  SSHFSReadCoalescer(const SSHFSReadCoalescer &) = delete;
+  SSHFSReadCoalescer &operator=(const SSHFSReadCoalescer &) = delete;
+
+  size_t Read(const std::string &remote_path, idx_t offset, char *buffer,
+              size_t length, size_t max_gap, const FetchFunction &fetch);
+
+private:
+  struct Request;
+
+  struct PlannedRange {
+    idx_t offset;
+    size_t length;
+    std::vector<Request *> members;
+  };
+
+  // Lives on the stack of the waiting caller
+  struct Request {
+    idx_t offset;
+    size_t length;
+    char *buffer;
+
+    // Guarded by mutex
+    std::shared_ptr<PlannedRange> range; // Set once the batch is planned
+    bool owner = false;                  // This caller fetches range
+    bool done = false;
+
+    // Written by the range owner before done is set
+    size_t result = 0;
+    std::exception_ptr error;
+  };
+
+  struct Batch {
+    std::vector<Request *> requests;
+  };
+
+  std::mutex mutex;
+  std::condition_variable cv;
+  // Batches still accepting reads, by remote path
+  std::unordered_map<std::string, std::shared_ptr<Batch>> open_batches;
+
+  // Fetch a merged range and hand every member its part
+  void FetchRange(const std::string &remote_path, PlannedRange &range,
+                  const FetchFunction &fetch);
+};
+
+} // namespace duckdb
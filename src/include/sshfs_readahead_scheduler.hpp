@@ -0,0 +1,46 @@
+#pragma once
+
+#include "duckdb.hpp"
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+namespace duckdb {
+
+// Block cache prefetches (sshfs_readahead_blocks) of all file handles of one
+// SSHFSFileSystem, run by a single worker thread instead of a thread per
+// sequential read. Readahead is best effort: a job that finds MAX_QUEUED
+// jobs already waiting is dropped, and jobs decide when they run whether
+// the blocks are still missing and a session is free.
+class SSHFSReadaheadScheduler {
+public:
+  SSHFSReadaheadScheduler() = default;
+  ~SSHFSReadaheadScheduler();
+
+  // Non-copyable
+  SSHFSReadaheadScheduler(const SSHFSReadaheadScheduler &) = delete;
+  SSHFSReadaheadScheduler &operator=(const SSHFSReadaheadScheduler &) = delete;
+
+  // Returns false if the job was dropped (queue full or shut down)
+  bool Submit(std::function<void()> job);
+  // Drop the queued jobs and join the worker once the running job is done.
+  // Later submits are dropped.
+  void Shutdown();
+
+  size_t GetQueuedCount();
+
+private:
+  static constexpr size_t MAX_QUEUED = 16;
+
+  std::mutex mutex;
+  std::condition_variable work_cv;
+  std::deque<std::function<void()>> queue;
+  std::thread worker;
+  bool stopping = false;
+
+  void WorkerLoop();
+};
+
+} // namespace duckdb
@@ -0,0 +1,100 @@
+#pragma once
+
+#include "duckdb.hpp"
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace duckdb {
+
+class ExtensionLoader;
+struct SSHConnectionParams;
+
+// Latency histogram with power of two microsecond buckets (lock-free)
+class SSHFSLatencyHistogram {
+public:
+  void Record(uint64_t micros);
+  uint64_t GetCount() const;
+  // Upper bound of the bucket holding the given quantile (0 if empty)
+  uint64_t GetPercentile(double quantile) const;
+  void Reset();
+
+private:
+  static constexpr size_t BUCKETS = 40;
+  std::array<std::atomic<uint64_t>, BUCKETS> buckets{};
+};
+
+// I/O counters of one host (user@host:port), shared by its session pool,
+// every SSHClient connected to it and the file handles reading or writing
+// through them. Updated with relaxed atomics on the hot paths.
+struct SSHFSHostStats {
+  std::atomic<uint64_t> bytes_read{0};
+  std::atomic<uint64_t> bytes_written{0};
+  std::atomic<uint64_t> read_requests{0};
+  std::atomic<uint64_t> write_requests{0};
+  std::atomic<uint64_t> handle_opens{0};
+  std::atomic<uint64_t> stat_calls{0};
+  std::atomic<uint64_t> retries{0};
+  std::atomic<uint64_t> connects{0};
+  // Time callers waited for a free session (sshfs_max_sessions)
+  std::atomic<uint64_t> session_wait_us{0};
+  // Time writers waited for uploads in flight (backpressure and close)
+  std::atomic<uint64_t> upload_wait_us{0};
+  SSHFSLatencyHistogram read_latency;
+  SSHFSLatencyHistogram write_latency;
+
+  static void Add(std::atomic<uint64_t> &counter, uint64_t value) {
+    counter.fetch_add(value, std::memory_order_relaxed);
+  }
+  // (metric, value) rows in the order sshfs_stats() returns them
+  std::vector<std::pair<std::string, uint64_t>> Snapshot() const;
+  void Reset();
+};
+
+// Process-wide registry behind sshfs_stats(). Entries live as long as the
+// process, so counters survive reconnects and dropped session pools.
+class SSHFSStatsRegistry {
+public:
+  static std::shared_ptr<SSHFSHostStats>
+  ForHost(const SSHConnectionParams &params);
+  static std::vector<std::pair<std::string, std::shared_ptr<SSHFSHostStats>>>
+  GetAll();
+
+private:
+  static std::mutex mutex;
+  static std::map<std::string, std::shared_ptr<SSHFSHostStats>> hosts;
+};
+
+// Adds the elapsed time to a counter when it goes out of scope
+class SSHFSWaitTimer {
+public:
+  explicit SSHFSWaitTimer(std::atomic<uint64_t> &counter)
+      : counter(counter), start(std::chrono::steady_clock::now()) {}
+  ~SSHFSWaitTimer() {
+    SSHFSHostStats::Add(counter,
+                        std::chrono::duration_cast<std::chrono::microseconds>(
+                            std::chrono::steady_clock::now() - start)
+                            .count());
+  }
+
+  // Non-copyable
+  SSHFSWaitTimer(const SSHFSWaitTimer &) = delete;
+  SSHFSWaitTimer &operator=(const SSHFSWaitTimer &) = delete;
+
+private:
+  std::atomic<uint64_t> &counter;
+  std::chrono::steady_clock::time_point start;
+};
+
+// sshfs_stats([reset := true]) table function
+struct SSHFSStatsFunction {
+  static void Register(ExtensionLoader &loader);
+};
+
+} // namespace duckdb
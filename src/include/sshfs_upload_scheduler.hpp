@@ -0,0 +1,114 @@
+#pragma once
+
+#include "duckdb.hpp"
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace duckdb {
+
+class SSHFSUploadScheduler;
+
+// Chunk uploads of one file handle. Jobs start in submission order with at
+// most max_parallel of them running at once. Submit blocks while max_pending
+// jobs are queued or running (backpressure on the writer). After the first
+// failure the remaining queued jobs are dropped and the error is rethrown
+// from Submit / CheckError.
+class SSHFSUploadGroup
+    : public std::enable_shared_from_this<SSHFSUploadGroup> {
+public:
+  SSHFSUploadGroup(SSHFSUploadScheduler &scheduler, std::string host_key,
+                   size_t max_pending, size_t max_parallel);
+
+  // Non-copyable
+  SSHFSUploadGroup(const SSHFSUploadGroup &) = delete;
+  SSHFSUploadGroup &operator=(const SSHFSUploadGroup &) = delete;
+
+  // Queue a job that uploads bytes bytes (counted for progress on success)
+  void Submit(std::function<void()> job, size_t bytes);
+  // Block until every submitted job has finished or was dropped
+  void Wait();
+  void CheckError();
+
+  size_t GetPendingCount();
+  size_t GetBytesCompleted();
+
+private:
+  friend class SSHFSUploadScheduler;
+
+  struct Job {
+    std::function<void()> run;
+    size_t bytes;
+  };
+
+  SSHFSUploadScheduler &scheduler;
+  std::string host_key;
+  size_t max_pending;
+  size_t max_parallel;
+
+  // Guarded by the scheduler mutex
+  std::deque<Job> queue;
+  size_t running = 0;
+  size_t bytes_completed = 0;
+  std::exception_ptr first_error;
+  std::condition_variable done_cv;
+};
+
+// Bounded pool of upload workers shared by all file handles of one
+// SSHFSFileSystem. At most max_total uploads run at once, and at most
+// max_per_host against the same host:port, however many files a
+// COPY ... PARTITION_BY writes. Handles with queued chunks are served round
+// robin so one large file cannot starve the others.
+class SSHFSUploadScheduler {
+public:
+  SSHFSUploadScheduler(size_t max_total, size_t max_per_host);
+  // Finishes the queued jobs, then joins the workers
+  ~SSHFSUploadScheduler();
+
+  // Non-copyable
+  SSHFSUploadScheduler(const SSHFSUploadScheduler &) = delete;
+  SSHFSUploadScheduler &operator=(const SSHFSUploadScheduler &) = delete;
+
+  // host_key groups handles for the per-host limit (host:port)
+  std::shared_ptr<SSHFSUploadGroup> CreateGroup(const std::string &host_key,
+                                                size_t max_pending,
+                                                size_t max_parallel);
+
+  // Settings may change between queries - workers are started on demand and
+  // lowered limits apply as running uploads finish
+  void SetLimits(size_t max_total, size_t max_per_host);
+
+  size_t GetRunningCount();
+  size_t GetQueuedCount();
+
+private:
+  friend class SSHFSUploadGroup;
+
+  std::mutex mutex;
+  std::condition_variable work_cv;
+  size_t max_total;
+  size_t max_per_host;
+  size_t running_total = 0;
+  std::unordered_map<std::string, size_t> running_per_host;
+  // Groups with queued jobs, in round robin order
+  std::deque<std::shared_ptr<SSHFSUploadGroup>> ready;
+  std::vector<std::thread> workers;
+  bool stopping = false;
+
+  // Caller must hold mutex
+  void Enqueue(const std::shared_ptr<SSHFSUploadGroup> &group);
+  void StartWorkers();
+  bool NextJob(std::shared_ptr<SSHFSUploadGroup> &group,
+               SSHFSUploadGroup::Job &job);
+
+  void WorkerLoop();
+};
+
+} // namespace duckdb
@@ -0,0 +1,178 @@
+#include "sftp_handle_cache.hpp"
+#include "ssh_helpers.hpp"
+
+namespace duckdb {
+
+LIBSSH2_SFTP_HANDLE *SFTPHandleCache::Acquire(LIBSSH2_SFTP *sftp,
+                                              const std::string &path,
+                                              bool *opened) {
+  std::vector<LIBSSH2_SFTP_HANDLE *> to_close;
+  LIBSSH2_SFTP_HANDLE *handle = nullptr;
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    // We own the SFTP channel now - safe to close invalidated handles
+    to_close.swap(pending_close);
+
+    auto it = entries.find(path);
+    if (it != entries.end()) {
+      it->second.refcount++;
+      lru.splice(lru.begin(), lru, it->second.lru_position);
+      handle = it->second.handle;
+    }
+  }
+  CloseHandles(to_close);
+
+  if (handle) {
+    SSHFS_LOG("  [HANDLE-CACHE] Hit for " << path);
+    return handle;
+  }
+
+  // Miss - open outside the lock (one round trip)
+  handle = libssh2_sftp_open(sftp, path.c_str(), LIBSSH2_FXF_READ, 0);
+  if (!handle) {
+    return nullptr;
+  }
+  if (opened) {
+    *opened = true;
+  }
+  SSHFS_LOG("  [HANDLE-CACHE] Opened read handle for " << path);
+
+  to_close.clear();
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto existing = entries.find(path);
+    if (existing != entries.end()) {
+      // Only possible if the channel was used without being borrowed - keep
+      // the newer handle and retire the old one
+      if (existing->second.refcount == 0) {
+        to_close.push_back(existing->second.handle);
+      } else {
+        detached[existing->second.handle] = existing->second.refcount;
+      }
+      lru.erase(existing->second.lru_position);
+      entries.erase(existing);
+    }
+
+    lru.push_front(path);
+    Entry entry;
+    entry.handle = handle;
+    entry.refcount = 1;
+    entry.lru_position = lru.begin();
+    entries[path] = entry;
+    EvictIdle(to_close);
+  }
+  CloseHandles(to_close);
+
+  return handle;
+}
+
+void SFTPHandleCache::Release(LIBSSH2_SFTP_HANDLE *handle, bool discard) {
+  if (!handle) {
+    return;
+  }
+
+  std::vector<LIBSSH2_SFTP_HANDLE *> to_close;
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    // Invalidated while in use?
+    auto detached_it = detached.find(handle);
+    if (detached_it != detached.end()) {
+      if (--detached_it->second == 0) {
+        detached.erase(detached_it);
+        to_close.push_back(handle);
+      }
+    } else {
+      for (auto it = entries.begin(); it != entries.end(); ++it) {
+        if (it->second.handle != handle) {
+          continue;
+        }
+        if (it->second.refcount > 0) {
+          it->second.refcount--;
+        }
+        if (discard) {
+          if (it->second.refcount == 0) {
+            to_close.push_back(handle);
+          } else {
+            detached[handle] = it->second.refcount;
+          }
+          lru.erase(it->second.lru_position);
+          entries.erase(it);
+        }
+        break;
+      }
+    }
+    EvictIdle(to_close);
+  }
+  CloseHandles(to_close);
+}
+
+void SFTPHandleCache::Invalidate(const std::string &path) {
+  std::lock_guard<std::mutex> lock(mutex);
+  auto it = entries.find(path);
+  if (it == entries.end()) {
+    return;
+  }
+
+  SSHFS_LOG("  [HANDLE-CACHE] Invalidated " << path);
+  if (it->second.refcount == 0) {
+    pending_close.push_back(it->second.handle);
+  } else {
+    detached[it->second.handle] = it->second.refcount;
+  }
+  lru.erase(it->second.lru_position);
+  entries.erase(it);
+}
+
+void SFTPHandleCache::CloseAll() {
+  std::vector<LIBSSH2_SFTP_HANDLE *> to_close;
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    to_close.swap(pending_close);
+    for (auto &entry : entries) {
+      to_close.push_back(entry.second.handle);
+    }
+    for (auto &entry : detached) {
+      to_close.push_back(entry.first);
+    }
+    entries.clear();
+    detached.clear();
+    lru.clear();
+  }
+  CloseHandles(to_close);
+}
+
+void SFTPHandleCache::SetMaxHandles(size_t new_max_handles) {
+  std::lock_guard<std::mutex> lock(mutex);
+  max_handles = new_max_handles;
+}
+
+size_t SFTPHandleCache::Size() {
+  std::lock_guard<std::mutex> lock(mutex);
+  return entries.size();
+}
+
+void SFTPHandleCache::EvictIdle(std::vector<LIBSSH2_SFTP_HANDLE *> &to_close) {
+  // Walk from the least recently used end, skipping handles in use
+  auto it = lru.end();
+  while (entries.size() > max_handles && it != lru.begin()) {
+    --it;
+    auto entry_it = entries.find(*it);
+    if (entry_it == entries.end() || entry_it->second.refcount > 0) {
+      continue;
+    }
+    SSHFS_LOG("  [HANDLE-CACHE] Evicting " << *it);
+    to_close.push_back(entry_it->second.handle);
+    entries.erase(entry_it);
+    it = lru.erase(it);
+  }
+}
+
+void SFTPHandleCache::CloseHandles(
+    const std::vector<LIBSSH2_SFTP_HANDLE *> &handles) {
+  for (auto handle : handles) {
+    libssh2_sftp_close(handle);
+  }
+}
+
+} // namespace duckdb
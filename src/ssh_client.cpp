@@ -1,30 +1,238 @@
 #include "ssh_client.hpp"
 #include "duckdb/common/exception.hpp"
 #include "ssh_helpers.hpp"
+#include <algorithm>
 #include <arpa/inet.h>
 #include <chrono>
+#include <climits>
 #include <cstring>
 #include <fcntl.h>
+#include <functional>
 #include <iostream>
 #include <netdb.h>
 #include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <openssl/evp.h>
 #include <poll.h>
 #include <sstream>
 #include <sys/socket.h>
 #include <thread>
 #include <unistd.h>
+#include <zlib.h>
 
 namespace duckdb {
 
+constexpr size_t SSHClient::MAX_WRITE_HANDLES;
+constexpr size_t SSHClient::DD_MIN_RANGE_SIZE;
+constexpr size_t SSHExecStream::BUFFER_SIZE;
+
 // Thread-local debug flag
 thread_local bool g_sshfs_debug_enabled = false;
 
-// Global mutex to serialize dd command execution (SSH channels)
-// Hetzner Storage Boxes limit concurrent SSH channels
-// Serialize all dd reads to avoid overwhelming the server
-static std::mutex g_dd_command_mutex;
+// Inflates `gzip -c` output as it arrives from an exec channel
+class GzipStreamDecoder {
+public:
+  GzipStreamDecoder() {
+    memset(&stream, 0, sizeof(stream));
+    // 16 + MAX_WBITS: expect a gzip header
+    initialized = inflateInit2(&stream, 16 + MAX_WBITS) == Z_OK;
+  }
+  ~GzipStreamDecoder() {
+    if (initialized) {
+      inflateEnd(&stream);
+    }
+  }
+
+  // Non-copyable (zlib keeps a pointer back to the stream)
+  GzipStreamDecoder(const GzipStreamDecoder &) = delete;
+  GzipStreamDecoder &operator=(const GzipStreamDecoder &) = delete;
+
+  // Decode input into out, at most out_size bytes. consumed (optional) is the
+  // part of input that was used - the rest must be passed again once out has
+  // been drained. Returns false for corrupt input.
+  bool Decode(const char *input, size_t input_size, char *out, size_t out_size,
+              size_t &written, size_t *consumed = nullptr) {
+    written = 0;
+    if (consumed) {
+      *consumed = 0;
+    }
+    if (!initialized) {
+      return false;
+    }
+    stream.next_in = reinterpret_cast<Bytef *>(const_cast<char *>(input));
+    stream.avail_in = static_cast<uInt>(input_size);
+    while (!finished && stream.avail_in > 0 && written < out_size) {
+      stream.next_out = reinterpret_cast<Bytef *>(out + written);
+      stream.avail_out = static_cast<uInt>(out_size - written);
+      int rc = inflate(&stream, Z_NO_FLUSH);
+      written = out_size - stream.avail_out;
+      if (rc == Z_STREAM_END) {
+        finished = true; // Anything after the trailer is ignored
+      } else if (rc != Z_OK) {
+        return false;
+      }
+    }
+    if (consumed) {
+      *consumed = finished ? input_size : input_size - stream.avail_in;
+    }
+    return true;
+  }
+
+  bool IsFinished() const { return finished; }
+
+private:
+  z_stream stream;
+  bool initialized = false;
+  bool finished = false;
+};
+
+namespace {
+
+// sshfs_cipher_preference lists - libssh2 skips names its crypto backend
+// doesn't implement
+const char *AES_GCM_CIPHERS = "aes128-gcm@openssh.com,aes256-gcm@openssh.com";
+const char *CHACHA_CIPHERS = "chacha20-poly1305@openssh.com";
+const char *AES_CTR_CIPHERS = "aes128-ctr,aes192-ctr,aes256-ctr";
+const char *CBC_CIPHERS = "aes128-cbc,aes192-cbc,aes256-cbc,3des-cbc";
+// Only used with the CTR modes (AEAD ciphers carry their own MAC).
+// Encrypt-then-MAC variants first, SHA-256 before SHA-512: it is the one
+// with hardware support on most CPUs.
+const char *THROUGHPUT_MACS = "hmac-sha2-256-etm@openssh.com,hmac-sha2-256,"
+                              "hmac-sha2-512-etm@openssh.com,hmac-sha2-512,"
+                              "hmac-sha1";
+const char *COMPAT_MACS = "hmac-sha2-256,hmac-sha2-512,hmac-sha1,hmac-sha1-96,"
+                          "hmac-md5";
+
+// MB/s of encrypting a buffer with an OpenSSL cipher (0 if unavailable)
+double MeasureCipherSpeed(const EVP_CIPHER *cipher) {
+  const int BUFFER_SIZE = 256 * 1024;
+  const int ROUNDS = 8;
+  if (!cipher) {
+    return 0;
+  }
+  std::unique_ptr<EVP_CIPHER_CTX, decltype(&EVP_CIPHER_CTX_free)> ctx(
+      EVP_CIPHER_CTX_new(), EVP_CIPHER_CTX_free);
+  unsigned char key[32] = {0};
+  unsigned char iv[16] = {0};
+  if (!ctx ||
+      EVP_EncryptInit_ex(ctx.get(), cipher, nullptr, key, iv) != 1) {
+    return 0;
+  }
+  std::vector<unsigned char> input(BUFFER_SIZE, 0x5a);
+  std::vector<unsigned char> output(BUFFER_SIZE + 64);
+  auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < ROUNDS; i++) {
+    int written = 0;
+    if (EVP_EncryptUpdate(ctx.get(), output.data(), &written, input.data(),
+                          BUFFER_SIZE) != 1) {
+      return 0;
+    }
+  }
+  double seconds = std::chrono::duration<double>(
+                       std::chrono::steady_clock::now() - start)
+                       .count();
+  return seconds > 0 ? BUFFER_SIZE * double(ROUNDS) / seconds / 1e6 : 0;
+}
+
+// AES-GCM wins with AES instructions (AES-NI, ARMv8 crypto), chacha20
+// without - measure once per process (a few milliseconds)
+bool PreferAesGcm() {
+  static const bool prefer_aes = []() {
+    double aes = MeasureCipherSpeed(EVP_aes_128_gcm());
+    double chacha = MeasureCipherSpeed(EVP_chacha20_poly1305());
+    SSHFS_LOG("  [CRYPT] Local cipher speed: aes128-gcm " << int(aes)
+                                                          << " MB/s, chacha20-"
+                                                          << "poly1305 "
+                                                          << int(chacha)
+                                                          << " MB/s");
+    return aes >= chacha;
+  }();
+  return prefer_aes;
+}
+
+// strict_crypto never offers legacy algorithms (CBC, 3DES, RC4, SHA-1/MD5
+// MACs)
+std::string WithoutLegacyAlgorithms(const std::string &list) {
+  static const char *LEGACY[] = {"cbc",     "3des",     "arcfour",
+                                 "blowfish", "cast128", "hmac-sha1",
+                                 "hmac-md5", "ripemd"};
+  std::string result;
+  size_t start = 0;
+  while (start <= list.size()) {
+    size_t end = list.find(',', start);
+    if (end == std::string::npos) {
+      end = list.size();
+    }
+    std::string name = list.substr(start, end - start);
+    start = end + 1;
+    bool legacy = false;
+    for (auto marker : LEGACY) {
+      legacy = legacy || name.find(marker) != std::string::npos;
+    }
+    if (!name.empty() && !legacy) {
+      result += (result.empty() ? "" : ",") + name;
+    }
+  }
+  return result;
+}
+
+std::mutex server_profiles_mutex;
+std::unordered_map<std::string, SSHServerProfile> server_profiles;
+
+std::string ServerProfileKey(const SSHConnectionParams &params) {
+  return params.username + "@" + params.hostname + ":" +
+         std::to_string(params.port);
+}
+
+SSHServerProfile LoadServerProfile(const SSHConnectionParams &params) {
+  std::lock_guard<std::mutex> lock(server_profiles_mutex);
+  auto it = server_profiles.find(ServerProfileKey(params));
+  return it != server_profiles.end() ? it->second : SSHServerProfile();
+}
+
+void UpdateServerProfile(const SSHConnectionParams &params,
+                         const std::function<void(SSHServerProfile &)> &fn) {
+  std::lock_guard<std::mutex> lock(server_profiles_mutex);
+  fn(server_profiles[ServerProfileKey(params)]);
+}
+
+// Connections open to one user@host:port, counted across every client of the
+// process so a replaced pool and the old pool its handles still use share the
+// secret's MAX_CONNECTIONS
+struct ConnectionBudget {
+  std::mutex mutex;
+  std::condition_variable cv;
+  size_t open = 0;
+};
+
+std::mutex connection_budgets_mutex;
+std::unordered_map<std::string, unique_ptr<ConnectionBudget>>
+    connection_budgets;
+
+ConnectionBudget &GetConnectionBudget(const SSHConnectionParams &params) {
+  std::lock_guard<std::mutex> lock(connection_budgets_mutex);
+  auto &budget = connection_budgets[ServerProfileKey(params)];
+  if (!budget) {
+    budget = make_uniq<ConnectionBudget>();
+  }
+  return *budget;
+}
+
+void FreeConnectionSlot(const SSHConnectionParams &params) {
+  auto &budget = GetConnectionBudget(params);
+  {
+    std::lock_guard<std::mutex> lock(budget.mutex);
+    budget.open--;
+  }
+  // Waiters may have different limits (secrets of the same host)
+  budget.cv.notify_all();
+}
 
-SSHClient::SSHClient(const SSHConnectionParams &params) : params(params) {
+} // namespace
+
+SSHClient::SSHClient(const SSHConnectionParams &params)
+    : params(params), stats(SSHFSStatsRegistry::ForHost(params)),
+      read_handle_cache(params.max_open_handles) {
   // Set thread-local debug flag from params
   g_sshfs_debug_enabled = params.debug_logging;
   // Initialize libssh2 (refcounted internally, safe to call multiple times)
@@ -53,6 +261,55 @@ void SSHClient::Connect() {
     return;
   }
 
+  // Wait for the host's MAX_CONNECTIONS budget before taking connect_mutex,
+  // so callers that find the client connected meanwhile don't wait with us
+  bool reserved = ReserveConnectionSlot();
+  std::lock_guard<std::mutex> connect_lock(connect_mutex);
+  if (connected) {
+    if (reserved) {
+      FreeConnectionSlot(params);
+    }
+    return;
+  }
+
+  holds_connection_slot = reserved;
+  try {
+    ConnectWithRetries();
+  } catch (...) {
+    ReleaseConnectionSlot();
+    throw;
+  }
+}
+
+bool SSHClient::ReserveConnectionSlot() {
+  if (params.max_connections == 0) {
+    return false;
+  }
+  auto &budget = GetConnectionBudget(params);
+  std::unique_lock<std::mutex> lock(budget.mutex);
+  auto has_slot = [&] { return budget.open < params.max_connections; };
+  if (!budget.cv.wait_for(lock, std::chrono::seconds(params.timeout_seconds),
+                          has_slot)) {
+    throw IOException(
+        "Transient: all %llu connections MAX_CONNECTIONS allows to %s are in "
+        "use\n"
+        "  → Connections of replaced pools close once their files are closed",
+        static_cast<unsigned long long>(params.max_connections),
+        params.hostname.c_str());
+  }
+  budget.open++;
+  return true;
+}
+
+void SSHClient::ReleaseConnectionSlot() {
+  if (!holds_connection_slot) {
+    return;
+  }
+  FreeConnectionSlot(params);
+  holds_connection_slot = false;
+}
+
+void SSHClient::ConnectWithRetries() {
   int retry_delay_ms = params.initial_retry_delay_ms;
   int attempt = 0;
   std::string last_error;
@@ -93,7 +350,11 @@ void SSHClient::Connect() {
                           strerror(errno));
       }
 
-      // Connect
+      // Buffer sizes must be set before connect to affect TCP window scaling
+      ConfigureSocket();
+
+      // Connect (its duration approximates one round trip)
+      auto connect_start = std::chrono::steady_clock::now();
       if (connect(sock, res->ai_addr, res->ai_addrlen) != 0) {
         int err = errno;
         close(sock);
@@ -121,6 +382,14 @@ void SSHClient::Connect() {
       }
 
       freeaddrinfo(res);
+      connect_rtt_us = std::chrono::duration_cast<std::chrono::microseconds>(
+                           std::chrono::steady_clock::now() - connect_start)
+                           .count();
+      channel_window = ComputeChannelWindow();
+      SSHFS_LOG("  [CONNECT] TCP connect took " << connect_rtt_us
+                                                << "us, channel window "
+                                                << channel_window / 1024
+                                                << "KB");
 
       // Initialize SSH session
       InitializeSession();
@@ -130,6 +399,9 @@ void SSHClient::Connect() {
       DetectCapabilities();
 
       connected = true;
+      connected_at = std::chrono::steady_clock::now().time_since_epoch().count();
+      Touch();
+      SSHFSHostStats::Add(stats->connects, 1);
       if (attempt > 0) {
         SSHFS_LOG("  [RETRY] Connection successful on attempt " << attempt + 1);
       }
@@ -167,6 +439,62 @@ void SSHClient::Connect() {
   }
 }
 
+void SSHClient::ConfigureSocket() {
+  if (params.tcp_nodelay) {
+    // SFTP requests are small and latency bound - don't hold them back
+    int flag = 1;
+    setsockopt(sock, IPPROTO_TCP, TCP_NODELAY, &flag, sizeof(flag));
+  }
+  if (params.socket_buffer_size > 0) {
+    // Fixed buffers turn off the kernel's autotuning, so only when asked
+    int size = static_cast<int>(
+        std::min<size_t>(params.socket_buffer_size, INT_MAX));
+    if (setsockopt(sock, SOL_SOCKET, SO_SNDBUF, &size, sizeof(size)) != 0 ||
+        setsockopt(sock, SOL_SOCKET, SO_RCVBUF, &size, sizeof(size)) != 0) {
+      SSHFS_LOG("  [CONNECT] Failed to set socket buffers to "
+                << size << " bytes: " << strerror(errno));
+    }
+  }
+}
+
+uint32_t SSHClient::ComputeChannelWindow() const {
+  const uint64_t MAX_WINDOW = 256ULL * 1024 * 1024;
+  if (params.channel_window_size > 0) {
+    return static_cast<uint32_t>(std::min<uint64_t>(
+        std::max<uint64_t>(params.channel_window_size, 64 * 1024),
+        MAX_WINDOW));
+  }
+  // Auto: the bandwidth-delay product of a 1 Gbit/s link (125 bytes/us) at
+  // the measured round trip, and at least what the read pipeline keeps in
+  // flight. Capped at 64MB - libssh2 buffers up to a window of unread data
+  // per channel.
+  const uint64_t AUTO_MAX_WINDOW = 64ULL * 1024 * 1024;
+  uint64_t bdp = static_cast<uint64_t>(std::max<int64_t>(0, connect_rtt_us)) *
+                 125;
+  uint64_t in_flight = params.read_window;
+  uint64_t window = std::max<uint64_t>(
+      {bdp, in_flight, uint64_t(LIBSSH2_CHANNEL_WINDOW_DEFAULT)});
+  return static_cast<uint32_t>(std::min(window, AUTO_MAX_WINDOW));
+}
+
+LIBSSH2_CHANNEL *SSHClient::OpenSessionChannel() {
+  static const char CHANNEL_TYPE[] = "session";
+  return libssh2_channel_open_ex(session, CHANNEL_TYPE,
+                                 sizeof(CHANNEL_TYPE) - 1, channel_window,
+                                 LIBSSH2_CHANNEL_PACKET_DEFAULT, nullptr, 0);
+}
+
+void SSHClient::TuneSFTPWindow(LIBSSH2_SFTP *sftp) {
+  if (channel_window <= LIBSSH2_CHANNEL_WINDOW_DEFAULT) {
+    return;
+  }
+  // libssh2's SFTP reads widen the window for their read-ahead later on;
+  // this covers the first round trips of every handle
+  libssh2_channel_receive_window_adjust2(
+      libssh2_sftp_get_channel(sftp),
+      channel_window - LIBSSH2_CHANNEL_WINDOW_DEFAULT, 1, nullptr);
+}
+
 void SSHClient::InitializeSession() {
   session = libssh2_session_init();
   if (!session) {
@@ -244,6 +572,71 @@ void SSHClient::InitializeSession() {
     SSHFS_LOG("  [HOSTKEY] Set host key preferences: " << hostkey_algorithms);
   }
 
+  // Cipher and MAC order (sshfs_cipher_preference)
+  if (params.cipher_preference != "default") {
+    std::string ciphers;
+    std::string macs = THROUGHPUT_MACS;
+    if (params.cipher_preference == "throughput") {
+      ciphers = PreferAesGcm() ? std::string(AES_GCM_CIPHERS) + "," +
+                                     CHACHA_CIPHERS
+                               : std::string(CHACHA_CIPHERS) + "," +
+                                     AES_GCM_CIPHERS;
+      ciphers += std::string(",") + AES_CTR_CIPHERS;
+    } else if (params.cipher_preference == "compat") {
+      ciphers = std::string(AES_CTR_CIPHERS) + "," + AES_GCM_CIPHERS + "," +
+                CHACHA_CIPHERS + "," + CBC_CIPHERS;
+      macs = COMPAT_MACS;
+    } else {
+      ciphers = params.cipher_preference;
+    }
+    if (params.strict_crypto) {
+      ciphers = WithoutLegacyAlgorithms(ciphers);
+      macs = WithoutLegacyAlgorithms(macs);
+    }
+
+    int cs_rc = libssh2_session_method_pref(session, LIBSSH2_METHOD_CRYPT_CS,
+                                            ciphers.c_str());
+    int sc_rc = libssh2_session_method_pref(session, LIBSSH2_METHOD_CRYPT_SC,
+                                            ciphers.c_str());
+    if (cs_rc != 0 || sc_rc != 0) {
+      CleanupSession();
+      // A settings problem - don't retry the connection
+      throw InvalidInputException(
+          "None of the ciphers '%s' is supported by this libssh2 build\n"
+          "  → Check sshfs_cipher_preference%s\n"
+          "  → Or use: SET sshfs_cipher_preference = 'default'",
+          ciphers, params.strict_crypto ? " (sshfs_strict_crypto removes "
+                                          "CBC and 3DES ciphers)"
+                                        : "");
+    }
+    // Explicit cipher lists keep libssh2's MAC order
+    if (params.cipher_preference == "throughput" ||
+        params.cipher_preference == "compat") {
+      libssh2_session_method_pref(session, LIBSSH2_METHOD_MAC_CS,
+                                  macs.c_str());
+      libssh2_session_method_pref(session, LIBSSH2_METHOD_MAC_SC,
+                                  macs.c_str());
+    }
+    SSHFS_LOG("  [CRYPT] Set cipher preferences: " << ciphers);
+  }
+
+  // Transport compression (sshfs_compression = 'ssh') - negotiated during the
+  // handshake, "none" stays acceptable for servers that disabled it
+  if (params.compression == SSHCompression::SSH) {
+    const char *comp_methods = "zlib@openssh.com,zlib,none";
+    libssh2_session_flag(session, LIBSSH2_FLAG_COMPRESS, 1);
+    int cs_rc = libssh2_session_method_pref(session, LIBSSH2_METHOD_COMP_CS,
+                                            comp_methods);
+    int sc_rc = libssh2_session_method_pref(session, LIBSSH2_METHOD_COMP_SC,
+                                            comp_methods);
+    if (cs_rc != 0 || sc_rc != 0) {
+      SSHFS_LOG("  [COMPRESS] Warning: Could not enable compression (rc="
+                << cs_rc << "/" << sc_rc << ")");
+    } else {
+      SSHFS_LOG("  [COMPRESS] Requested compression: " << comp_methods);
+    }
+  }
+
   // Enable libssh2 protocol-level trace when debug logging is on
   if (IsDebugLoggingEnabled()) {
     libssh2_trace(session, ~0);
@@ -439,25 +832,9 @@ void SSHClient::Authenticate() {
                         params.port);
     }
 
-    struct libssh2_agent_publickey *identity = nullptr;
-    struct libssh2_agent_publickey *prev = nullptr;
-    bool agent_auth_success = false;
-
-    // Try each identity from the agent
-    while (libssh2_agent_get_identity(agent, &identity, prev) == 0) {
-      if (libssh2_agent_userauth(agent, params.username.c_str(), identity) ==
-          0) {
-        // Success! Clean up agent and return
-        libssh2_agent_disconnect(agent);
-        libssh2_agent_free(agent);
-        SSHFS_LOG("  [AUTH] SSH agent authentication succeeded");
-        agent_auth_success = true;
-        break;
-      }
-      prev = identity;
-    }
-
-    if (agent_auth_success) {
+    if (AuthenticateWithAgent(agent)) {
+      libssh2_agent_disconnect(agent);
+      libssh2_agent_free(agent);
       return;
     }
 
@@ -485,22 +862,11 @@ void SSHClient::Authenticate() {
     LIBSSH2_AGENT *agent = libssh2_agent_init(session);
     if (agent) {
       if (libssh2_agent_connect(agent) == 0) {
-        if (libssh2_agent_list_identities(agent) == 0) {
-          struct libssh2_agent_publickey *identity = nullptr;
-          struct libssh2_agent_publickey *prev = nullptr;
-
-          // Try each identity from the agent
-          while (libssh2_agent_get_identity(agent, &identity, prev) == 0) {
-            if (libssh2_agent_userauth(agent, params.username.c_str(),
-                                       identity) == 0) {
-              // Success! Clean up agent and return
-              libssh2_agent_disconnect(agent);
-              libssh2_agent_free(agent);
-              SSHFS_LOG("  [AUTH] SSH agent authentication succeeded");
-              return;
-            }
-            prev = identity;
-          }
+        if (libssh2_agent_list_identities(agent) == 0 &&
+            AuthenticateWithAgent(agent)) {
+          libssh2_agent_disconnect(agent);
+          libssh2_agent_free(agent);
+          return;
         }
         libssh2_agent_disconnect(agent);
       }
@@ -535,6 +901,49 @@ void SSHClient::Authenticate() {
                     err_msg ? err_msg : "Unknown error", rc);
 }
 
+bool SSHClient::AuthenticateWithAgent(LIBSSH2_AGENT *agent) {
+  auto identity_blob = [](struct libssh2_agent_publickey *identity) {
+    return std::string(reinterpret_cast<const char *>(identity->blob),
+                       identity->blob_len);
+  };
+  // Agents often hold many keys and servers drop the connection after a few
+  // rejected ones - start with the identity that worked last time
+  std::string cached = LoadServerProfile(params).agent_identity;
+
+  struct libssh2_agent_publickey *identity = nullptr;
+  struct libssh2_agent_publickey *prev = nullptr;
+  if (!cached.empty()) {
+    while (libssh2_agent_get_identity(agent, &identity, prev) == 0) {
+      if (identity_blob(identity) == cached) {
+        if (libssh2_agent_userauth(agent, params.username.c_str(), identity) ==
+            0) {
+          SSHFS_LOG("  [AUTH] SSH agent authentication succeeded (cached "
+                    "identity)");
+          return true;
+        }
+        break;
+      }
+      prev = identity;
+    }
+  }
+
+  // Try each identity from the agent
+  prev = nullptr;
+  while (libssh2_agent_get_identity(agent, &identity, prev) == 0) {
+    std::string blob = identity_blob(identity);
+    if (blob != cached &&
+        libssh2_agent_userauth(agent, params.username.c_str(), identity) == 0) {
+      SSHFS_LOG("  [AUTH] SSH agent authentication succeeded");
+      UpdateServerProfile(params, [&blob](SSHServerProfile &profile) {
+        profile.agent_identity = blob;
+      });
+      return true;
+    }
+    prev = identity;
+  }
+  return false;
+}
+
 void SSHClient::Disconnect() {
   if (!connected) {
     return;
@@ -543,6 +952,67 @@ void SSHClient::Disconnect() {
   CleanupSFTPPool();
   CleanupSession();
   connected = false;
+  ReleaseConnectionSlot();
+}
+
+bool SSHClient::DisconnectIfIdle() {
+  std::unique_lock<std::mutex> connect_lock(connect_mutex, std::try_to_lock);
+  if (!connect_lock.owns_lock() || !connected) {
+    return false;
+  }
+  {
+    // The single SFTP session is out while someone uses the connection;
+    // holding pool_mutex keeps new borrowers out until we are done
+    std::lock_guard<std::mutex> lock(pool_mutex);
+    if (pool_initialized && sftp_pool.empty()) {
+      return false;
+    }
+    CloseCachedHandles();
+    while (!sftp_pool.empty()) {
+      libssh2_sftp_shutdown(sftp_pool.front());
+      sftp_pool.pop();
+    }
+    pool_initialized = false;
+    CleanupSession();
+    connected = false;
+  }
+  ReleaseConnectionSlot();
+  return true;
+}
+
+bool SSHClient::HasConnectionSlot() const {
+  if (params.max_connections == 0) {
+    return true;
+  }
+  auto &budget = GetConnectionBudget(params);
+  std::lock_guard<std::mutex> lock(budget.mutex);
+  return budget.open < params.max_connections;
+}
+
+bool SSHClient::IsSocketClosed() const {
+  int fd = sock;
+  if (fd == -1) {
+    return true;
+  }
+  // Peeking leaves pending data to libssh2; 0 means the peer sent FIN
+  char byte;
+  ssize_t rc = recv(fd, &byte, 1, MSG_PEEK | MSG_DONTWAIT);
+  return rc == 0 || (rc < 0 && errno != EAGAIN && errno != EWOULDBLOCK &&
+                     errno != EINTR);
+}
+
+void SSHClient::Touch() {
+  last_used = std::chrono::steady_clock::now().time_since_epoch().count();
+}
+
+std::chrono::steady_clock::duration SSHClient::GetIdleTime() const {
+  return std::chrono::steady_clock::now().time_since_epoch() -
+         std::chrono::steady_clock::duration(last_used.load());
+}
+
+std::chrono::steady_clock::duration SSHClient::GetConnectionAge() const {
+  return std::chrono::steady_clock::now().time_since_epoch() -
+         std::chrono::steady_clock::duration(connected_at.load());
 }
 
 bool SSHClient::ValidateConnection() {
@@ -570,7 +1040,7 @@ void SSHClient::CleanupSession() {
   }
 }
 
-std::string SSHClient::ExecuteCommand(const std::string &command) {
+LIBSSH2_CHANNEL *SSHClient::OpenExecChannel(const std::string &command) {
   if (!connected) {
     throw IOException(
         "Not connected to SSH server\n"
@@ -581,7 +1051,7 @@ std::string SSHClient::ExecuteCommand(const std::string &command) {
   }
 
   // Open channel
-  LIBSSH2_CHANNEL *channel = libssh2_channel_open_session(session);
+  LIBSSH2_CHANNEL *channel = OpenSessionChannel();
   if (!channel) {
     char *err_msg;
     int err_code = libssh2_session_last_error(session, &err_msg, nullptr, 0);
@@ -608,110 +1078,201 @@ std::string SSHClient::ExecuteCommand(const std::string &command) {
                       params.username.c_str(), params.hostname.c_str(),
                       command.c_str());
   }
+  return channel;
+}
+
+std::unique_ptr<SSHExecStream>
+SSHClient::OpenExecStream(const std::string &command, bool gzip) {
+  return std::unique_ptr<SSHExecStream>(
+      new SSHExecStream(OpenExecChannel(command), gzip));
+}
+
+std::string SSHClient::ExecuteCommand(const std::string &command) {
+  auto stream = OpenExecStream(command);
 
   // Read output
-  std::stringstream output;
+  std::string output;
   char buffer[4096];
-  ssize_t nbytes;
-
-  while ((nbytes = libssh2_channel_read(channel, buffer, sizeof(buffer))) > 0) {
-    output.write(buffer, nbytes);
+  size_t nbytes;
+  while ((nbytes = stream->Read(buffer, sizeof(buffer))) > 0) {
+    output.append(buffer, nbytes);
   }
 
-  // Get exit status
-  int exit_status = libssh2_channel_get_exit_status(channel);
-
-  // Close channel
-  libssh2_channel_close(channel);
-  libssh2_channel_wait_closed(channel);
-  libssh2_channel_free(channel);
-
+  int exit_status = stream->Finish();
   if (exit_status != 0) {
     throw IOException("Command failed with exit status %d: %s", exit_status,
                       command);
   }
 
-  return output.str();
+  return output;
 }
 
-void SSHClient::UploadChunk(const std::string &remote_path, const char *data,
-                            size_t size, bool append) {
-  if (!connected) {
-    throw IOException("Not connected to SSH server");
-  }
+int SSHClient::ExecuteCommandLines(
+    const std::string &command,
+    const std::function<bool(const std::string &)> &on_line) {
+  auto stream = OpenExecStream(command);
 
-  ScopedTimer total_timer("SFTP", append ? "Append data" : "Total upload");
+  // Only the line being assembled is kept, whatever the size of the output
+  std::string line;
+  while (stream->ReadLine(line)) {
+    if (!on_line(line)) {
+      return -1;
+    }
+  }
+  return stream->Finish();
+}
 
-  // Lock per-client mutex to serialize SFTP operations (libssh2 session is not
-  // thread-safe)
-  std::lock_guard<std::mutex> lock(upload_mutex);
+SSHExecStream::SSHExecStream(LIBSSH2_CHANNEL *channel, bool gzip)
+    : channel(channel), buffer(BUFFER_SIZE) {
+  if (gzip) {
+    decoder.reset(new GzipStreamDecoder());
+    compressed.resize(BUFFER_SIZE);
+  }
+}
 
-  // Borrow SFTP session from pool
-  LIBSSH2_SFTP *sftp = BorrowSFTPSession();
+SSHExecStream::~SSHExecStream() {
+  if (!finished && !eof) {
+    // Stopped early - the command may still be writing, so don't wait for
+    // its EOF
+    libssh2_channel_close(channel);
+  } else if (!finished) {
+    libssh2_channel_close(channel);
+    libssh2_channel_wait_closed(channel);
+  }
+  libssh2_channel_free(channel);
+}
 
-  // Create parent directories if needed
-  {
-    ScopedTimer mkdir_timer("SFTP", "Create dirs");
-    size_t last_slash = remote_path.find_last_of('/');
-    if (last_slash != std::string::npos) {
-      std::string dir_path = remote_path.substr(0, last_slash);
-      if (!dir_path.empty()) {
-        // Create directories recursively
-        std::string current_path;
-        size_t pos = 0;
-        while (pos < dir_path.length()) {
-          size_t next_slash = dir_path.find('/', pos);
-          if (next_slash == std::string::npos) {
-            next_slash = dir_path.length();
-          }
+size_t SSHExecStream::ReadChannel(char *out, size_t size) {
+  ssize_t nread = libssh2_channel_read(channel, out, size);
+  if (nread < 0) {
+    if (nread == LIBSSH2_ERROR_TIMEOUT ||
+        nread == LIBSSH2_ERROR_SOCKET_DISCONNECT ||
+        nread == LIBSSH2_ERROR_SOCKET_SEND ||
+        nread == LIBSSH2_ERROR_SOCKET_RECV) {
+      throw IOException("Transient SSH channel error: %zd", nread);
+    }
+    throw IOException("Failed to read command output (libssh2 error: %zd)",
+                      nread);
+  }
+  return static_cast<size_t>(nread);
+}
 
-          if (next_slash > pos) {
-            if (!current_path.empty()) {
-              current_path += "/";
-            }
-            current_path += dir_path.substr(pos, next_slash - pos);
-
-            // Try to create this directory (ignore errors if it exists)
-            libssh2_sftp_mkdir(sftp, current_path.c_str(),
-                               LIBSSH2_SFTP_S_IRWXU | LIBSSH2_SFTP_S_IRGRP |
-                                   LIBSSH2_SFTP_S_IXGRP | LIBSSH2_SFTP_S_IROTH |
-                                   LIBSSH2_SFTP_S_IXOTH);
-          }
+bool SSHExecStream::Fill() {
+  buffer_pos = 0;
+  buffer_end = 0;
+  while (!eof && buffer_end == 0) {
+    if (!decoder) {
+      buffer_end = ReadChannel(buffer.data(), buffer.size());
+      eof = buffer_end == 0;
+      continue;
+    }
 
-          pos = next_slash + 1;
-        }
+    if (compressed_pos == compressed_end) {
+      compressed_pos = 0;
+      compressed_end = ReadChannel(compressed.data(), compressed.size());
+      if (compressed_end == 0) {
+        eof = true;
+        break;
+      }
+    }
+    size_t consumed;
+    if (!decoder->Decode(compressed.data() + compressed_pos,
+                         compressed_end - compressed_pos, buffer.data(),
+                         buffer.size(), buffer_end, &consumed)) {
+      throw IOException("Corrupt gzip stream in command output");
+    }
+    compressed_pos += consumed;
+    if (decoder->IsFinished() && buffer_end == 0) {
+      // Drain what follows the trailer, so the exit status is available
+      while (ReadChannel(compressed.data(), compressed.size()) > 0) {
       }
+      compressed_pos = compressed_end = 0;
+      eof = true;
     }
   }
+  return buffer_end > 0;
+}
 
-  // Open remote file for writing
-  LIBSSH2_SFTP_HANDLE *sftp_handle;
-  {
-    ScopedTimer open_timer("SFTP", append ? "Open for append" : "Open file");
+size_t SSHExecStream::Read(char *out, size_t size) {
+  if (buffer_pos == buffer_end) {
+    if (!decoder && size >= buffer.size() && !eof) {
+      // Large reads go straight into the caller's buffer
+      size_t nread = ReadChannel(out, size);
+      eof = nread == 0;
+      return nread;
+    }
+    if (!Fill()) {
+      return 0;
+    }
+  }
+  size_t count = std::min(size, buffer_end - buffer_pos);
+  memcpy(out, buffer.data() + buffer_pos, count);
+  buffer_pos += count;
+  return count;
+}
 
-    // Choose flags based on append mode
-    unsigned long flags;
-    if (append) {
-      // Append to existing file (fail if file doesn't exist)
-      flags = LIBSSH2_FXF_WRITE | LIBSSH2_FXF_APPEND;
-    } else {
-      // Create new file or truncate existing
-      flags = LIBSSH2_FXF_WRITE | LIBSSH2_FXF_CREAT | LIBSSH2_FXF_TRUNC;
+bool SSHExecStream::ReadLine(std::string &line) {
+  line.clear();
+  bool any = false;
+  while (true) {
+    if (buffer_pos == buffer_end && !Fill()) {
+      return any;
     }
+    any = true;
+    const char *start = buffer.data() + buffer_pos;
+    auto newline = static_cast<const char *>(
+        memchr(start, '\n', buffer_end - buffer_pos));
+    if (newline) {
+      line.append(start, newline - start);
+      buffer_pos += newline - start + 1;
+      return true;
+    }
+    line.append(start, buffer_end - buffer_pos);
+    buffer_pos = buffer_end;
+  }
+}
 
-    sftp_handle =
-        libssh2_sftp_open(sftp, remote_path.c_str(), flags,
-                          LIBSSH2_SFTP_S_IRUSR | LIBSSH2_SFTP_S_IWUSR |
-                              LIBSSH2_SFTP_S_IRGRP | LIBSSH2_SFTP_S_IROTH);
+int SSHExecStream::Finish() {
+  if (finished) {
+    return exit_status;
+  }
+  while (Fill()) {
+  }
+  exit_status = libssh2_channel_get_exit_status(channel);
+  libssh2_channel_close(channel);
+  libssh2_channel_wait_closed(channel);
+  finished = true;
+  return exit_status;
+}
 
-    if (!sftp_handle) {
-      ReturnSFTPSession(sftp);
-      throw IOException("Failed to open remote file for %s: %s",
-                        append ? "appending" : "writing", remote_path);
-    }
+void SSHClient::UploadChunk(const std::string &remote_path, const char *data,
+                            size_t size, uint64_t offset, bool truncate,
+                            size_t *bytes_confirmed) {
+  if (!connected) {
+    throw IOException("Not connected to SSH server");
+  }
+
+  ScopedTimer total_timer("SFTP", truncate ? "Total upload" : "Write chunk");
+
+  // Borrow SFTP session from pool - this serializes SFTP operations on this
+  // client (libssh2 session is not thread-safe)
+  LIBSSH2_SFTP *sftp = BorrowSFTPSession();
+  std::lock_guard<std::mutex> lock(write_mutex);
+
+  // Reuse the handle earlier chunks of this file opened on this connection
+  LIBSSH2_SFTP_HANDLE *sftp_handle;
+  try {
+    sftp_handle = AcquireWriteHandle(sftp, remote_path, truncate);
+  } catch (...) {
+    ReturnSFTPSession(sftp);
+    throw;
   }
 
-  // Write all data - let libssh2 handle internal buffering
+  // Chunks are written at their own offset, not appended
+  libssh2_sftp_seek64(sftp_handle, offset);
+
+  // Write all data - libssh2 splits the buffer into SFTP WRITE packets and
+  // keeps them in flight before collecting the acknowledgements
   {
     ThroughputTimer write_timer("SFTP", "Write", size);
     size_t total_written = 0;
@@ -724,8 +1285,19 @@ void SSHClient::UploadChunk(const std::string &remote_path, const char *data,
       if (written < 0) {
         char *err_msg;
         libssh2_session_last_error(session, &err_msg, nullptr, 0);
-        libssh2_sftp_close(sftp_handle);
+        CloseWriteHandleLocked(remote_path);
         ReturnSFTPSession(sftp);
+
+        // Check if this is a transient error worth retrying - everything
+        // acknowledged so far is on the server
+        if (written == LIBSSH2_ERROR_TIMEOUT ||
+            written == LIBSSH2_ERROR_SOCKET_DISCONNECT ||
+            written == LIBSSH2_ERROR_SOCKET_SEND ||
+            written == LIBSSH2_ERROR_SOCKET_RECV) {
+          throw IOException("Transient SFTP write error: %s (libssh2 error "
+                            "%d, %zu/%zu bytes confirmed)",
+                            remote_path, (int)written, total_written, size);
+        }
         throw IOException(
             "Failed to write to remote file: %s (libssh2 error %d: %s)",
             remote_path, (int)written, err_msg ? err_msg : "Unknown error");
@@ -733,99 +1305,332 @@ void SSHClient::UploadChunk(const std::string &remote_path, const char *data,
 
       if (written == 0) {
         // No progress - this shouldn't happen in blocking mode
-        libssh2_sftp_close(sftp_handle);
+        CloseWriteHandleLocked(remote_path);
         ReturnSFTPSession(sftp);
         throw IOException("SFTP write stalled at %zu/%zu bytes for: %s",
                           total_written, size, remote_path);
       }
 
       total_written += written;
+      if (bytes_confirmed) {
+        *bytes_confirmed = total_written;
+      }
     }
   }
 
-  // Close file and return SFTP session to pool
-  {
-    ScopedTimer close_timer("SFTP", "Close handle");
-    libssh2_sftp_close(sftp_handle);
-  }
-
-  // Return SFTP session to pool for reuse
+  // The handle stays open for the next chunk - see CloseWriteHandle
   ReturnSFTPSession(sftp);
 }
 
-void SSHClient::RemoveFile(const std::string &remote_path) {
-  if (!connected) {
-    throw IOException(
-        "Not connected to SSH server\n"
-        "  → Connection may have been closed or timed out\n"
-        "  → Try reconnecting or check keepalive_interval setting");
+bool SSHClient::RemoteChecksum(const std::string &remote_path,
+                               uint64_t offset, size_t length,
+                               std::string &sha256_hex) {
+  if (!connected || !supports_commands) {
+    return false;
   }
 
-  // Use SFTP exclusively (avoids command injection via remote_path)
-  LIBSSH2_SFTP *sftp = libssh2_sftp_init(session);
-  if (!sftp) {
-    char *err_msg;
-    int err_code = libssh2_session_last_error(session, &err_msg, nullptr, 0);
-    throw IOException("Failed to initialize SFTP session for file removal: %s\n"
-                      "  → libssh2 error: %s (code: %d)\n"
-                      "  → Try: ssh -p %d %s@%s 'ls -la %s'",
-                      remote_path.c_str(), err_msg, err_code, params.port,
-                      params.username.c_str(), params.hostname.c_str(),
-                      remote_path.c_str());
-  }
+  std::string command = "dd if=" + ShellQuote(remote_path) + " bs=1M" +
+                        " iflag=skip_bytes,count_bytes" +
+                        " skip=" + std::to_string(offset) +
+                        " count=" + std::to_string(length) +
+                        " status=none 2>/dev/null | sha256sum";
 
-  // Remove file via SFTP
-  int rc = libssh2_sftp_unlink(sftp, remote_path.c_str());
-  libssh2_sftp_shutdown(sftp);
+  std::string output;
+  {
+    // The SFTP session doubles as the lock on this libssh2 session
+    LIBSSH2_SFTP *sftp = BorrowSFTPSession();
+    try {
+      output = ExecuteCommand(command);
+    } catch (const std::exception &e) {
+      ReturnSFTPSession(sftp);
+      SSHFS_LOG("  [VERIFY] sha256sum failed, skipping verification: "
+                << e.what());
+      return false;
+    }
+    ReturnSFTPSession(sftp);
+  }
 
-  if (rc != 0) {
-    throw IOException("Failed to remove remote file: %s", remote_path);
+  // "<64 hex digits>  -"
+  if (output.size() < 64 ||
+      output.find_first_not_of("0123456789abcdef") < 64) {
+    return false;
   }
+  sha256_hex = output.substr(0, 64);
+  return true;
 }
 
-void SSHClient::RenameFile(const std::string &source_path,
-                           const std::string &target_path) {
-  if (!connected) {
-    throw IOException(
-        "Not connected to SSH server\n"
-        "  → Connection may have been closed or timed out\n"
-        "  → Try reconnecting or check keepalive_interval setting");
+void SSHClient::CloseWriteHandle(const std::string &remote_path) {
+  {
+    std::lock_guard<std::mutex> lock(write_mutex);
+    if (write_handles.find(remote_path) == write_handles.end()) {
+      return;
+    }
   }
 
-  // Use SFTP exclusively (avoids command injection via paths)
-  LIBSSH2_SFTP *sftp = libssh2_sftp_init(session);
-  if (!sftp) {
-    char *err_msg;
-    int err_code = libssh2_session_last_error(session, &err_msg, nullptr, 0);
-    throw IOException("Failed to initialize SFTP session for rename: %s → %s\n"
-                      "  → libssh2 error: %s (code: %d)\n"
-                      "  → Try: ssh -p %d %s@%s 'mv %s %s'",
-                      source_path.c_str(), target_path.c_str(), err_msg,
-                      err_code, params.port, params.username.c_str(),
-                      params.hostname.c_str(), source_path.c_str(),
-                      target_path.c_str());
+  LIBSSH2_SFTP *sftp = BorrowSFTPSession();
+  {
+    std::lock_guard<std::mutex> lock(write_mutex);
+    ScopedTimer close_timer("SFTP", "Close handle");
+    CloseWriteHandleLocked(remote_path);
   }
+  ReturnSFTPSession(sftp);
+}
 
-  // Rename file via SFTP
-  // LIBSSH2_SFTP_RENAME_OVERWRITE flag ensures atomic rename behavior
-  int rc = libssh2_sftp_rename_ex(
-      sftp, source_path.c_str(), source_path.length(), target_path.c_str(),
-      target_path.length(),
-      LIBSSH2_SFTP_RENAME_OVERWRITE | LIBSSH2_SFTP_RENAME_ATOMIC);
-  libssh2_sftp_shutdown(sftp);
+void SSHClient::ForgetKnownDirectories() {
+  std::lock_guard<std::mutex> lock(write_mutex);
+  known_directories.clear();
+}
 
-  if (rc != 0) {
-    unsigned long sftp_error = libssh2_sftp_last_error(sftp);
+LIBSSH2_SFTP_HANDLE *
+SSHClient::AcquireWriteHandle(LIBSSH2_SFTP *sftp,
+                              const std::string &remote_path, bool truncate) {
+  auto it = write_handles.find(remote_path);
+  if (it != write_handles.end()) {
+    if (!truncate) {
+      return it->second;
+    }
+    // File is being recreated - reopen it with O_TRUNC
+    CloseWriteHandleLocked(remote_path);
+  }
+
+  // Bound the number of open handles on the server - an evicted file is
+  // simply reopened by its next chunk
+  if (write_handles.size() >= MAX_WRITE_HANDLES) {
+    CloseWriteHandleLocked(write_handles.begin()->first);
+  }
+
+  ScopedTimer open_timer("SFTP", "Open file");
+
+  // Create new file or truncate existing. Otherwise write into the existing
+  // file; other chunks may be written at the same time on other sessions
+  // (fail if file doesn't exist)
+  unsigned long flags =
+      truncate ? LIBSSH2_FXF_WRITE | LIBSSH2_FXF_CREAT | LIBSSH2_FXF_TRUNC
+               : LIBSSH2_FXF_WRITE;
+  auto open_file = [&]() {
+    SSHFSHostStats::Add(stats->handle_opens, 1);
+    return libssh2_sftp_open(sftp, remote_path.c_str(), flags,
+                             LIBSSH2_SFTP_S_IRUSR | LIBSSH2_SFTP_S_IWUSR |
+                                 LIBSSH2_SFTP_S_IRGRP | LIBSSH2_SFTP_S_IROTH);
+  };
+
+  LIBSSH2_SFTP_HANDLE *handle = nullptr;
+  if (truncate) {
+    // Create parent directories if needed (once per directory and
+    // connection)
+    CreateParentDirectories(sftp, remote_path);
+    handle = open_file();
+    if (!handle && !known_directories.empty()) {
+      // A directory we created may have been removed by someone else
+      known_directories.clear();
+      CreateParentDirectories(sftp, remote_path);
+      handle = open_file();
+    }
+  } else {
+    handle = open_file();
+  }
+
+  if (!handle) {
+    throw IOException("Failed to open remote file for writing: %s\n"
+                      "  → SFTP error code: %lu\n"
+                      "  → Check that the directory exists and is writable",
+                      remote_path, libssh2_sftp_last_error(sftp));
+  }
+  write_handles[remote_path] = handle;
+  return handle;
+}
+
+void SSHClient::CloseWriteHandleLocked(const std::string &remote_path) {
+  auto it = write_handles.find(remote_path);
+  if (it == write_handles.end()) {
+    return;
+  }
+  libssh2_sftp_close(it->second);
+  write_handles.erase(it);
+}
+
+void SSHClient::CreateParentDirectories(LIBSSH2_SFTP *sftp,
+                                        const std::string &remote_path) {
+  ScopedTimer mkdir_timer("SFTP", "Create dirs");
+  size_t last_slash = remote_path.find_last_of('/');
+  if (last_slash == std::string::npos || last_slash == 0) {
+    return;
+  }
+  std::string dir_path = remote_path.substr(0, last_slash);
+  if (known_directories.count(dir_path) > 0) {
+    return;
+  }
+
+  // Try to create every level (ignore errors if it exists), keeping the
+  // leading slash of absolute paths
+  size_t pos = dir_path[0] == '/' ? 1 : 0;
+  while (pos <= dir_path.length()) {
+    size_t next_slash = dir_path.find('/', pos);
+    if (next_slash == std::string::npos) {
+      next_slash = dir_path.length();
+    }
+    if (next_slash > pos) {
+      std::string current_path = dir_path.substr(0, next_slash);
+      if (known_directories.count(current_path) == 0) {
+        libssh2_sftp_mkdir(sftp, current_path.c_str(),
+                           LIBSSH2_SFTP_S_IRWXU | LIBSSH2_SFTP_S_IRGRP |
+                               LIBSSH2_SFTP_S_IXGRP | LIBSSH2_SFTP_S_IROTH |
+                               LIBSSH2_SFTP_S_IXOTH);
+        known_directories.insert(current_path);
+      }
+    }
+    pos = next_slash + 1;
+  }
+}
+
+void SSHClient::RemoveFile(const std::string &remote_path) {
+  if (!connected) {
+    Connect();
+  }
+
+  // Use SFTP exclusively (avoids command injection via remote_path). The
+  // pooled session keeps other users of this connection out meanwhile.
+  SFTPSessionGuard guard(*this);
+  if (libssh2_sftp_unlink(guard.Get(), remote_path.c_str()) != 0) {
+    throw IOException("Failed to remove remote file: %s\n"
+                      "  → SFTP error code: %lu\n"
+                      "  → Try: ssh -p %d %s@%s 'ls -la %s'",
+                      remote_path.c_str(),
+                      libssh2_sftp_last_error(guard.Get()), params.port,
+                      params.username.c_str(), params.hostname.c_str(),
+                      remote_path.c_str());
+  }
+}
+
+void SSHClient::RenameFile(const std::string &source_path,
+                           const std::string &target_path) {
+  if (!connected) {
+    Connect();
+  }
+
+  // Use SFTP exclusively (avoids command injection via paths)
+  SFTPSessionGuard guard(*this);
+  LIBSSH2_SFTP *sftp = guard.Get();
+
+  int rc = -1;
+#if LIBSSH2_VERSION_NUM >= 0x010b00
+  // posix-rename@openssh.com replaces an existing target atomically
+  rc = libssh2_sftp_posix_rename_ex(sftp, source_path.c_str(),
+                                    source_path.length(), target_path.c_str(),
+                                    target_path.length());
+#endif
+  if (rc != 0) {
+    // Rename file via SFTP
+    // LIBSSH2_SFTP_RENAME_OVERWRITE flag ensures atomic rename behavior
+    // (honored by SFTP v5+ servers only)
+    rc = libssh2_sftp_rename_ex(
+        sftp, source_path.c_str(), source_path.length(), target_path.c_str(),
+        target_path.length(),
+        LIBSSH2_SFTP_RENAME_OVERWRITE | LIBSSH2_SFTP_RENAME_ATOMIC);
+  }
+  if (rc != 0 && libssh2_sftp_last_error(sftp) != LIBSSH2_FX_NO_SUCH_FILE) {
+    // SFTP v3 servers refuse to overwrite - remove the target and rename.
+    // Not atomic: the target is missing in between (but never half written).
+    LIBSSH2_SFTP_ATTRIBUTES attrs;
+    if (libssh2_sftp_stat(sftp, target_path.c_str(), &attrs) == 0 &&
+        !LIBSSH2_SFTP_S_ISDIR(attrs.permissions) &&
+        libssh2_sftp_unlink(sftp, target_path.c_str()) == 0) {
+      SSHFS_LOG("  [RENAME] Server can't replace " << target_path
+                                                   << " atomically, removed "
+                                                      "it before the rename");
+      rc = libssh2_sftp_rename_ex(sftp, source_path.c_str(),
+                                  source_path.length(), target_path.c_str(),
+                                  target_path.length(), 0);
+    }
+  }
+
+  if (rc != 0) {
     throw IOException("Failed to rename remote file from %s to %s\n"
                       "  → SFTP error code: %lu\n"
                       "  → Source may not exist or target may already exist\n"
                       "  → Check file permissions and paths",
-                      source_path.c_str(), target_path.c_str(), sftp_error);
+                      source_path.c_str(), target_path.c_str(),
+                      libssh2_sftp_last_error(sftp));
   }
 }
 
+void SSHClient::MoveFileRemote(const std::string &source_path,
+                               const std::string &target_path) {
+  try {
+    RenameFile(source_path, target_path);
+    return;
+  } catch (const IOException &) {
+    if (!supports_commands) {
+      throw;
+    }
+    SSHFS_LOG("  [MOVE] SFTP rename refused, trying mv on the server");
+  }
+
+  // Moves across filesystems copy and remove on the server
+  std::string command = "mv -f -- " + ShellQuote(source_path) + " " +
+                        ShellQuote(target_path) + " 2>/dev/null";
+  bool moved = false;
+  {
+    // The SFTP session doubles as the lock on this libssh2 session
+    LIBSSH2_SFTP *sftp = BorrowSFTPSession();
+    try {
+      ExecuteCommand(command);
+      moved = true;
+    } catch (const std::exception &e) {
+      SSHFS_LOG("  [MOVE] mv failed: " << e.what());
+    }
+    ReturnSFTPSession(sftp);
+  }
+  if (!moved) {
+    // Report why the rename failed, not the mv
+    RenameFile(source_path, target_path);
+  }
+}
+
+bool SSHClient::CopyFileRemote(const std::string &source_path,
+                               const std::string &target_path) {
+  if (!connected || !supports_commands) {
+    return false;
+  }
+
+  ScopedTimer copy_timer("SSH", "Server-side copy");
+  std::string paths =
+      " -- " + ShellQuote(source_path) + " " + ShellQuote(target_path);
+  // --reflink=auto clones the extents on btrfs/XFS/ZFS and copies elsewhere;
+  // BusyBox and BSD cp don't know the flag, so retry without it
+  std::string command = "cp --reflink=auto" + paths + " 2>/dev/null || cp" +
+                        paths + " 2>/dev/null";
+
+  LIBSSH2_SFTP *sftp = BorrowSFTPSession();
+  try {
+    {
+      std::lock_guard<std::mutex> lock(write_mutex);
+      CreateParentDirectories(sftp, target_path);
+    }
+    ExecuteCommand(command);
+  } catch (const std::exception &e) {
+    ReturnSFTPSession(sftp);
+    SSHFS_LOG("  [COPY] cp failed: " << e.what());
+    return false;
+  }
+  ReturnSFTPSession(sftp);
+  return true;
+}
+
 LIBSSH2_SFTP_ATTRIBUTES
 SSHClient::GetFileStats(const std::string &remote_path) {
+  LIBSSH2_SFTP_ATTRIBUTES attrs;
+  StatPath(remote_path, attrs, false);
+  return attrs;
+}
+
+bool SSHClient::TryGetFileStats(const std::string &remote_path,
+                                LIBSSH2_SFTP_ATTRIBUTES &attrs) {
+  return StatPath(remote_path, attrs, true);
+}
+
+bool SSHClient::StatPath(const std::string &remote_path,
+                         LIBSSH2_SFTP_ATTRIBUTES &attrs, bool missing_ok) {
   if (!connected) {
     throw IOException(
         "Not connected to SSH server\n"
@@ -834,13 +1639,13 @@ SSHClient::GetFileStats(const std::string &remote_path) {
   }
 
   auto stats_start = std::chrono::steady_clock::now();
+  SSHFSHostStats::Add(stats->stat_calls, 1);
 
   // Use pooled SFTP session instead of creating new one each time
   LIBSSH2_SFTP *sftp = BorrowSFTPSession();
 
   // Get file stats
   auto stat_start = std::chrono::steady_clock::now();
-  LIBSSH2_SFTP_ATTRIBUTES attrs;
   int rc = libssh2_sftp_stat(sftp, remote_path.c_str(), &attrs);
   auto stat_ms = std::chrono::duration_cast<std::chrono::milliseconds>(
                      std::chrono::steady_clock::now() - stat_start)
@@ -849,6 +1654,11 @@ SSHClient::GetFileStats(const std::string &remote_path) {
   if (rc != 0) {
     unsigned long sftp_error = libssh2_sftp_last_error(sftp);
     ReturnSFTPSession(sftp);
+    if (missing_ok && (sftp_error == LIBSSH2_FX_NO_SUCH_FILE ||
+                       sftp_error == LIBSSH2_FX_NO_SUCH_PATH)) {
+      SSHFS_LOG("  [STAT] " << remote_path << " does not exist");
+      return false;
+    }
     throw IOException("Failed to get file stats for: %s\n"
                       "  → SFTP error code: %lu\n"
                       "  → File may not exist or you may lack permissions\n"
@@ -871,11 +1681,12 @@ SSHClient::GetFileStats(const std::string &remote_path) {
               << std::endl;
   }
 
-  return attrs;
+  return true;
 }
 
 size_t SSHClient::ReadBytes(const std::string &remote_path, char *buffer,
-                            size_t offset, size_t length) {
+                            size_t offset, size_t length,
+                            size_t max_channels, bool gzip) {
   if (!connected) {
     throw IOException("Not connected to SSH server");
   }
@@ -884,15 +1695,17 @@ size_t SSHClient::ReadBytes(const std::string &remote_path, char *buffer,
   if (!supports_commands || dd_disabled) {
     return ReadBytesSFTP(remote_path, buffer, offset, length);
   }
-
-  // Serialize dd command execution globally to avoid overwhelming Hetzner's SSH
-  // channel limits
-  std::lock_guard<std::mutex> dd_lock(g_dd_command_mutex);
+  if (length == 0) {
+    return 0;
+  }
 
   auto read_start = std::chrono::steady_clock::now();
 
-  // Use SSH dd command for reads - faster than SFTP (no session overhead)
-  // This is similar to HTTP range requests - only transfers exact bytes needed
+  // Use SSH dd commands for reads - only transfers the exact bytes needed,
+  // similar to HTTP range requests. Large reads are split into ranges, each
+  // streamed by its own dd on its own exec channel. Every channel has its own
+  // flow control window, so several of them keep more data in flight than
+  // one SFTP handle on high latency links.
   //
   // dd parameters:
   // - bs=4096: read in 4KB blocks (efficient)
@@ -900,34 +1713,187 @@ size_t SSHClient::ReadBytes(const std::string &remote_path, char *buffer,
   // - skip=OFFSET: skip OFFSET bytes from start
   // - count=LENGTH: read LENGTH bytes
   // - status=none: suppress dd's stderr output
+  //
+  // With gzip dd's output is piped through gzip -1 and inflated as it
+  // arrives.
+  struct DDRange {
+    size_t start = 0; // Relative to offset
+    size_t length = 0;
+    size_t received = 0;
+    LIBSSH2_CHANNEL *channel = nullptr;
+    bool started = false;
+    bool eof = false;
+    std::unique_ptr<GzipStreamDecoder> decoder;
+  };
+  bool use_gzip = gzip && !gzip_disabled;
+  size_t ranges_needed = (length + DD_MIN_RANGE_SIZE - 1) / DD_MIN_RANGE_SIZE;
+  size_t wanted = std::min({max_channels, ranges_needed, dd_channel_limit});
+  wanted = std::max<size_t>(1, wanted);
+
+  // The borrowed SFTP session serializes use of this libssh2 session -
+  // channels of different sessions still read in parallel
+  LIBSSH2_SFTP *sftp = BorrowSFTPSession();
 
-  std::string command =
-      "dd if=" + ShellQuote(remote_path) + " bs=4096" +
-      " iflag=skip_bytes,count_bytes" + " skip=" + std::to_string(offset) +
-      " count=" + std::to_string(length) + " status=none 2>/dev/null";
-
-  // Open channel for command
+  // Open channels in blocking mode - libssh2 keeps channel open state per
+  // session, so opens can't overlap
   auto channel_open_start = std::chrono::steady_clock::now();
-  LIBSSH2_CHANNEL *channel = libssh2_channel_open_session(session);
-  if (!channel) {
+  std::vector<DDRange> ranges(wanted);
+  size_t opened = 0;
+  for (auto &range : ranges) {
+    // Each range's window limits its dd to window / RTT
+    range.channel = OpenSessionChannel();
+    if (!range.channel) {
+      break;
+    }
+    opened++;
+  }
+  auto channel_open_ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+                             std::chrono::steady_clock::now() -
+                             channel_open_start)
+                             .count();
+
+  if (opened == 0) {
     // Fall back to SFTP if SSH channel creation fails
     // This happens on servers with strict channel limits (e.g., Hetzner Storage
     // Boxes) Disable dd permanently to avoid repeatedly hitting the same limit
     SSHFS_LOG(
         "  [READ-DD] Failed to open SSH channel, disabling dd and using SFTP");
     dd_disabled = true;
+    ReturnSFTPSession(sftp);
     return ReadBytesSFTP(remote_path, buffer, offset, length);
   }
-  auto channel_open_end = std::chrono::steady_clock::now();
-  auto channel_open_ms = std::chrono::duration_cast<std::chrono::milliseconds>(
-                             channel_open_end - channel_open_start)
-                             .count();
+  if (opened < wanted) {
+    // Channel limit reached - remember it and use larger ranges
+    SSHFS_LOG("  [READ-DD] Server allowed " << opened << " of " << wanted
+                                            << " channels, limiting dd reads");
+    dd_channel_limit = opened;
+    ranges.resize(opened);
+  }
+  size_t range_size = (length + ranges.size() - 1) / ranges.size();
+  for (size_t i = 0; i < ranges.size(); i++) {
+    ranges[i].start = std::min(length, i * range_size);
+    ranges[i].length = std::min(range_size, length - ranges[i].start);
+    if (use_gzip) {
+      ranges[i].decoder.reset(new GzipStreamDecoder());
+    }
+  }
+  std::vector<char> compressed(use_gzip ? 64 * 1024 : 0);
 
-  // Execute dd command
-  auto exec_start = std::chrono::steady_clock::now();
-  int rc = libssh2_channel_exec(channel, command.c_str());
-  if (rc != 0) {
-    libssh2_channel_free(channel);
+  auto close_channels = [&ranges]() {
+    for (auto &range : ranges) {
+      libssh2_channel_close(range.channel);
+      libssh2_channel_wait_closed(range.channel);
+      libssh2_channel_free(range.channel);
+    }
+  };
+
+  // Start every dd and stream the ranges concurrently in non-blocking mode
+  bool exec_failed = false;
+  bool decode_failed = false;
+  ssize_t read_error = 0;
+  libssh2_session_set_blocking(session, 0);
+  auto transfer_start = std::chrono::steady_clock::now();
+  auto last_progress = transfer_start;
+  while (true) {
+    bool progress = false;
+    bool pending = false;
+    for (auto &range : ranges) {
+      if (!range.started) {
+        std::string command =
+            "dd if=" + ShellQuote(remote_path) + " bs=4096" +
+            " iflag=skip_bytes,count_bytes" +
+            " skip=" + std::to_string(offset + range.start) +
+            " count=" + std::to_string(range.length) +
+            " status=none 2>/dev/null";
+        if (use_gzip) {
+          command += " | gzip -c -1";
+        }
+        int rc = libssh2_channel_exec(range.channel, command.c_str());
+        if (rc == LIBSSH2_ERROR_EAGAIN) {
+          pending = true;
+          continue;
+        }
+        if (rc != 0) {
+          exec_failed = true;
+          break;
+        }
+        range.started = true;
+        progress = true;
+      }
+
+      while (!range.eof && range.received < range.length) {
+        char *target = buffer + range.start + range.received;
+        size_t target_size = range.length - range.received;
+        ssize_t nread =
+            range.decoder
+                ? libssh2_channel_read(range.channel, compressed.data(),
+                                       compressed.size())
+                : libssh2_channel_read(range.channel, target, target_size);
+        if (nread == LIBSSH2_ERROR_EAGAIN) {
+          pending = true;
+          break;
+        }
+        if (nread < 0) {
+          read_error = nread;
+          break;
+        }
+        if (nread == 0) {
+          range.eof = true; // Short range - end of file
+          break;
+        }
+        progress = true;
+        if (range.decoder) {
+          size_t decoded;
+          if (!range.decoder->Decode(compressed.data(), nread, target,
+                                     target_size, decoded)) {
+            decode_failed = true;
+            break;
+          }
+          range.received += decoded;
+        } else {
+          range.received += nread;
+        }
+      }
+      if (exec_failed || decode_failed || read_error != 0) {
+        break;
+      }
+    }
+
+    if (exec_failed || decode_failed || read_error != 0 || !pending) {
+      break;
+    }
+    auto now = std::chrono::steady_clock::now();
+    if (progress) {
+      last_progress = now;
+      continue;
+    }
+    if (now - last_progress > std::chrono::seconds(params.timeout_seconds)) {
+      read_error = LIBSSH2_ERROR_TIMEOUT;
+      break;
+    }
+
+    // Wait until the socket is ready in the direction libssh2 needs
+    int directions = libssh2_session_block_directions(session);
+    struct pollfd pfd = {sock, 0, 0};
+    if (directions & LIBSSH2_SESSION_BLOCK_INBOUND) {
+      pfd.events |= POLLIN;
+    }
+    if (directions & LIBSSH2_SESSION_BLOCK_OUTBOUND) {
+      pfd.events |= POLLOUT;
+    }
+    if (pfd.events == 0) {
+      pfd.events = POLLIN;
+    }
+    poll(&pfd, 1, 100);
+  }
+  libssh2_session_set_blocking(session, 1);
+  auto transfer_ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+                         std::chrono::steady_clock::now() - transfer_start)
+                         .count();
+
+  if (exec_failed) {
+    close_channels();
+    ReturnSFTPSession(sftp);
     // Fall back to SFTP if dd command execution fails
     // This happens on servers where dd execution is blocked despite command
     // support Disable dd permanently since it's likely to fail again
@@ -936,49 +1902,58 @@ size_t SSHClient::ReadBytes(const std::string &remote_path, char *buffer,
     dd_disabled = true;
     return ReadBytesSFTP(remote_path, buffer, offset, length);
   }
-  auto exec_end = std::chrono::steady_clock::now();
-  auto exec_ms = std::chrono::duration_cast<std::chrono::milliseconds>(
-                     exec_end - exec_start)
-                     .count();
-
-  // Read output directly into buffer
-  auto actual_read_start = std::chrono::steady_clock::now();
-  size_t total_read = 0;
-  while (total_read < length) {
-    ssize_t nread =
-        libssh2_channel_read(channel, buffer + total_read, length - total_read);
-
-    if (nread == LIBSSH2_ERROR_EAGAIN) {
-      continue; // Retry
-    } else if (nread < 0) {
-      libssh2_channel_close(channel);
-      libssh2_channel_free(channel);
-      throw IOException("Failed to read from SSH channel");
-    } else if (nread == 0) {
-      // End of output
-      break;
+  if (decode_failed) {
+    close_channels();
+    ReturnSFTPSession(sftp);
+    SSHFS_LOG("  [READ-DD] Corrupt gzip stream, reading without compression");
+    gzip_disabled = true;
+    return ReadBytes(remote_path, buffer, offset, length, max_channels, false);
+  }
+  if (read_error != 0) {
+    close_channels();
+    ReturnSFTPSession(sftp);
+    if (read_error == LIBSSH2_ERROR_TIMEOUT ||
+        read_error == LIBSSH2_ERROR_SOCKET_DISCONNECT ||
+        read_error == LIBSSH2_ERROR_SOCKET_SEND ||
+        read_error == LIBSSH2_ERROR_SOCKET_RECV) {
+      throw IOException("Transient SSH channel error: %zd", read_error);
     }
-
-    total_read += nread;
+    throw IOException("Failed to read from SSH channel (libssh2 error: %zd)",
+                      read_error);
   }
-  auto actual_read_end = std::chrono::steady_clock::now();
-  auto actual_read_ms = std::chrono::duration_cast<std::chrono::milliseconds>(
-                            actual_read_end - actual_read_start)
-                            .count();
 
-  // Wait for command to complete
+  // Wait for the commands to complete
   auto close_start = std::chrono::steady_clock::now();
-  int exit_status = libssh2_channel_get_exit_status(channel);
-
-  // Close channel
-  libssh2_channel_close(channel);
-  libssh2_channel_wait_closed(channel);
-  libssh2_channel_free(channel);
-  auto close_end = std::chrono::steady_clock::now();
+  int exit_status = 0;
+  for (auto &range : ranges) {
+    libssh2_channel_close(range.channel);
+    libssh2_channel_wait_closed(range.channel);
+    int status = libssh2_channel_get_exit_status(range.channel);
+    if (status != 0 && exit_status == 0) {
+      exit_status = status;
+    }
+    libssh2_channel_free(range.channel);
+  }
+  ReturnSFTPSession(sftp);
   auto close_ms = std::chrono::duration_cast<std::chrono::milliseconds>(
-                      close_end - close_start)
+                      std::chrono::steady_clock::now() - close_start)
                       .count();
 
+  // Bytes are contiguous up to the first short range (end of file)
+  size_t total_read = 0;
+  for (auto &range : ranges) {
+    total_read = range.start + range.received;
+    if (range.received < range.length) {
+      break;
+    }
+  }
+
+  if (use_gzip && exit_status == 127 && total_read == 0) {
+    // gzip is not installed on the server
+    SSHFS_LOG("  [READ-DD] gzip not available, reading without compression");
+    gzip_disabled = true;
+    return ReadBytes(remote_path, buffer, offset, length, max_channels, false);
+  }
   if (exit_status != 0 && total_read == 0) {
     throw IOException("dd command failed with exit status %d", exit_status);
   }
@@ -993,10 +1968,11 @@ size_t SSHClient::ReadBytes(const std::string &remote_path, char *buffer,
     double mb_per_sec = total_ms > 0 ? (mb_size / (total_ms / 1000.0)) : 0;
     std::cerr << "  [READ-DD] offset=" << offset << " length=" << length
               << " read=" << total_read << " bytes in " << total_ms << "ms ("
-              << mb_per_sec << " MB/s)" << std::endl;
+              << mb_per_sec << " MB/s) over " << ranges.size() << " channels"
+              << std::endl;
     std::cerr << "    [BREAKDOWN] channel_open=" << channel_open_ms
-              << "ms, exec=" << exec_ms << "ms, actual_read=" << actual_read_ms
-              << "ms, close=" << close_ms << "ms" << std::endl;
+              << "ms, transfer=" << transfer_ms << "ms, close=" << close_ms
+              << "ms" << std::endl;
   }
 
   return total_read;
@@ -1014,6 +1990,12 @@ void SSHClient::InitializeSFTPPool() {
 
   auto pool_start = std::chrono::steady_clock::now();
 
+  if (!session) {
+    // Closed by DisconnectIfIdle after the caller checked IsConnected
+    throw IOException("Transient: SSH connection to %s was closed",
+                      params.hostname.c_str());
+  }
+
   for (size_t i = 0; i < pool_size; i++) {
     LIBSSH2_SFTP *sftp = libssh2_sftp_init(session);
     if (!sftp) {
@@ -1021,6 +2003,7 @@ void SSHClient::InitializeSFTPPool() {
       CleanupSFTPPool();
       throw IOException("Failed to initialize SFTP session for pool");
     }
+    TuneSFTPWindow(sftp);
     sftp_pool.push(sftp);
   }
 
@@ -1037,7 +2020,20 @@ void SSHClient::InitializeSFTPPool() {
   }
 }
 
+void SSHClient::CloseCachedHandles() {
+  read_handle_cache.CloseAll();
+  std::lock_guard<std::mutex> lock(write_mutex);
+  for (auto &entry : write_handles) {
+    libssh2_sftp_close(entry.second);
+  }
+  write_handles.clear();
+  known_directories.clear();
+}
+
 void SSHClient::CleanupSFTPPool() {
+  // Cached handles belong to the pooled SFTP session - close them first
+  CloseCachedHandles();
+
   std::lock_guard<std::mutex> lock(pool_mutex);
 
   while (!sftp_pool.empty()) {
@@ -1050,6 +2046,7 @@ void SSHClient::CleanupSFTPPool() {
 }
 
 LIBSSH2_SFTP *SSHClient::BorrowSFTPSession() {
+  Touch();
   std::unique_lock<std::mutex> lock(pool_mutex);
 
   SSHFS_LOG("  [POOL] BorrowSFTPSession called, pool has " << sftp_pool.size()
@@ -1073,15 +2070,75 @@ LIBSSH2_SFTP *SSHClient::BorrowSFTPSession() {
   return sftp;
 }
 
+LIBSSH2_SFTP *SSHClient::TryBorrowSFTPSession() {
+  std::lock_guard<std::mutex> lock(pool_mutex);
+  if (!pool_initialized || sftp_pool.empty()) {
+    return nullptr;
+  }
+  LIBSSH2_SFTP *sftp = sftp_pool.front();
+  sftp_pool.pop();
+  return sftp;
+}
+
 void SSHClient::ReturnSFTPSession(LIBSSH2_SFTP *sftp) {
   std::lock_guard<std::mutex> lock(pool_mutex);
   sftp_pool.push(sftp);
   pool_cv.notify_one();
 }
 
+LIBSSH2_SFTP_HANDLE *
+SSHClient::AcquireReadHandle(LIBSSH2_SFTP *sftp,
+                             const std::string &remote_path) {
+  bool opened = false;
+  LIBSSH2_SFTP_HANDLE *handle =
+      read_handle_cache.Acquire(sftp, remote_path, &opened);
+  if (opened) {
+    SSHFSHostStats::Add(stats->handle_opens, 1);
+  }
+  if (!handle) {
+    int sftp_error = libssh2_sftp_last_error(sftp);
+    char *err_msg = nullptr;
+    int session_error =
+        libssh2_session_last_error(session, &err_msg, nullptr, 0);
+    throw IOException("Failed to open remote file for reading: %s\n"
+                      "  → SFTP error code: %d\n"
+                      "  → Session error: %d (%s)\n"
+                      "  → File may not exist, check path and permissions",
+                      remote_path.c_str(), sftp_error, session_error,
+                      err_msg ? err_msg : "Unknown error");
+  }
+  return handle;
+}
+
+void SSHClient::ReleaseReadHandle(LIBSSH2_SFTP_HANDLE *handle, bool discard) {
+  read_handle_cache.Release(handle, discard);
+}
+
+void SSHClient::InvalidateReadHandle(const std::string &remote_path) {
+  read_handle_cache.Invalidate(remote_path);
+}
+
 // Capability detection
 
 void SSHClient::DetectCapabilities() {
+  auto profile = LoadServerProfile(params);
+  if (profile.capabilities_known) {
+    supports_commands = profile.supports_commands;
+    SSHFS_LOG("  [DETECT] Using capabilities detected earlier (commands: "
+              << (supports_commands ? "yes" : "no") << ")");
+    return;
+  }
+
+  if (ProbeCapabilities()) {
+    bool commands = supports_commands;
+    UpdateServerProfile(params, [commands](SSHServerProfile &cached) {
+      cached.capabilities_known = true;
+      cached.supports_commands = commands;
+    });
+  }
+}
+
+bool SSHClient::ProbeCapabilities() {
   // Test if we can execute SSH commands (channel exec)
   // Some SFTP-only servers don't support command execution
 
@@ -1099,7 +2156,11 @@ void SSHClient::DetectCapabilities() {
       SSHFS_LOG("  [DETECT] Server does not support SSH command execution "
                 "(SFTP-only mode)");
       supports_commands = false;
-      return;
+      // A timeout or broken socket says nothing about the server
+      int rc = libssh2_session_last_errno(session);
+      return rc != LIBSSH2_ERROR_TIMEOUT &&
+             rc != LIBSSH2_ERROR_SOCKET_DISCONNECT &&
+             rc != LIBSSH2_ERROR_SOCKET_SEND && rc != LIBSSH2_ERROR_SOCKET_RECV;
     }
 
     // Try to execute a simple test command
@@ -1111,7 +2172,7 @@ void SSHClient::DetectCapabilities() {
       SSHFS_LOG("  [DETECT] Server does not support command execution "
                 "(SFTP-only mode)");
       supports_commands = false;
-      return;
+      return true;
     }
 
     // Read and discard any output
@@ -1134,17 +2195,19 @@ void SSHClient::DetectCapabilities() {
       SSHFS_LOG("  [DETECT] Command execution returned non-zero exit status ("
                 << exit_status << "), assuming SFTP-only mode");
       supports_commands = false;
-      return;
+      return true;
     }
 
     // Success - server supports command execution
     SSHFS_LOG("  [DETECT] Server supports SSH command execution");
     supports_commands = true;
+    return true;
 
   } catch (...) {
     // If anything goes wrong, assume SFTP-only
     SSHFS_LOG("  [DETECT] Error testing commands, assuming SFTP-only mode");
     supports_commands = false;
+    return false;
   }
 }
 
@@ -1153,121 +2216,336 @@ void SSHClient::DetectCapabilities() {
 void SSHClient::CreateDirectorySFTP(const std::string &remote_path) {
   // Recursively create directories using SFTP mkdir
   // Split path by '/' and create each directory level
-  // Note: Called from UploadChunk which already holds upload_mutex
 
-  LIBSSH2_SFTP *sftp = BorrowSFTPSession();
-
-  try {
-    std::string path;
-    size_t pos = 0;
-    size_t start = 0;
+  SFTPSessionGuard guard(*this);
+  LIBSSH2_SFTP *sftp = guard.Get();
 
-    // Skip leading slash if present
-    if (!remote_path.empty() && remote_path[0] == '/') {
-      start = 1;
-      path = "/";
-    }
+  std::string path;
+  size_t pos = 0;
+  size_t start = 0;
 
-    while (true) {
-      pos = remote_path.find('/', start);
-      std::string component;
+  // Skip leading slash if present
+  if (!remote_path.empty() && remote_path[0] == '/') {
+    start = 1;
+    path = "/";
+  }
 
-      if (pos == std::string::npos) {
-        // Last component
-        component = remote_path.substr(start);
-      } else {
-        component = remote_path.substr(start, pos - start);
-      }
+  while (true) {
+    pos = remote_path.find('/', start);
+    std::string component;
 
-      if (!component.empty()) {
-        path += component;
+    if (pos == std::string::npos) {
+      // Last component
+      component = remote_path.substr(start);
+    } else {
+      component = remote_path.substr(start, pos - start);
+    }
 
-        // Try to create directory (ignore if it already exists)
-        int rc = libssh2_sftp_mkdir(
-            sftp, path.c_str(),
-            LIBSSH2_SFTP_S_IRWXU | LIBSSH2_SFTP_S_IRGRP | LIBSSH2_SFTP_S_IXGRP |
-                LIBSSH2_SFTP_S_IROTH | LIBSSH2_SFTP_S_IXOTH);
+    if (!component.empty()) {
+      path += component;
 
-        if (rc != 0) {
-          unsigned long err_code = libssh2_sftp_last_error(sftp);
-          // Ignore "file exists" errors
-          if (err_code != LIBSSH2_FX_FILE_ALREADY_EXISTS) {
-            ReturnSFTPSession(sftp);
-            throw IOException(
-                "Failed to create directory: %s (SFTP error: %lu)", path,
-                err_code);
-          }
-        }
+      // Try to create directory (ignore if it already exists)
+      int rc = libssh2_sftp_mkdir(
+          sftp, path.c_str(),
+          LIBSSH2_SFTP_S_IRWXU | LIBSSH2_SFTP_S_IRGRP | LIBSSH2_SFTP_S_IXGRP |
+              LIBSSH2_SFTP_S_IROTH | LIBSSH2_SFTP_S_IXOTH);
 
-        if (pos == std::string::npos) {
-          break;
+      if (rc != 0) {
+        unsigned long err_code = libssh2_sftp_last_error(sftp);
+        // SFTP v3 servers (OpenSSH) report an existing directory as a
+        // generic FX_FAILURE - check what is there
+        LIBSSH2_SFTP_ATTRIBUTES attrs;
+        bool exists = err_code == LIBSSH2_FX_FILE_ALREADY_EXISTS ||
+                      (libssh2_sftp_stat(sftp, path.c_str(), &attrs) == 0 &&
+                       LIBSSH2_SFTP_S_ISDIR(attrs.permissions));
+        if (!exists) {
+          throw IOException("Failed to create directory: %s (SFTP error: %lu)",
+                            path, err_code);
         }
-
-        path += "/";
       }
 
-      start = pos + 1;
-      if (start >= remote_path.length()) {
+      if (pos == std::string::npos) {
         break;
       }
+
+      path += "/";
     }
 
-    ReturnSFTPSession(sftp);
-  } catch (...) {
-    ReturnSFTPSession(sftp);
-    throw;
+    start = pos + 1;
+    if (start >= remote_path.length()) {
+      break;
+    }
   }
 }
 
 void SSHClient::RemoveDirectorySFTP(const std::string &remote_path) {
+  SFTPSessionGuard guard(*this);
+  if (libssh2_sftp_rmdir(guard.Get(), remote_path.c_str()) != 0) {
+    unsigned long err_code = libssh2_sftp_last_error(guard.Get());
+    throw IOException("Failed to remove directory: %s (SFTP error: %lu)",
+                      remote_path, err_code);
+  }
+}
+
+bool SSHClient::ListDirectory(const std::string &remote_path,
+                              std::vector<SFTPDirEntry> &entries) {
+  if (!connected) {
+    throw IOException("Not connected to SSH server");
+  }
+
+  std::string dir_path = remote_path.empty() ? "." : remote_path;
   LIBSSH2_SFTP *sftp = BorrowSFTPSession();
 
-  try {
-    int rc = libssh2_sftp_rmdir(sftp, remote_path.c_str());
+  LIBSSH2_SFTP_HANDLE *dir = libssh2_sftp_opendir(sftp, dir_path.c_str());
+  if (!dir) {
+    unsigned long err_code = libssh2_sftp_last_error(sftp);
     ReturnSFTPSession(sftp);
+    if (err_code == LIBSSH2_FX_NO_SUCH_FILE ||
+        err_code == LIBSSH2_FX_NO_SUCH_PATH) {
+      return false;
+    }
+    throw IOException("Failed to list directory: %s (SFTP error: %lu)\n"
+                      "  → Directory may not be readable by %s",
+                      dir_path, err_code, params.username);
+  }
 
-    if (rc != 0) {
-      unsigned long err_code = libssh2_sftp_last_error(sftp);
-      throw IOException("Failed to remove directory: %s (SFTP error: %lu)",
-                        remote_path, err_code);
+  char name[1024];
+  char longentry[1024];
+  size_t count = 0;
+  while (true) {
+    SFTPDirEntry entry;
+    memset(&entry.attrs, 0, sizeof(entry.attrs));
+    int rc = libssh2_sftp_readdir_ex(dir, name, sizeof(name), longentry,
+                                     sizeof(longentry), &entry.attrs);
+    if (rc <= 0) {
+      break;
     }
-  } catch (...) {
-    ReturnSFTPSession(sftp);
-    throw;
+    entry.name.assign(name, rc);
+    if (entry.name == "." || entry.name == "..") {
+      continue;
+    }
+
+    // readdir returns lstat attributes - resolve symlinks so linked files
+    // and directories are globbed like regular ones
+    if ((entry.attrs.flags & LIBSSH2_SFTP_ATTR_PERMISSIONS) &&
+        LIBSSH2_SFTP_S_ISLNK(entry.attrs.permissions)) {
+      std::string link_path = dir_path + "/" + entry.name;
+      LIBSSH2_SFTP_ATTRIBUTES target;
+      if (libssh2_sftp_stat(sftp, link_path.c_str(), &target) == 0) {
+        entry.attrs = target;
+      }
+    }
+    entries.push_back(std::move(entry));
+    count++;
   }
+
+  libssh2_sftp_closedir(dir);
+  ReturnSFTPSession(sftp);
+
+  SSHFS_LOG("  [LIST] " << dir_path << ": " << count << " entries");
+  return true;
 }
 
-void SSHClient::TruncateFileSFTP(const std::string &remote_path,
-                                 int64_t new_size) {
-  LIBSSH2_SFTP *sftp = BorrowSFTPSession();
+bool SSHClient::FindFiles(const std::string &base_path, int max_depth,
+                          std::vector<SFTPDirEntry> &entries) {
+  if (!connected || !supports_commands) {
+    return false;
+  }
 
-  try {
-    // Open file for writing
-    LIBSSH2_SFTP_HANDLE *handle =
-        libssh2_sftp_open(sftp, remote_path.c_str(), LIBSSH2_FXF_WRITE, 0);
+  std::string command = "find -L " +
+                        ShellQuote(base_path.empty() ? "." : base_path) +
+                        " -mindepth 1";
+  if (max_depth >= 0) {
+    command += " -maxdepth " + std::to_string(max_depth);
+  }
+  command += " -type f -printf '%s\\t%T@\\t%P\\n'";
+
+  // Each line: <size>\t<mtime>.<fraction>\t<relative path>, parsed as it
+  // arrives
+  bool valid = true;
+  auto on_line = [&](const std::string &line) {
+    size_t tab1 = line.find('\t');
+    size_t tab2 = tab1 == std::string::npos ? std::string::npos
+                                            : line.find('\t', tab1 + 1);
+    if (tab2 == std::string::npos || tab2 + 1 >= line.size()) {
+      return true;
+    }
 
-    if (!handle) {
+    SFTPDirEntry entry;
+    memset(&entry.attrs, 0, sizeof(entry.attrs));
+    try {
+      entry.attrs.filesize = std::stoull(line.substr(0, tab1));
+      entry.attrs.mtime = std::stoul(line.substr(tab1 + 1, tab2 - tab1 - 1));
+    } catch (...) {
+      // Not GNU find output - don't trust any of it
+      valid = false;
+      return false;
+    }
+    entry.attrs.atime = entry.attrs.mtime;
+    entry.attrs.permissions = LIBSSH2_SFTP_S_IFREG;
+    entry.attrs.flags = LIBSSH2_SFTP_ATTR_SIZE | LIBSSH2_SFTP_ATTR_ACMODTIME |
+                        LIBSSH2_SFTP_ATTR_PERMISSIONS;
+    entry.name = line.substr(tab2 + 1);
+    entries.push_back(std::move(entry));
+    return true;
+  };
+
+  int exit_status;
+  {
+    // The SFTP session doubles as the lock on this libssh2 session
+    LIBSSH2_SFTP *sftp = BorrowSFTPSession();
+    try {
+      exit_status = ExecuteCommandLines(command, on_line);
+    } catch (const std::exception &e) {
       ReturnSFTPSession(sftp);
-      throw IOException("Failed to open file for truncate: %s", remote_path);
+      SSHFS_LOG("  [LIST] find failed, falling back to SFTP: " << e.what());
+      return false;
     }
+    ReturnSFTPSession(sftp);
+  }
+  if (!valid || exit_status != 0) {
+    SSHFS_LOG("  [LIST] find failed, falling back to SFTP (exit status "
+              << exit_status << ")");
+    entries.clear();
+    return false;
+  }
 
-    // Set file size using fsetstat
-    LIBSSH2_SFTP_ATTRIBUTES attrs;
-    memset(&attrs, 0, sizeof(attrs));
-    attrs.filesize = new_size;
-    attrs.flags = LIBSSH2_SFTP_ATTR_SIZE;
+  SSHFS_LOG("  [LIST] find " << base_path << ": " << entries.size()
+                             << " files in one round trip");
+  return true;
+}
 
-    int rc = libssh2_sftp_fsetstat(handle, &attrs);
-    libssh2_sftp_close(handle);
-    ReturnSFTPSession(sftp);
+bool SSHClient::FindEntries(
+    const std::string &base_path, bool recursive, bool with_hash,
+    const std::function<bool(const SFTPDirEntry &, const std::string &)>
+        &on_entry) {
+  if (!connected || !supports_commands) {
+    return false;
+  }
 
-    if (rc != 0) {
-      throw IOException("Failed to truncate file: %s to size %lld", remote_path,
-                        new_size);
+  std::string dir = base_path.empty() ? "." : base_path;
+  if (dir[0] == '-') {
+    dir = "./" + dir;
+  }
+  // The start point itself (empty %P) comes first and proves that the
+  // directory exists and find understands -printf
+  std::string command = "cd " + ShellQuote(dir) + " && find -L .";
+  if (!recursive) {
+    command += " -maxdepth 1";
+  }
+  command += " \\( -type f -o -type d \\) -printf '%Y\\t%s\\t%T@\\t%P\\n'"
+             " 2>/dev/null";
+  if (with_hash) {
+    // Hash each file as its line passes by, so lines stay complete and in
+    // listing order: <sha256>\t<type>\t<size>\t<mtime>\t<path>
+    command += " | while IFS= read -r line; do h=; case $line in f*)"
+               " h=$(sha256sum < \"${line#*\t*\t*\t}\" 2>/dev/null);;"
+               " esac; printf '%s\\t%s\\n' \"${h%% *}\" \"$line\"; done";
+  }
+
+  bool started = false;
+  bool valid = true;
+  size_t count = 0;
+  auto on_line = [&](const std::string &line) {
+    size_t pos = 0;
+    std::string hash;
+    if (with_hash) {
+      size_t tab = line.find('\t');
+      if (tab == std::string::npos) {
+        valid = false;
+        return false;
+      }
+      hash = line.substr(0, tab);
+      pos = tab + 1;
+    }
+    size_t tab1 = line.find('\t', pos);
+    size_t tab2 = tab1 == std::string::npos ? std::string::npos
+                                            : line.find('\t', tab1 + 1);
+    size_t tab3 = tab2 == std::string::npos ? std::string::npos
+                                            : line.find('\t', tab2 + 1);
+    if (tab3 == std::string::npos || tab1 != pos + 1) {
+      // Not GNU find output - don't trust any of it
+      valid = false;
+      return false;
+    }
+
+    SFTPDirEntry entry;
+    memset(&entry.attrs, 0, sizeof(entry.attrs));
+    try {
+      entry.attrs.filesize = std::stoull(line.substr(tab1 + 1, tab2 - tab1 - 1));
+      entry.attrs.mtime = std::stoul(line.substr(tab2 + 1, tab3 - tab2 - 1));
+    } catch (...) {
+      valid = false;
+      return false;
+    }
+    entry.attrs.atime = entry.attrs.mtime;
+    entry.attrs.permissions =
+        line[pos] == 'd' ? LIBSSH2_SFTP_S_IFDIR : LIBSSH2_SFTP_S_IFREG;
+    entry.attrs.flags = LIBSSH2_SFTP_ATTR_SIZE | LIBSSH2_SFTP_ATTR_ACMODTIME |
+                        LIBSSH2_SFTP_ATTR_PERMISSIONS;
+    entry.name = line.substr(tab3 + 1);
+    if (entry.name.empty()) {
+      started = true;
+      return true;
+    }
+    if (!started) {
+      valid = false;
+      return false;
+    }
+    count++;
+    return on_entry(entry, hash);
+  };
+
+  {
+    // The SFTP session doubles as the lock on this libssh2 session
+    LIBSSH2_SFTP *sftp = BorrowSFTPSession();
+    try {
+      // find exits non-zero on unreadable subdirectories - the rest of the
+      // listing is still good
+      ExecuteCommandLines(command, on_line);
+    } catch (...) {
+      ReturnSFTPSession(sftp);
+      if (count > 0) {
+        throw;
+      }
+      SSHFS_LOG("  [LIST] find failed, falling back to SFTP");
+      return false;
     }
-  } catch (...) {
     ReturnSFTPSession(sftp);
-    throw;
+  }
+
+  if (!valid && count > 0) {
+    throw IOException("Unexpected find output while listing %s on %s",
+                      base_path, params.hostname);
+  }
+  SSHFS_LOG("  [LIST] find " << base_path << ": " << count
+                             << " entries in one round trip");
+  return started && valid;
+}
+
+void SSHClient::TruncateFileSFTP(const std::string &remote_path,
+                                 int64_t new_size) {
+  SFTPSessionGuard guard(*this);
+
+  // Open file for writing
+  LIBSSH2_SFTP_HANDLE *handle =
+      libssh2_sftp_open(guard.Get(), remote_path.c_str(), LIBSSH2_FXF_WRITE, 0);
+  if (!handle) {
+    throw IOException("Failed to open file for truncate: %s", remote_path);
+  }
+
+  // Set file size using fsetstat
+  LIBSSH2_SFTP_ATTRIBUTES attrs;
+  memset(&attrs, 0, sizeof(attrs));
+  attrs.filesize = new_size;
+  attrs.flags = LIBSSH2_SFTP_ATTR_SIZE;
+
+  int rc = libssh2_sftp_fsetstat(handle, &attrs);
+  libssh2_sftp_close(handle);
+
+  if (rc != 0) {
+    throw IOException("Failed to truncate file: %s to size %lld", remote_path,
+                      new_size);
   }
 }
 
@@ -1286,41 +2564,29 @@ size_t SSHClient::ReadBytesSFTP(const std::string &remote_path, char *buffer,
   // This allows multiple file handles to share a small pool of sessions
   SSHFS_LOG("  [READ-SFTP] Borrowing SFTP session from pool for " << remote_path
                                                                   << "...");
+  // The borrowed session is exclusive to this thread - libssh2 SFTP sessions
+  // are NOT thread-safe, so the pool serializes access
   LIBSSH2_SFTP *sftp = BorrowSFTPSession();
   SSHFS_LOG("  [READ-SFTP] Session borrowed, opening file...");
 
-  // Serialize SFTP operations - libssh2 SFTP sessions are NOT thread-safe
-  // Multiple threads cannot use the same session concurrently
-  std::lock_guard<std::mutex> lock(upload_mutex);
-
   try {
-    // Open file for reading
+    // Open file for reading (cached across reads on this connection)
     auto open_start = std::chrono::steady_clock::now();
     SSHFS_LOG("  [READ-SFTP] Opening " << remote_path << " for read...");
-    LIBSSH2_SFTP_HANDLE *handle =
-        libssh2_sftp_open(sftp, remote_path.c_str(), LIBSSH2_FXF_READ, 0);
-
-    if (!handle) {
-      int sftp_error = libssh2_sftp_last_error(sftp);
-      char *err_msg = nullptr;
-      int session_error =
-          libssh2_session_last_error(session, &err_msg, nullptr, 0);
-      throw IOException("Failed to open file for read: %s\n"
-                        "  SFTP error: %d\n"
-                        "  Session error: %d (%s)",
-                        remote_path.c_str(), sftp_error, session_error,
-                        err_msg ? err_msg : "Unknown error");
-    }
+    LIBSSH2_SFTP_HANDLE *handle = AcquireReadHandle(sftp, remote_path);
     SSHFS_LOG("  [READ-SFTP] File opened successfully");
     auto open_end = std::chrono::steady_clock::now();
     auto open_ms = std::chrono::duration_cast<std::chrono::milliseconds>(
                        open_end - open_start)
                        .count();
 
-    // Seek to the offset
+    // Seek to the offset (seeking discards libssh2's read-ahead, so skip it
+    // when the cached handle is already positioned there)
     auto seek_start = std::chrono::steady_clock::now();
     SSHFS_LOG("  [READ-SFTP] Seeking to offset " << offset << "...");
-    libssh2_sftp_seek64(handle, offset);
+    if (libssh2_sftp_tell64(handle) != offset) {
+      libssh2_sftp_seek64(handle, offset);
+    }
     SSHFS_LOG("  [READ-SFTP] Seek complete, starting read of " << length
                                                                << " bytes...");
     auto seek_end = std::chrono::steady_clock::now();
@@ -1328,47 +2594,24 @@ size_t SSHClient::ReadBytesSFTP(const std::string &remote_path, char *buffer,
                        seek_end - seek_start)
                        .count();
 
-    // Read data in chunks to avoid timeouts on large reads
-    // libssh2_sftp_read() can timeout for very large requests
-    // Reading in 32KB chunks matches libssh2's natural packet size
+    // Pipelined read - several READ requests stay in flight so one round trip
+    // is not paid per 32KB packet
     auto actual_read_start = std::chrono::steady_clock::now();
-    size_t total_read = 0;
-    const size_t READ_CHUNK_SIZE = 32 * 1024; // 32KB chunks
-
-    while (total_read < length) {
-      // Calculate how much to read in this iteration
-      size_t bytes_remaining = length - total_read;
-      size_t bytes_to_read = std::min(bytes_remaining, READ_CHUNK_SIZE);
-
-      SSHFS_LOG("  [READ-SFTP] Reading chunk: " << total_read << "/" << length
-                                                << " (" << bytes_to_read
-                                                << " bytes)...");
-      ssize_t nread =
-          libssh2_sftp_read(handle, buffer + total_read, bytes_to_read);
-      SSHFS_LOG("  [READ-SFTP] Chunk read returned: " << nread << " bytes");
-
-      if (nread == LIBSSH2_ERROR_EAGAIN) {
-        SSHFS_LOG("  [READ-SFTP] Got EAGAIN, retrying...");
-        continue; // Retry
-      } else if (nread < 0) {
-        libssh2_sftp_close(handle);
-        throw IOException("Failed to read from SFTP file: %s (error: %zd)",
-                          remote_path, nread);
-      } else if (nread == 0) {
-        // End of file
-        break;
-      }
-
-      total_read += nread;
+    size_t total_read;
+    try {
+      total_read = ReadPipelined(handle, remote_path, buffer, length);
+    } catch (...) {
+      ReleaseReadHandle(handle, true);
+      throw;
     }
     auto actual_read_end = std::chrono::steady_clock::now();
     auto actual_read_ms = std::chrono::duration_cast<std::chrono::milliseconds>(
                               actual_read_end - actual_read_start)
                               .count();
 
-    // Close handle and return session to pool
+    // Release handle (stays open in the cache) and return session to pool
     auto close_start = std::chrono::steady_clock::now();
-    libssh2_sftp_close(handle);
+    ReleaseReadHandle(handle);
     ReturnSFTPSession(sftp); // Return to pool for reuse
     auto close_end = std::chrono::steady_clock::now();
     auto close_ms = std::chrono::duration_cast<std::chrono::milliseconds>(
@@ -1397,4 +2640,53 @@ size_t SSHClient::ReadBytesSFTP(const std::string &remote_path, char *buffer,
   }
 }
 
+size_t SSHClient::ReadCallSize(const SSHConnectionParams &params) {
+  // libssh2_sftp_read() splits each call into SFTP READ packets and keeps up
+  // to 4x the call size outstanding (read-ahead), reassembling replies in
+  // order. Calls of a quarter of the window keep about read_window bytes in
+  // flight, so a 40ms RTT link is no longer limited to one packet per round
+  // trip.
+  return std::max<size_t>(1024, params.read_window / 4);
+}
+
+size_t SSHClient::ReadPipelined(LIBSSH2_SFTP_HANDLE *handle,
+                                const std::string &remote_path, char *buffer,
+                                size_t length) {
+  size_t call_size = ReadCallSize(params);
+
+  size_t total_read = 0;
+  while (total_read < length) {
+    size_t bytes_to_read = std::min(length - total_read, call_size);
+
+    ssize_t nread =
+        libssh2_sftp_read(handle, buffer + total_read, bytes_to_read);
+
+    if (nread == LIBSSH2_ERROR_EAGAIN) {
+      continue; // Retry
+    } else if (nread < 0) {
+      SSHFS_LOG("  [READ-PIPELINE] libssh2_sftp_read failed: "
+                << nread << ", total_read so far: " << total_read);
+
+      // Check if this is a transient error worth retrying
+      if (nread == LIBSSH2_ERROR_TIMEOUT ||
+          nread == LIBSSH2_ERROR_SOCKET_DISCONNECT ||
+          nread == LIBSSH2_ERROR_SOCKET_SEND ||
+          nread == LIBSSH2_ERROR_SOCKET_RECV) {
+        throw IOException("Transient SFTP error: %zd", nread);
+      }
+
+      // Permanent error - don't retry
+      throw IOException("Failed to read from SFTP file: %s (libssh2 error: "
+                        "%zd, read %zu/%zu bytes)",
+                        remote_path, nread, total_read, length);
+    } else if (nread == 0) {
+      break; // EOF
+    }
+
+    total_read += nread;
+  }
+
+  return total_read;
+}
+
 } // namespace duckdb
@@ -0,0 +1,445 @@
+#include "ssh_reactor.hpp"
+#include "duckdb/common/exception.hpp"
+#include "ssh_helpers.hpp"
+#include "ssh_session_pool.hpp"
+#include <algorithm>
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+
+namespace duckdb {
+
+// Session timeout while closing channels - the connection may be dead
+static constexpr long CLOSE_TIMEOUT_MS = 2000;
+// An idle session is kept this long for the next read before it goes back
+// to the pool, so back-to-back reads don't reopen the channels
+static constexpr auto IDLE_RELEASE = std::chrono::milliseconds(50);
+// Longest the reactor keeps the session while others may be waiting for it
+static constexpr auto MAX_HOLD = std::chrono::seconds(1);
+
+// Errors that mean the session itself is gone, not just one request
+static bool IsConnectionError(int rc) {
+  return rc == LIBSSH2_ERROR_TIMEOUT || rc == LIBSSH2_ERROR_SOCKET_DISCONNECT ||
+         rc == LIBSSH2_ERROR_SOCKET_SEND || rc == LIBSSH2_ERROR_SOCKET_RECV;
+}
+
+SSHReactor::SSHReactor(SSHSessionPool &pool, const SSHConnectionParams &params,
+                       size_t max_channels)
+    : pool(pool), params(params),
+      max_channels(std::max<size_t>(1, max_channels)) {
+  if (pipe(wake_pipe) != 0) {
+    throw IOException("Failed to create wake pipe for multiplexed reads");
+  }
+  fcntl(wake_pipe[0], F_SETFL, fcntl(wake_pipe[0], F_GETFL) | O_NONBLOCK);
+  fcntl(wake_pipe[1], F_SETFL, fcntl(wake_pipe[1], F_GETFL) | O_NONBLOCK);
+}
+
+SSHReactor::~SSHReactor() {
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    stopping = true;
+  }
+  Wake();
+  if (thread.joinable()) {
+    thread.join();
+  }
+  close(wake_pipe[0]);
+  close(wake_pipe[1]);
+}
+
+size_t SSHReactor::Read(const std::string &remote_path, uint64_t offset,
+                        char *buffer, size_t length) {
+  auto op = std::make_shared<ReadOp>();
+  op->remote_path = remote_path;
+  op->offset = offset;
+  op->buffer = buffer;
+  op->length = length;
+
+  std::unique_lock<std::mutex> lock(mutex);
+  if (stopping) {
+    throw IOException("Multiplexed connection to %s:%d is shutting down",
+                      params.hostname.c_str(), params.port);
+  }
+  // The I/O thread starts with the first read
+  if (!thread.joinable()) {
+    thread = std::thread([this]() { Loop(); });
+  }
+  queue.push_back(op);
+  lock.unlock();
+  Wake();
+
+  lock.lock();
+  done_cv.wait(lock, [&op]() { return op->finished; });
+  if (op->error) {
+    std::rethrow_exception(op->error);
+  }
+  return op->bytes_read;
+}
+
+void SSHReactor::SetMaxChannels(size_t new_max_channels) {
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    max_channels = std::max<size_t>(1, new_max_channels);
+  }
+  Wake();
+}
+
+size_t SSHReactor::GetInFlightCount() {
+  std::lock_guard<std::mutex> lock(mutex);
+  return in_flight;
+}
+
+void SSHReactor::Loop() {
+  // Debug flag is thread-local
+  g_sshfs_debug_enabled = params.debug_logging;
+
+  while (true) {
+    bool queued;
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      if (stopping) {
+        break;
+      }
+      queued = !queue.empty();
+    }
+    if (!client) {
+      if (!queued) {
+        Wait(false);
+        continue;
+      }
+      if (!Connect()) {
+        continue;
+      }
+    }
+
+    auto now = Clock::now();
+    if (!draining && now - leased_at > MAX_HOLD) {
+      // Finish the reads in flight, then let the pool's other users in
+      draining = true;
+    }
+    if (!draining) {
+      Dispatch();
+    }
+
+    // Step every read until libssh2 needs the socket
+    bool busy = false;
+    bool progress = false;
+    for (auto &channel : channels) {
+      if (!channel.op) {
+        continue;
+      }
+      busy = true;
+      progress = Step(channel) || progress;
+      if (!connection_error.empty()) {
+        break;
+      }
+    }
+
+    if (!connection_error.empty()) {
+      SSHFS_LOG("  [REACTOR] Connection failed: " << connection_error);
+      ResetConnection(std::make_exception_ptr(IOException(connection_error)));
+      continue;
+    }
+
+    now = Clock::now();
+    if (busy) {
+      last_busy = now;
+    } else if (draining || (!queued && now - last_busy > IDLE_RELEASE)) {
+      ReleaseSession();
+      continue;
+    }
+    if (progress) {
+      last_progress = now;
+      continue;
+    }
+    // Non-blocking sessions ignore libssh2's timeout - enforce it here
+    if (busy && now - last_progress >
+                    std::chrono::seconds(params.timeout_seconds)) {
+      ResetConnection(std::make_exception_ptr(
+          IOException("Transient SFTP error: no reply from %s:%d for %d "
+                      "seconds",
+                      params.hostname.c_str(), params.port,
+                      params.timeout_seconds)));
+      continue;
+    }
+
+    Wait(busy);
+  }
+
+  // The session itself is fine - hand it back connected
+  auto stopped = std::make_exception_ptr(
+      IOException("Multiplexed connection to %s:%d was closed",
+                  params.hostname.c_str(), params.port));
+  ResetConnection(stopped, false);
+  FailQueued(stopped);
+}
+
+bool SSHReactor::Connect() {
+  size_t wanted;
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    wanted = max_channels;
+  }
+
+  try {
+    // Waits its turn like any other user of the pool
+    client = pool.Acquire();
+    if (!client->IsConnected()) {
+      client->Connect();
+    }
+    borrowed = client->BorrowSFTPSession();
+  } catch (...) {
+    if (client) {
+      pool.Release(client);
+      client.reset();
+    }
+    FailQueued(std::current_exception());
+    return false;
+  }
+
+  // The borrowed session carries the first read. Opening more channels has
+  // session-level state in libssh2 - do it before the session goes
+  // non-blocking.
+  Channel first;
+  first.sftp = borrowed;
+  channels.push_back(first);
+  LIBSSH2_SESSION *session = client->GetSession();
+  for (size_t i = 1; i < wanted; i++) {
+    LIBSSH2_SFTP *sftp = libssh2_sftp_init(session);
+    if (!sftp) {
+      // Servers may limit channels per connection - use what we got
+      SSHFS_LOG("  [REACTOR] Server accepted " << i << " of " << wanted
+                                               << " SFTP channels");
+      break;
+    }
+    client->TuneSFTPWindow(sftp);
+    Channel channel;
+    channel.sftp = sftp;
+    channel.owned = true;
+    channels.push_back(channel);
+  }
+
+  libssh2_session_set_blocking(session, 0);
+  leased_at = last_busy = Clock::now();
+  draining = false;
+  SSHFS_LOG("  [REACTOR] Multiplexing " << channels.size()
+                                        << " channels over a session to "
+                                        << params.hostname << ":"
+                                        << params.port);
+  return true;
+}
+
+void SSHReactor::ReleaseSession() {
+  LIBSSH2_SESSION *session = client->GetSession();
+  libssh2_session_set_blocking(session, 1);
+  libssh2_session_set_timeout(session, CLOSE_TIMEOUT_MS);
+  for (auto &channel : channels) {
+    if (channel.owned) {
+      libssh2_sftp_shutdown(channel.sftp);
+    }
+  }
+  libssh2_session_set_timeout(session, params.timeout_seconds * 1000);
+  channels.clear();
+
+  client->ReturnSFTPSession(borrowed);
+  borrowed = nullptr;
+  pool.Release(client);
+  client.reset();
+  draining = false;
+}
+
+void SSHReactor::Dispatch() {
+  std::lock_guard<std::mutex> lock(mutex);
+  for (auto &channel : channels) {
+    if (queue.empty() || in_flight >= max_channels) {
+      break;
+    }
+    if (channel.op) {
+      continue;
+    }
+    channel.op = queue.front();
+    queue.pop_front();
+    in_flight++;
+    last_progress = Clock::now();
+  }
+}
+
+bool SSHReactor::Step(Channel &channel) {
+  auto &op = *channel.op;
+  LIBSSH2_SESSION *session = client->GetSession();
+  bool progress = false;
+
+  if (op.state == ReadOp::State::OPEN) {
+    op.handle = libssh2_sftp_open_ex(
+        channel.sftp, op.remote_path.c_str(),
+        static_cast<unsigned int>(op.remote_path.length()), LIBSSH2_FXF_READ,
+        0, LIBSSH2_SFTP_OPENFILE);
+    if (!op.handle) {
+      int rc = libssh2_session_last_errno(session);
+      if (rc == LIBSSH2_ERROR_EAGAIN) {
+        return false;
+      }
+      if (IsConnectionError(rc)) {
+        connection_error = "Transient SFTP error: " + std::to_string(rc);
+        return false;
+      }
+      Finish(channel, std::make_exception_ptr(IOException(
+                          "Failed to open remote file for reading: %s\n"
+                          "  → SFTP error code: %d\n"
+                          "  → File may not exist, check path and permissions",
+                          op.remote_path.c_str(),
+                          static_cast<int>(
+                              libssh2_sftp_last_error(channel.sftp)))));
+      return true;
+    }
+    libssh2_sftp_seek64(op.handle, op.offset);
+    op.state = ReadOp::State::READ;
+    progress = true;
+  }
+
+  if (op.state == ReadOp::State::READ) {
+    // Same call size as ReadPipelined - libssh2 keeps 4x of it outstanding.
+    // A call that returned EAGAIN is repeated with the same arguments.
+    size_t call_size = SSHClient::ReadCallSize(params);
+
+    while (op.bytes_read < op.length) {
+      size_t bytes_to_read = std::min(op.length - op.bytes_read, call_size);
+      ssize_t nread = libssh2_sftp_read(op.handle, op.buffer + op.bytes_read,
+                                        bytes_to_read);
+      if (nread == LIBSSH2_ERROR_EAGAIN) {
+        return progress;
+      }
+      if (nread < 0) {
+        if (IsConnectionError(static_cast<int>(nread))) {
+          connection_error = "Transient SFTP error: " + std::to_string(nread);
+          return progress;
+        }
+        op.failure = std::make_exception_ptr(IOException(
+            "Failed to read from SFTP file: %s (libssh2 error: %zd, read "
+            "%zu/%zu bytes)",
+            op.remote_path.c_str(), nread, op.bytes_read, op.length));
+        break;
+      }
+      if (nread == 0) {
+        break; // EOF
+      }
+      op.bytes_read += nread;
+      progress = true;
+    }
+    op.state = ReadOp::State::CLOSE;
+  }
+
+  // A failed close does not affect the bytes that were read
+  if (libssh2_sftp_close_handle(op.handle) == LIBSSH2_ERROR_EAGAIN) {
+    return progress;
+  }
+  op.handle = nullptr;
+  Finish(channel, op.failure);
+  return true;
+}
+
+void SSHReactor::Finish(Channel &channel, std::exception_ptr error) {
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    channel.op->error = std::move(error);
+    channel.op->finished = true;
+    in_flight--;
+  }
+  done_cv.notify_all();
+  channel.op.reset();
+}
+
+void SSHReactor::FailQueued(std::exception_ptr error) {
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    for (auto &op : queue) {
+      op->error = error;
+      op->finished = true;
+    }
+    queue.clear();
+  }
+  done_cv.notify_all();
+}
+
+void SSHReactor::ResetConnection(std::exception_ptr error, bool disconnect) {
+  if (!client) {
+    return;
+  }
+  if (client->IsConnected()) {
+    // Close in blocking mode, bounded by a short timeout
+    LIBSSH2_SESSION *session = client->GetSession();
+    libssh2_session_set_timeout(session, CLOSE_TIMEOUT_MS);
+    libssh2_session_set_blocking(session, 1);
+    for (auto &channel : channels) {
+      if (channel.op && channel.op->handle) {
+        libssh2_sftp_close_handle(channel.op->handle);
+        channel.op->handle = nullptr;
+      }
+      if (channel.owned) {
+        libssh2_sftp_shutdown(channel.sftp);
+      }
+    }
+    libssh2_session_set_timeout(session, params.timeout_seconds * 1000);
+  }
+
+  for (auto &channel : channels) {
+    if (channel.op) {
+      Finish(channel, error);
+    }
+  }
+  channels.clear();
+  connection_error.clear();
+
+  client->ReturnSFTPSession(borrowed);
+  borrowed = nullptr;
+  if (disconnect) {
+    // The next user of the lease reconnects
+    client->Disconnect();
+  }
+  pool.Release(client);
+  client.reset();
+  draining = false;
+}
+
+void SSHReactor::Wait(bool busy) {
+  struct pollfd fds[2];
+  nfds_t count = 1;
+  fds[0].fd = wake_pipe[0];
+  fds[0].events = POLLIN;
+  fds[0].revents = 0;
+
+  if (busy) {
+    int directions = libssh2_session_block_directions(client->GetSession());
+    short events = 0;
+    if (directions & LIBSSH2_SESSION_BLOCK_INBOUND) {
+      events |= POLLIN;
+    }
+    if (directions & LIBSSH2_SESSION_BLOCK_OUTBOUND) {
+      events |= POLLOUT;
+    }
+    fds[1].fd = client->GetSocket();
+    fds[1].events = events ? events : POLLIN;
+    fds[1].revents = 0;
+    count = 2;
+  }
+
+  // A channel may have consumed another channel's reply from the socket after
+  // that one returned EAGAIN, so poll briefly while reads are in flight or a
+  // session is held (IDLE_RELEASE). Without one only a submit wakes us.
+  poll(fds, count, busy || client ? 10 : 1000);
+
+  if (fds[0].revents & POLLIN) {
+    char drain[64];
+    while (read(wake_pipe[0], drain, sizeof(drain)) > 0) {
+    }
+  }
+}
+
+void SSHReactor::Wake() {
+  char byte = 0;
+  // A full pipe already has a wakeup pending
+  ssize_t rc = write(wake_pipe[1], &byte, 1);
+  (void)rc;
+}
+
+} // namespace duckdb
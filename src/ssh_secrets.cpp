@@ -14,6 +14,10 @@ CreateSSHSecretFromConfig(ClientContext &context, CreateSecretInput &input) {
 
   // Add all the options from the input to the secret
   for (const auto &option : input.options) {
+    if (option.first == "max_connections" && !option.second.IsNull() &&
+        option.second.GetValue<int64_t>() < 1) {
+      throw InvalidInputException("MAX_CONNECTIONS must be at least 1");
+    }
     secret->secret_map[option.first] = option.second;
   }
 
@@ -45,6 +49,8 @@ void CreateSSHSecretFunctions::Register(ExtensionLoader &loader) {
   ssh_config_fun.named_parameters["port"] = LogicalType::INTEGER;
   ssh_config_fun.named_parameters["host"] = LogicalType::VARCHAR;
   ssh_config_fun.named_parameters["hostname"] = LogicalType::VARCHAR;
+  // Connections the server allows this user (caps sshfs_max_sessions)
+  ssh_config_fun.named_parameters["max_connections"] = LogicalType::INTEGER;
 
   // Register the function with the secret manager
   auto &db = loader.GetDatabaseInstance();
@@ -0,0 +1,893 @@
+#include "ssh_session_pool.hpp"
+#include "duckdb/common/exception.hpp"
+#include "ssh_helpers.hpp"
+#include <algorithm>
+#include <chrono>
+#include <memory>
+#include <openssl/evp.h>
+#include <thread>
+#include <vector>
+
+namespace duckdb {
+
+SSHSessionPool::SSHSessionPool(const SSHConnectionParams &params)
+    : params(params), primary(std::make_shared<SSHClient>(params)),
+      stats(SSHFSStatsRegistry::ForHost(params)),
+      multiplex_channels(params.multiplex_channels),
+      read_backend(params.read_backend), dd_channels(params.dd_channels),
+      compression(params.compression),
+      read_coalesce_gap(params.read_coalesce_gap),
+      verify_uploads(params.verify_uploads),
+      upload_fault_interval(params.upload_fault_interval),
+      max_sessions(std::max<size_t>(1, params.max_sessions)) {
+  PooledClient entry;
+  entry.client = primary;
+  clients.push_back(entry);
+}
+
+SSHSessionPool::~SSHSessionPool() {
+  // The reactor returns its lease on the way out
+  reactor.reset();
+  if (prewarm_thread.joinable()) {
+    prewarm_thread.join();
+  }
+}
+
+bool SSHSessionPool::Prewarm(size_t sessions) {
+  std::lock_guard<std::mutex> lock(mutex);
+  if (prewarming) {
+    return false;
+  }
+  // An earlier warm-up has finished its work
+  if (prewarm_thread.joinable()) {
+    prewarm_thread.join();
+  }
+  prewarming = true;
+  size_t wanted = std::max<size_t>(1, std::min(sessions, max_sessions));
+  prewarm_thread = std::thread([this, wanted]() { RunPrewarm(wanted); });
+  return true;
+}
+
+SSHSessionPool::Health
+SSHSessionPool::Maintain(std::chrono::seconds idle_timeout,
+                         std::chrono::seconds max_lifetime) {
+  auto past = [](std::chrono::steady_clock::duration elapsed,
+                 std::chrono::seconds limit) {
+    return limit.count() > 0 && elapsed > limit;
+  };
+
+  // Reserve the idle extra sessions like a lease, so no query picks one up
+  // while it is checked
+  std::vector<std::shared_ptr<SSHClient>> reserved;
+  bool in_use = false;
+  bool primary_leased = false;
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    for (auto &entry : clients) {
+      if (entry.busy) {
+        in_use = true;
+        primary_leased = primary_leased || entry.client == primary;
+        continue;
+      }
+      if (entry.client != primary) {
+        entry.busy = true;
+        reserved.push_back(entry.client);
+      }
+    }
+  }
+
+  for (auto &client : reserved) {
+    if (!client->IsConnected()) {
+      continue;
+    }
+    if (past(client->GetIdleTime(), idle_timeout)) {
+      SSHFS_LOG("  [MAINTENANCE] Closing idle SSH session to "
+                << params.hostname << ":" << params.port);
+      client->Disconnect();
+      continue;
+    }
+    bool expired = past(client->GetConnectionAge(), max_lifetime);
+    if (expired || !client->ValidateConnection()) {
+      SSHFS_LOG("  [MAINTENANCE] Reconnecting "
+                << (expired ? "expired" : "dead") << " SSH session to "
+                << params.hostname << ":" << params.port);
+      client->Disconnect();
+      try {
+        client->Connect();
+      } catch (const std::exception &e) {
+        // Acquire reconnects it on the next lease
+        SSHFS_LOG("  [MAINTENANCE] Reconnect failed: " << e.what());
+      }
+    }
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    for (auto &entry : clients) {
+      if (std::find(reserved.begin(), reserved.end(), entry.client) !=
+          reserved.end()) {
+        entry.busy = false;
+      }
+    }
+  }
+  cv.notify_all();
+
+  // The primary is also used without a lease (metadata, uploads) - only
+  // touch it while nobody holds its SFTP session
+  if (primary_leased || !primary->IsConnected()) {
+    return Health::HEALTHY;
+  }
+  LIBSSH2_SFTP *sftp = primary->TryBorrowSFTPSession();
+  if (!sftp) {
+    return Health::HEALTHY;
+  }
+  Health health = Health::HEALTHY;
+  if (!in_use && past(primary->GetIdleTime(), idle_timeout)) {
+    health = Health::IDLE;
+  } else if (!primary->ValidateConnection()) {
+    health = Health::DEAD;
+  } else if (past(primary->GetConnectionAge(), max_lifetime)) {
+    health = Health::EXPIRED;
+  }
+  primary->ReturnSFTPSession(sftp);
+  return health;
+}
+
+void SSHSessionPool::WaitForPrewarm() {
+  std::unique_lock<std::mutex> lock(mutex);
+  cv.wait(lock, [this]() { return !prewarming; });
+}
+
+void SSHSessionPool::RunPrewarm(size_t sessions) {
+  // Debug flag is thread-local
+  g_sshfs_debug_enabled = params.debug_logging;
+  auto start = std::chrono::steady_clock::now();
+
+  // Connect is serialized per client, so queries may use the primary
+  // while it connects
+  try {
+    primary->Connect();
+  } catch (const std::exception &e) {
+    SSHFS_LOG("  [PREWARM] Could not connect to " << params.hostname << ":"
+                                                  << params.port << ": "
+                                                  << e.what());
+    std::lock_guard<std::mutex> lock(mutex);
+    prewarming = false;
+    cv.notify_all();
+    return;
+  }
+
+  // Open the extra sessions the same way Acquire grows the pool, but leave
+  // them idle
+  std::unique_lock<std::mutex> lock(mutex);
+  while (CanGrow(sessions)) {
+    auto client = std::make_shared<SSHClient>(params);
+    PooledClient entry;
+    entry.client = client;
+    entry.busy = true;
+    clients.push_back(entry);
+    size_t session_number = clients.size();
+
+    lock.unlock();
+    bool opened = true;
+    try {
+      client->Connect();
+    } catch (const std::exception &e) {
+      SSHFS_LOG("  [PREWARM] Could not open SSH session "
+                << session_number << " to " << params.hostname
+                << ", limiting pool to " << session_number - 1
+                << " sessions: " << e.what());
+      opened = false;
+    }
+    lock.lock();
+
+    auto it = std::find_if(
+        clients.begin(), clients.end(),
+        [&](const PooledClient &entry) { return entry.client == client; });
+    if (opened) {
+      it->busy = false;
+    } else {
+      clients.erase(it);
+      SetLimitReached();
+    }
+    cv.notify_all();
+  }
+  prewarming = false;
+  cv.notify_all();
+
+  SSHFS_LOG("  [PREWARM] " << clients.size() << " SSH session(s) to "
+                           << params.hostname << ":" << params.port
+                           << " ready after "
+                           << std::chrono::duration_cast<
+                                  std::chrono::milliseconds>(
+                                  std::chrono::steady_clock::now() - start)
+                                  .count()
+                           << "ms");
+}
+
+std::shared_ptr<SSHClient> SSHSessionPool::Acquire() {
+  SSHFSWaitTimer wait_timer(stats->session_wait_us);
+  std::unique_lock<std::mutex> lock(mutex);
+
+  // First come, first served: only the oldest waiter may take a session, so
+  // a file handle issuing many reads can't starve the others, and a session
+  // freed by Release can't be grabbed by a newcomer
+  uint64_t ticket = next_ticket++;
+  waiters.push_back(ticket);
+  auto take_turn = [&]() {
+    waiters.pop_front();
+    // The next waiter may find another idle session
+    cv.notify_all();
+  };
+
+  while (true) {
+    if (waiters.front() != ticket) {
+      cv.wait(lock);
+      continue;
+    }
+
+    // Prefer an idle client that is already connected, otherwise hand out an
+    // idle disconnected one (the caller reconnects it)
+    PooledClient *idle = nullptr;
+    for (auto &entry : clients) {
+      if (entry.busy) {
+        continue;
+      }
+      if (entry.client->IsConnected()) {
+        entry.busy = true;
+        take_turn();
+        return entry.client;
+      }
+      if (!idle) {
+        idle = &entry;
+      }
+    }
+    if (idle) {
+      idle->busy = true;
+      take_turn();
+      return idle->client;
+    }
+
+    // All clients busy - open another connection if allowed. When another
+    // pool of the host holds the MAX_CONNECTIONS budget, nothing signals cv
+    // as it frees a slot, so check again shortly.
+    bool can_grow = CanGrow(max_sessions);
+    if (can_grow && !primary->HasConnectionSlot()) {
+      const auto BUDGET_POLL_INTERVAL = std::chrono::milliseconds(50);
+      cv.wait_for(lock, BUDGET_POLL_INTERVAL);
+      continue;
+    }
+    if (can_grow) {
+      auto client = std::make_shared<SSHClient>(params);
+      PooledClient entry;
+      entry.client = client;
+      entry.busy = true;
+      clients.push_back(entry);
+      size_t session_number = clients.size();
+      take_turn();
+
+      // Connect outside the lock - handshake and auth take hundreds of ms
+      lock.unlock();
+      try {
+        client->Connect();
+        SSHFS_LOG("  [POOL] Opened SSH session "
+                  << session_number << "/" << max_sessions << " to "
+                  << params.hostname << ":" << params.port);
+        return client;
+      } catch (const std::exception &e) {
+        SSHFS_LOG("  [POOL] Could not open SSH session "
+                  << session_number << " to " << params.hostname
+                  << ", limiting pool to " << session_number - 1
+                  << " sessions: " << e.what());
+      }
+      lock.lock();
+
+      // Server refused the extra connection (likely a per-user session
+      // limit) - stop growing and wait for one of the existing sessions,
+      // still ahead of everyone who arrived later
+      clients.erase(std::remove_if(clients.begin(), clients.end(),
+                                   [&](const PooledClient &entry) {
+                                     return entry.client == client;
+                                   }),
+                    clients.end());
+      SetLimitReached();
+      waiters.push_front(ticket);
+      continue;
+    }
+
+    cv.wait(lock);
+  }
+}
+
+void SSHSessionPool::Release(const std::shared_ptr<SSHClient> &client) {
+  client->Touch();
+  bool close;
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    close = retired;
+  }
+  if (close) {
+    // Still marked busy, so nobody leases it while it disconnects. The
+    // primary may be in use without a lease.
+    if (client == primary) {
+      client->DisconnectIfIdle();
+    } else {
+      client->Disconnect();
+    }
+  }
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    for (auto &entry : clients) {
+      if (entry.client == client) {
+        entry.busy = false;
+        break;
+      }
+    }
+  }
+  // Wake everyone: only the oldest waiter may take the session
+  cv.notify_all();
+}
+
+void SSHSessionPool::Retire() {
+  std::vector<std::shared_ptr<SSHClient>> idle;
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    retired = true;
+    for (auto &entry : clients) {
+      if (!entry.busy && entry.client->IsConnected()) {
+        entry.busy = true;
+        idle.push_back(entry.client);
+      }
+    }
+  }
+  for (auto &client : idle) {
+    if (client == primary) {
+      client->DisconnectIfIdle();
+    } else {
+      client->Disconnect();
+    }
+  }
+  SSHFS_LOG("  [POOL] Retired pool for " << params.hostname << ":"
+                                         << params.port << ", closed "
+                                         << idle.size() << " idle sessions");
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    for (auto &entry : clients) {
+      if (std::find(idle.begin(), idle.end(), entry.client) != idle.end()) {
+        entry.busy = false;
+      }
+    }
+  }
+  cv.notify_all();
+}
+
+size_t SSHSessionPool::ReadRange(const std::string &remote_path, idx_t offset,
+                                 char *buffer, size_t length) {
+  size_t gap;
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    gap = read_coalesce_gap;
+  }
+  // Large reads gain nothing from waiting for neighbours
+  if (gap == 0 || length >= SSHFSReadCoalescer::MAX_MERGED_SIZE) {
+    return ReadRangeDirect(remote_path, offset, buffer, length);
+  }
+  return coalescer.Read(
+      remote_path, offset, buffer, length, gap,
+      [this](const std::string &path, idx_t range_offset, char *range_buffer,
+             size_t range_length) {
+        return ReadRangeDirect(path, range_offset, range_buffer, range_length);
+      });
+}
+
+size_t SSHSessionPool::ReadRangeDirect(const std::string &remote_path,
+                                       idx_t offset, char *buffer,
+                                       size_t length) {
+  // Retry logic for transient errors (timeout, socket disconnect)
+  const int MAX_RETRIES = 5;
+  int retry_count = 0;
+
+  SSHFSHostStats::Add(stats->read_requests, 1);
+  auto request_start = std::chrono::steady_clock::now();
+  auto finished = [&](size_t bytes_read) {
+    SSHFSHostStats::Add(stats->bytes_read, bytes_read);
+    stats->read_latency.Record(
+        std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now() - request_start)
+            .count());
+    return bytes_read;
+  };
+
+  bool use_dd = UseDD(length);
+  while (retry_count <= MAX_RETRIES) {
+    SSHReactor *multiplexed = use_dd ? nullptr : GetReactor();
+    if (multiplexed) {
+      // The reactor leases (and reconnects) a session by itself - just submit
+      // the read again
+      try {
+        return finished(
+            multiplexed->Read(remote_path, offset, buffer, length));
+      } catch (const IOException &e) {
+        std::string error_msg = e.what();
+        if (error_msg.find("Transient") == std::string::npos ||
+            retry_count >= MAX_RETRIES) {
+          throw;
+        }
+        retry_count++;
+        SSHFSHostStats::Add(stats->retries, 1);
+        SSHFS_LOG("  [RETRY] Transient error on multiplexed read (attempt "
+                  << retry_count << "/" << MAX_RETRIES << ")");
+        std::this_thread::sleep_for(
+            std::chrono::milliseconds(100 * retry_count));
+        continue;
+      }
+    }
+
+    // Lease one SSH session (sshfs_max_sessions). libssh2 sessions are NOT
+    // thread-safe, so reads on the same session are serialized by its SFTP
+    // session pool, while reads on different sessions (each with its own
+    // socket) run in parallel
+    auto lease_start = std::chrono::steady_clock::now();
+    SSHClientLease client(*this);
+    auto lease_ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+                        std::chrono::steady_clock::now() - lease_start)
+                        .count();
+
+    try {
+      if (!client->IsConnected()) {
+        client->Connect();
+      }
+
+      if (use_dd) {
+        size_t channels;
+        bool gzip;
+        {
+          std::lock_guard<std::mutex> lock(mutex);
+          channels = dd_channels;
+          gzip = compression == SSHCompression::GZIP;
+        }
+        return finished(client->ReadBytes(remote_path, buffer, offset, length,
+                                          channels, gzip));
+      }
+
+      // Borrow the leased session's SFTP channel
+      auto sftp_borrow_start = std::chrono::steady_clock::now();
+      LIBSSH2_SFTP *sftp = client->BorrowSFTPSession();
+      auto sftp_borrow_ms =
+          std::chrono::duration_cast<std::chrono::milliseconds>(
+              std::chrono::steady_clock::now() - sftp_borrow_start)
+              .count();
+
+      // Get the cached read handle for this file (opened on first use)
+      auto file_open_start = std::chrono::steady_clock::now();
+      LIBSSH2_SFTP_HANDLE *handle;
+      try {
+        handle = client->AcquireReadHandle(sftp, remote_path);
+      } catch (...) {
+        client->ReturnSFTPSession(sftp);
+        throw;
+      }
+      auto file_open_ms =
+          std::chrono::duration_cast<std::chrono::milliseconds>(
+              std::chrono::steady_clock::now() - file_open_start)
+              .count();
+
+      SSHFS_LOG("  [READ-OPERATION] Got file handle (lease: "
+                << lease_ms << "ms, borrow: " << sftp_borrow_ms
+                << "ms, open: " << file_open_ms << "ms)");
+
+      // Seek to position - seeking discards libssh2's read-ahead, so skip it
+      // for sequential reads on the cached handle
+      if (libssh2_sftp_tell64(handle) != offset) {
+        libssh2_sftp_seek64(handle, offset);
+      }
+
+      // Pipelined read (sshfs_read_window_kb in flight)
+      size_t total_read;
+      try {
+        total_read =
+            client->ReadPipelined(handle, remote_path, buffer, length);
+      } catch (...) {
+        // Handle state is unknown after a failed read - don't reuse it
+        client->ReleaseReadHandle(handle, true);
+        client->ReturnSFTPSession(sftp);
+        throw;
+      }
+
+      // Release handle (stays cached) and return session to pool
+      client->ReleaseReadHandle(handle);
+      client->ReturnSFTPSession(sftp);
+      return finished(total_read);
+
+    } catch (const IOException &e) {
+      // Check if error message contains "Transient"
+      std::string error_msg = e.what();
+      bool is_transient = error_msg.find("Transient") != std::string::npos;
+
+      if (!is_transient || retry_count >= MAX_RETRIES) {
+        // Not transient or out of retries - rethrow
+        throw;
+      }
+
+      // Transient error - retry with reconnection
+      retry_count++;
+      SSHFSHostStats::Add(stats->retries, 1);
+      SSHFS_LOG("  [RETRY] Transient error detected, reconnecting... (attempt "
+                << retry_count << "/" << MAX_RETRIES << ")");
+
+      // Disconnect and reconnect
+      client->Disconnect();
+      std::this_thread::sleep_for(
+          std::chrono::milliseconds(100 * retry_count)); // Exponential backoff
+      client->Connect();
+    }
+  }
+
+  // Should never reach here
+  throw IOException("Failed to read after %d retries", MAX_RETRIES);
+}
+
+void SSHSessionPool::InvalidatePath(const std::string &remote_path) {
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    for (auto &entry : clients) {
+      entry.client->InvalidateReadHandle(remote_path);
+    }
+  }
+  if (block_cache) {
+    block_cache->InvalidateFile(GetCacheKey(remote_path));
+  }
+  if (metadata_cache) {
+    metadata_cache->Invalidate(GetCacheKey(remote_path));
+    for (size_t slash = remote_path.find_last_of('/');
+         slash != std::string::npos && slash > 0;
+         slash = remote_path.find_last_of('/', slash - 1)) {
+      metadata_cache->Invalidate(GetCacheKey(remote_path.substr(0, slash)));
+    }
+  }
+}
+
+void SSHSessionPool::InvalidateTree(const std::string &remote_path) {
+  InvalidatePath(remote_path);
+  std::vector<std::shared_ptr<SSHClient>> snapshot;
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    for (auto &entry : clients) {
+      snapshot.push_back(entry.client);
+    }
+  }
+  // Outside the lock - waits for uploads running on the client
+  for (auto &client : snapshot) {
+    client->ForgetKnownDirectories();
+  }
+  if (metadata_cache) {
+    auto prefix = GetCacheKey(remote_path);
+    if (prefix.empty() || prefix.back() != '/') {
+      prefix += "/";
+    }
+    metadata_cache->InvalidatePrefix(prefix);
+  }
+}
+
+namespace {
+
+std::string HexDigest(const unsigned char *digest, unsigned int length) {
+  static const char *HEX = "0123456789abcdef";
+  std::string hex;
+  for (unsigned int i = 0; i < length; i++) {
+    hex += HEX[digest[i] >> 4];
+    hex += HEX[digest[i] & 0xf];
+  }
+  return hex;
+}
+
+std::string Sha256Hex(const char *data, size_t size) {
+  unsigned char digest[EVP_MAX_MD_SIZE];
+  unsigned int digest_length = 0;
+  if (EVP_Digest(data, size, digest, &digest_length, EVP_sha256(), nullptr) !=
+      1) {
+    throw IOException("Failed to compute sha256 of upload chunk");
+  }
+  return HexDigest(digest, digest_length);
+}
+
+// sha256 of a written range read back over SFTP, for servers that can't run
+// sha256sum. Reads in pieces so a large chunk isn't held twice in memory.
+std::string ReadBackSha256(SSHClient &client, const std::string &remote_path,
+                           idx_t offset, size_t size) {
+  static constexpr size_t PIECE_SIZE = 1024 * 1024;
+
+  // A cached read handle may hold read-ahead from before the write
+  client.InvalidateReadHandle(remote_path);
+
+  std::unique_ptr<EVP_MD_CTX, decltype(&EVP_MD_CTX_free)> ctx(
+      EVP_MD_CTX_new(), EVP_MD_CTX_free);
+  if (!ctx || EVP_DigestInit_ex(ctx.get(), EVP_sha256(), nullptr) != 1) {
+    throw IOException("Failed to compute sha256 of upload chunk");
+  }
+  std::vector<char> piece(std::min(size, PIECE_SIZE));
+  size_t done = 0;
+  while (done < size) {
+    size_t length = std::min(size - done, PIECE_SIZE);
+    size_t read =
+        client.ReadBytesSFTP(remote_path, piece.data(), offset + done, length);
+    if (read == 0) {
+      break; // Shorter than written - the hash won't match
+    }
+    if (EVP_DigestUpdate(ctx.get(), piece.data(), read) != 1) {
+      throw IOException("Failed to compute sha256 of upload chunk");
+    }
+    done += read;
+  }
+
+  unsigned char digest[EVP_MAX_MD_SIZE];
+  unsigned int digest_length = 0;
+  if (EVP_DigestFinal_ex(ctx.get(), digest, &digest_length) != 1) {
+    throw IOException("Failed to compute sha256 of upload chunk");
+  }
+  return HexDigest(digest, digest_length);
+}
+
+} // namespace
+
+void SSHSessionPool::WriteRange(const std::string &remote_path, idx_t offset,
+                                const char *data, size_t size, bool truncate) {
+  const int max_retries = std::max(0, params.max_retries);
+  int retry_count = 0;
+  size_t done = 0; // Bytes of this range confirmed by the server
+
+  SSHFSHostStats::Add(stats->write_requests, 1);
+  auto request_start = std::chrono::steady_clock::now();
+
+  bool verify;
+  bool inject_fault = false;
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    verify = verify_uploads;
+#ifdef SSHFS_TESTING
+    write_calls++;
+    inject_fault = upload_fault_interval > 0 && size > 0 &&
+                   write_calls % upload_fault_interval == 0;
+#endif
+  }
+
+  while (true) {
+    if (retry_count > 0) {
+      // Exponential backoff, without holding a session
+      std::this_thread::sleep_for(std::chrono::milliseconds(
+          static_cast<int64_t>(std::max(0, params.initial_retry_delay_ms))
+          << std::min(retry_count - 1, 10)));
+    }
+
+    SSHClientLease client(*this);
+    size_t confirmed = 0;
+    try {
+      if (!client->IsConnected()) {
+        client->Connect();
+      }
+
+      if (retry_count > 0 && done > 0) {
+        // Resume after the bytes the server acknowledged. The file size
+        // can't tell what is missing once later chunks extended the file; a
+        // prefix the server lost anyway is caught by verify_uploads.
+        SSHFS_LOG("  [RETRY] Resuming upload of " << remote_path << " at "
+                                                  << offset + done);
+      }
+
+      // Test hook: the last byte of the first attempt goes out flipped, the
+      // rest is sent from data as usual
+      bool corrupt = inject_fault && retry_count == 0;
+      size_t length = size - done - (corrupt ? 1 : 0);
+
+      // A truncating write starts over from the beginning of the file
+      client->UploadChunk(remote_path, data + done, length, offset + done,
+                          truncate && done == 0, &confirmed);
+      if (corrupt) {
+        SSHFS_LOG("  [FAULT] Corrupting upload of " << remote_path
+                                                    << " at offset " << offset);
+        char flipped = data[size - 1] ^ 0x5a;
+        client->UploadChunk(remote_path, &flipped, 1, offset + size - 1, false,
+                            nullptr);
+      }
+      done = size;
+      confirmed = 0; // Already counted in done
+
+      if (verify && size > 0) {
+        std::string remote_hash;
+        if (!client->RemoteChecksum(remote_path, offset, size, remote_hash)) {
+          // No sha256sum on the server - read the range back instead
+          remote_hash = ReadBackSha256(*client, remote_path, offset, size);
+        }
+        if (remote_hash != Sha256Hex(data, size)) {
+          // The whole range is rewritten on the next attempt
+          done = 0;
+          throw IOException("Transient checksum mismatch for %s at offset "
+                            "%llu (%zu bytes)",
+                            remote_path, (unsigned long long)offset, size);
+        }
+      }
+      SSHFSHostStats::Add(stats->bytes_written, size);
+      stats->write_latency.Record(
+          std::chrono::duration_cast<std::chrono::microseconds>(
+              std::chrono::steady_clock::now() - request_start)
+              .count());
+      return;
+
+    } catch (const IOException &e) {
+      if (!truncate) {
+        done += confirmed;
+      }
+
+      std::string error_msg = e.what();
+      bool is_transient = error_msg.find("Transient") != std::string::npos;
+      if (!is_transient || retry_count >= max_retries) {
+        throw;
+      }
+
+      retry_count++;
+      SSHFSHostStats::Add(stats->retries, 1);
+      SSHFS_LOG("  [RETRY] Upload of " << remote_path << " failed ("
+                                       << error_msg << "), retrying "
+                                       << retry_count << "/" << max_retries);
+      if (error_msg.find("checksum") == std::string::npos) {
+        // Connection is in an unknown state - reconnect on the next attempt
+        client->Disconnect();
+      }
+    }
+  }
+}
+
+void SSHSessionPool::CloseWriteHandles(const std::string &remote_path) {
+  std::vector<std::shared_ptr<SSHClient>> snapshot;
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    for (auto &entry : clients) {
+      snapshot.push_back(entry.client);
+    }
+  }
+  // Outside the lock - closing waits for the client's SFTP session
+  for (auto &client : snapshot) {
+    client->CloseWriteHandle(remote_path);
+  }
+}
+
+bool SSHSessionPool::StatCached(const std::string &remote_path,
+                                LIBSSH2_SFTP_ATTRIBUTES &attrs) {
+  auto key = GetCacheKey(remote_path);
+  bool exists;
+  if (metadata_cache && metadata_cache->Get(key, attrs, exists)) {
+    SSHFS_LOG("  [STAT] " << remote_path << " from metadata cache"
+                          << (exists ? "" : " (not found)"));
+    return exists;
+  }
+  return StatFresh(remote_path, attrs);
+}
+
+bool SSHSessionPool::StatFresh(const std::string &remote_path,
+                               LIBSSH2_SFTP_ATTRIBUTES &attrs) {
+  auto key = GetCacheKey(remote_path);
+  if (!primary->IsConnected()) {
+    primary->Connect();
+  }
+  bool exists = primary->TryGetFileStats(remote_path, attrs);
+  if (metadata_cache) {
+    if (exists) {
+      metadata_cache->Put(key, attrs);
+    } else {
+      metadata_cache->PutMissing(key);
+    }
+  }
+  return exists;
+}
+
+std::string SSHSessionPool::GetCacheKey(const std::string &remote_path) const {
+  return params.username + "@" + params.hostname + ":" +
+         std::to_string(params.port) + remote_path;
+}
+
+void SSHSessionPool::SetMaxSessions(size_t new_max_sessions) {
+  std::lock_guard<std::mutex> lock(mutex);
+  new_max_sessions = std::max<size_t>(1, new_max_sessions);
+  if (new_max_sessions != max_sessions) {
+    max_sessions = new_max_sessions;
+    limit_reached = false;
+    // Waiters may now open a session
+    cv.notify_all();
+  }
+}
+
+size_t SSHSessionPool::GetMaxSessions() {
+  std::lock_guard<std::mutex> lock(mutex);
+  return max_sessions;
+}
+
+size_t SSHSessionPool::GetSessionCount() {
+  std::lock_guard<std::mutex> lock(mutex);
+  return clients.size();
+}
+
+bool SSHSessionPool::HasIdleSession() {
+  std::lock_guard<std::mutex> lock(mutex);
+  if (!waiters.empty()) {
+    return false;
+  }
+  for (auto &entry : clients) {
+    if (!entry.busy) {
+      return true;
+    }
+  }
+  return CanGrow(max_sessions);
+}
+
+bool SSHSessionPool::CanGrow(size_t limit) {
+  if (limit_reached && std::chrono::steady_clock::now() >= grow_retry_at) {
+    // Servers also refuse while one of our old sessions is still closing or
+    // during a restart - try again now and then
+    limit_reached = false;
+  }
+  return !limit_reached && clients.size() < limit;
+}
+
+void SSHSessionPool::SetLimitReached() {
+  const auto GROW_RETRY_INTERVAL = std::chrono::seconds(30);
+  limit_reached = true;
+  grow_retry_at = std::chrono::steady_clock::now() + GROW_RETRY_INTERVAL;
+}
+
+void SSHSessionPool::SetMultiplexChannels(size_t new_multiplex_channels) {
+  std::lock_guard<std::mutex> lock(mutex);
+  multiplex_channels = new_multiplex_channels;
+  if (reactor && multiplex_channels > 0) {
+    reactor->SetMaxChannels(multiplex_channels);
+  }
+}
+
+void SSHSessionPool::SetReadBackend(SSHReadBackend new_read_backend,
+                                    size_t new_dd_channels,
+                                    SSHCompression new_compression) {
+  std::lock_guard<std::mutex> lock(mutex);
+  read_backend = new_read_backend;
+  dd_channels = std::max<size_t>(1, new_dd_channels);
+  compression = new_compression;
+}
+
+void SSHSessionPool::SetCoalesceGap(size_t new_read_coalesce_gap) {
+  std::lock_guard<std::mutex> lock(mutex);
+  read_coalesce_gap = new_read_coalesce_gap;
+}
+
+void SSHSessionPool::SetUploadVerification(bool new_verify_uploads,
+                                           size_t new_upload_fault_interval) {
+  std::lock_guard<std::mutex> lock(mutex);
+  verify_uploads = new_verify_uploads;
+  upload_fault_interval = new_upload_fault_interval;
+}
+
+bool SSHSessionPool::UseDD(size_t length) {
+  // dd pays a channel open and a process start per read - only worth it for
+  // reads that span several ranges
+  static constexpr size_t AUTO_MIN_READ_SIZE = 4 * 1024 * 1024;
+
+  std::lock_guard<std::mutex> lock(mutex);
+  switch (read_backend) {
+  case SSHReadBackend::DD:
+    return true;
+  case SSHReadBackend::AUTO:
+    return length >= AUTO_MIN_READ_SIZE && primary->SupportsCommands();
+  default:
+    return false;
+  }
+}
+
+SSHReactor *SSHSessionPool::GetReactor() {
+  std::lock_guard<std::mutex> lock(mutex);
+  if (multiplex_channels == 0) {
+    return nullptr;
+  }
+  if (!reactor) {
+    reactor.reset(new SSHReactor(*this, params, multiplex_channels));
+  }
+  return reactor.get();
+}
+
+} // namespace duckdb
@@ -0,0 +1,173 @@
+#include "sshfs_block_cache.hpp"
+#include "ssh_helpers.hpp"
+#include "sshfs_disk_cache.hpp"
+
+namespace duckdb {
+
+SSHFSBlockCache::Block
+SSHFSBlockCache::GetOrReserve(const std::string &file_key,
+                              const SSHFSFileVersion &version,
+                              idx_t block_index, bool &reserved) {
+  reserved = false;
+  std::unique_lock<std::mutex> lock(mutex);
+
+  while (true) {
+    auto &entry = GetEntry(file_key, version);
+
+    auto it = entry.blocks.find(block_index);
+    if (it != entry.blocks.end()) {
+      lru.splice(lru.begin(), lru, it->second.lru_position);
+      return it->second.data;
+    }
+
+    if (entry.in_flight.count(block_index) == 0) {
+      entry.in_flight.insert(block_index);
+      reserved = true;
+      return nullptr;
+    }
+
+    // Another reader (or readahead) is fetching this block - wait for it
+    // rather than downloading it twice
+    fetch_cv.wait(lock);
+  }
+}
+
+bool SSHFSBlockCache::TryReserve(const std::string &file_key,
+                                 const SSHFSFileVersion &version,
+                                 idx_t block_index) {
+  std::lock_guard<std::mutex> lock(mutex);
+  auto &entry = GetEntry(file_key, version);
+  if (entry.blocks.count(block_index) > 0 ||
+      entry.in_flight.count(block_index) > 0) {
+    return false;
+  }
+  entry.in_flight.insert(block_index);
+  return true;
+}
+
+void SSHFSBlockCache::EndFetch(const std::string &file_key,
+                               const SSHFSFileVersion &version,
+                               idx_t block_index, Block block) {
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = files.find(file_key);
+    if (it == files.end()) {
+      return;
+    }
+    auto &entry = it->second;
+    entry.in_flight.erase(block_index);
+    bool stale = entry.stale.erase(block_index) > 0;
+
+    if (block && !stale && entry.version == version && capacity_bytes > 0) {
+      lru.emplace_front(file_key, block_index);
+      CachedBlock cached;
+      cached.data = std::move(block);
+      cached.lru_position = lru.begin();
+      used_bytes += cached.data->size();
+      entry.blocks[block_index] = std::move(cached);
+      EvictToCapacity();
+    } else if (entry.blocks.empty() && entry.in_flight.empty()) {
+      files.erase(it);
+    }
+  }
+  fetch_cv.notify_all();
+}
+
+void SSHFSBlockCache::InvalidateFile(const std::string &file_key) {
+  std::shared_ptr<SSHFSDiskCache> disk;
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    disk = disk_cache;
+    auto it = files.find(file_key);
+    if (it != files.end()) {
+      SSHFS_LOG("  [BLOCK-CACHE] Invalidated " << file_key);
+      DropBlocks(it->second);
+      if (it->second.in_flight.empty()) {
+        files.erase(it);
+      }
+    }
+  }
+  if (disk) {
+    disk->InvalidateFile(file_key);
+  }
+}
+
+void SSHFSBlockCache::SetDiskCache(std::shared_ptr<SSHFSDiskCache> cache) {
+  std::lock_guard<std::mutex> lock(mutex);
+  disk_cache = std::move(cache);
+}
+
+std::shared_ptr<SSHFSDiskCache> SSHFSBlockCache::GetDiskCache() {
+  std::lock_guard<std::mutex> lock(mutex);
+  return disk_cache;
+}
+
+void SSHFSBlockCache::SetCapacity(size_t new_capacity_bytes) {
+  std::lock_guard<std::mutex> lock(mutex);
+  capacity_bytes = new_capacity_bytes;
+  EvictToCapacity();
+}
+
+size_t SSHFSBlockCache::GetCapacity() {
+  std::lock_guard<std::mutex> lock(mutex);
+  return capacity_bytes;
+}
+
+size_t SSHFSBlockCache::GetMemoryUsage() {
+  std::lock_guard<std::mutex> lock(mutex);
+  return used_bytes;
+}
+
+SSHFSBlockCache::FileEntry &
+SSHFSBlockCache::GetEntry(const std::string &file_key,
+                          const SSHFSFileVersion &version) {
+  auto it = files.find(file_key);
+  if (it == files.end()) {
+    FileEntry entry;
+    entry.version = version;
+    return files.emplace(file_key, std::move(entry)).first->second;
+  }
+
+  auto &entry = it->second;
+  if (entry.version != version) {
+    // Remote file changed (or the block size setting did) - never serve the
+    // old contents
+    SSHFS_LOG("  [BLOCK-CACHE] " << file_key
+                                 << " changed on the server, dropping "
+                                 << entry.blocks.size() << " cached blocks");
+    DropBlocks(entry);
+    entry.version = version;
+  }
+  return entry;
+}
+
+void SSHFSBlockCache::DropBlocks(FileEntry &entry) {
+  for (auto &block : entry.blocks) {
+    used_bytes -= block.second.data->size();
+    lru.erase(block.second.lru_position);
+  }
+  entry.blocks.clear();
+  // Fetches already in flight complete normally but are not cached
+  entry.stale.insert(entry.in_flight.begin(), entry.in_flight.end());
+}
+
+void SSHFSBlockCache::EvictToCapacity() {
+  while (used_bytes > capacity_bytes && !lru.empty()) {
+    auto &victim = lru.back();
+    auto file_it = files.find(victim.first);
+    if (file_it != files.end()) {
+      auto &entry = file_it->second;
+      auto block_it = entry.blocks.find(victim.second);
+      if (block_it != entry.blocks.end()) {
+        used_bytes -= block_it->second.data->size();
+        entry.blocks.erase(block_it);
+      }
+      if (entry.blocks.empty() && entry.in_flight.empty()) {
+        files.erase(file_it);
+      }
+    }
+    lru.pop_back();
+  }
+}
+
+} // namespace duckdb
@@ -0,0 +1,287 @@
+#include "sshfs_buffer_pool.hpp"
+#include "duckdb/common/exception.hpp"
+#include "ssh_helpers.hpp"
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace duckdb {
+
+namespace {
+
+// Allocates the file's disk blocks up front: writing to a sparse shared
+// mapping on a full disk raises SIGBUS instead of returning an error.
+// Returns 0 or an errno value.
+int ReserveSpace(int fd, size_t capacity) {
+#ifdef __APPLE__
+  fstore_t store = {F_ALLOCATEALL, F_PEOFPOSMODE, 0,
+                    static_cast<off_t>(capacity), 0};
+  if (fcntl(fd, F_PREALLOCATE, &store) != 0) {
+    return errno;
+  }
+  return ftruncate(fd, static_cast<off_t>(capacity)) == 0 ? 0 : errno;
+#else
+  return posix_fallocate(fd, 0, static_cast<off_t>(capacity));
+#endif
+}
+
+[[noreturn]] void ThrowSpillError(const std::string &directory,
+                                  const char *operation, int error) {
+  throw IOException("Failed to %s upload spill file in '%s': %s\n"
+                    "  → Check that temp_directory is writable and has free "
+                    "space, or disable sshfs_upload_spill",
+                    operation, directory.c_str(), strerror(error));
+}
+
+} // namespace
+
+SSHFSStagingBuffer::~SSHFSStagingBuffer() { Unmap(); }
+
+SSHFSStagingBuffer::SSHFSStagingBuffer(SSHFSStagingBuffer &&other) noexcept
+    : heap(std::move(other.heap)), mapping(other.mapping),
+      mapped_size(other.mapped_size), mapped_capacity(other.mapped_capacity),
+      fd(other.fd) {
+  other.heap = std::vector<char>();
+  other.mapping = nullptr;
+  other.mapped_size = 0;
+  other.mapped_capacity = 0;
+  other.fd = -1;
+}
+
+SSHFSStagingBuffer &
+SSHFSStagingBuffer::operator=(SSHFSStagingBuffer &&other) noexcept {
+  if (this != &other) {
+    Unmap();
+    heap = std::move(other.heap);
+    mapping = other.mapping;
+    mapped_size = other.mapped_size;
+    mapped_capacity = other.mapped_capacity;
+    fd = other.fd;
+    other.heap = std::vector<char>();
+    other.mapping = nullptr;
+    other.mapped_size = 0;
+    other.mapped_capacity = 0;
+    other.fd = -1;
+  }
+  return *this;
+}
+
+SSHFSStagingBuffer SSHFSStagingBuffer::Allocate(size_t capacity) {
+  SSHFSStagingBuffer buffer;
+  buffer.heap.reserve(capacity);
+  return buffer;
+}
+
+SSHFSStagingBuffer SSHFSStagingBuffer::MapTempFile(const std::string &directory,
+                                                   size_t capacity) {
+  // DuckDB creates its temp directory lazily
+  if (mkdir(directory.c_str(), 0700) != 0 && errno != EEXIST) {
+    ThrowSpillError(directory, "create directory for", errno);
+  }
+
+  std::string path = directory + "/sshfs_upload_XXXXXX";
+  std::vector<char> name(path.begin(), path.end());
+  name.push_back('\0');
+  int file = mkstemp(name.data());
+  if (file < 0) {
+    ThrowSpillError(directory, "create", errno);
+  }
+  // Only the descriptor is needed - the space is freed when it is closed,
+  // even if the process crashes
+  unlink(name.data());
+
+  int error = ReserveSpace(file, capacity);
+  if (error != 0) {
+    close(file);
+    ThrowSpillError(directory, "allocate", error);
+  }
+  void *memory = mmap(nullptr, capacity, PROT_READ | PROT_WRITE, MAP_SHARED,
+                      file, 0);
+  if (memory == MAP_FAILED) {
+    error = errno;
+    close(file);
+    ThrowSpillError(directory, "map", error);
+  }
+
+  SSHFSStagingBuffer buffer;
+  buffer.mapping = static_cast<char *>(memory);
+  buffer.mapped_capacity = capacity;
+  buffer.fd = file;
+  return buffer;
+}
+
+void SSHFSStagingBuffer::Append(const char *data, size_t length) {
+  if (!mapping) {
+    heap.insert(heap.end(), data, data + length);
+    return;
+  }
+  if (length > mapped_capacity - mapped_size) {
+    throw InternalException("Append of %zu bytes overflows upload spill "
+                            "buffer (%zu of %zu bytes used)",
+                            length, mapped_size, mapped_capacity);
+  }
+  std::memcpy(mapping + mapped_size, data, length);
+  mapped_size += length;
+}
+
+void SSHFSStagingBuffer::Clear() {
+  if (!mapping) {
+    heap.clear(); // Keeps the capacity
+    return;
+  }
+  if (mapped_size == 0) {
+    return;
+  }
+  mapped_size = 0;
+  // Truncating drops the uploaded pages from the page cache without writing
+  // them back; the blocks are then reserved again for the next chunk
+  if (ftruncate(fd, 0) != 0 || ReserveSpace(fd, mapped_capacity) != 0) {
+    SSHFS_LOG("  [BUFFER-POOL] Failed to reset upload spill file: "
+              << strerror(errno));
+    Unmap();
+  }
+}
+
+void SSHFSStagingBuffer::Unmap() {
+  if (mapping) {
+    munmap(mapping, mapped_capacity);
+    close(fd);
+    mapping = nullptr;
+    mapped_size = 0;
+    mapped_capacity = 0;
+    fd = -1;
+  }
+}
+
+constexpr size_t SSHFSBufferPool::MAX_FREE_BUFFERS;
+
+SSHFSStagingBuffer SSHFSBufferPool::Acquire(size_t capacity) {
+  std::unique_lock<std::mutex> lock(mutex);
+  while (true) {
+    // Reuse an idle buffer that is large enough
+    for (auto it = free_buffers.begin(); it != free_buffers.end(); ++it) {
+      if (it->Capacity() >= capacity) {
+        SSHFSStagingBuffer buffer = std::move(*it);
+        free_buffers.erase(it);
+        return buffer;
+      }
+    }
+
+    if (used_bytes + capacity <= limit_bytes || uploading_bytes == 0) {
+      if (used_bytes + capacity > limit_bytes) {
+        SSHFS_LOG("  [BUFFER-POOL] Exceeding upload memory limit ("
+                  << limit_bytes / (1024 * 1024)
+                  << " MB) - all memory is held by staging buffers");
+      }
+      // Account before allocating outside the lock
+      used_bytes += capacity;
+      std::string directory = spill_directory;
+      lock.unlock();
+      SSHFSStagingBuffer buffer;
+      try {
+        buffer = directory.empty()
+                     ? SSHFSStagingBuffer::Allocate(capacity)
+                     : SSHFSStagingBuffer::MapTempFile(directory, capacity);
+      } catch (...) {
+        lock.lock();
+        used_bytes -= capacity;
+        throw;
+      }
+      if (buffer.Capacity() != capacity) {
+        // Release accounts by the actual capacity
+        lock.lock();
+        used_bytes += buffer.Capacity() - capacity;
+      }
+      return buffer;
+    }
+
+    // Idle buffers that are too small (chunk size changed) make room first
+    if (!free_buffers.empty()) {
+      used_bytes -= free_buffers.back().Capacity();
+      free_buffers.pop_back();
+      continue;
+    }
+
+    // Wait for an upload to return its buffer
+    released_cv.wait(lock);
+  }
+}
+
+void SSHFSBufferPool::MarkUploading(const SSHFSStagingBuffer &buffer) {
+  std::lock_guard<std::mutex> lock(mutex);
+  uploading_bytes += buffer.Capacity();
+}
+
+void SSHFSBufferPool::Release(SSHFSStagingBuffer buffer, bool uploading) {
+  size_t capacity = buffer.Capacity();
+  if (capacity == 0) {
+    return;
+  }
+  // Outside the lock - resetting a spill file is a syscall
+  buffer.Clear();
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (uploading) {
+      uploading_bytes -= capacity;
+    }
+    // Buffers of the other kind (spilling was toggled) or a spill file that
+    // failed to reset are freed
+    if (buffer.Capacity() == 0 ||
+        buffer.IsMapped() == spill_directory.empty()) {
+      used_bytes -= capacity;
+    } else {
+      free_buffers.push_back(std::move(buffer));
+    }
+    TrimFreeBuffers();
+  }
+  released_cv.notify_all();
+}
+
+void SSHFSBufferPool::SetLimit(size_t new_limit_bytes) {
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    limit_bytes = new_limit_bytes;
+    TrimFreeBuffers();
+  }
+  released_cv.notify_all();
+}
+
+size_t SSHFSBufferPool::GetLimit() {
+  std::lock_guard<std::mutex> lock(mutex);
+  return limit_bytes;
+}
+
+void SSHFSBufferPool::SetSpillDirectory(const std::string &directory) {
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (directory == spill_directory) {
+      return;
+    }
+    spill_directory = directory;
+    // Idle buffers are in the old location
+    for (auto &buffer : free_buffers) {
+      used_bytes -= buffer.Capacity();
+    }
+    free_buffers.clear();
+  }
+  released_cv.notify_all();
+}
+
+size_t SSHFSBufferPool::GetMemoryUsage() {
+  std::lock_guard<std::mutex> lock(mutex);
+  return used_bytes;
+}
+
+void SSHFSBufferPool::TrimFreeBuffers() {
+  while (!free_buffers.empty() && (free_buffers.size() > MAX_FREE_BUFFERS ||
+                                   used_bytes > limit_bytes)) {
+    used_bytes -= free_buffers.front().Capacity();
+    free_buffers.erase(free_buffers.begin());
+  }
+}
+
+} // namespace duckdb
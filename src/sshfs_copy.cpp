@@ -0,0 +1,87 @@
+#include "sshfs_copy.hpp"
+#include "duckdb/function/table_function.hpp"
+#include "duckdb/main/client_context_file_opener.hpp"
+#include "duckdb/main/extension/extension_loader.hpp"
+#include "sshfs_filesystem.hpp"
+
+namespace duckdb {
+
+namespace {
+
+struct SSHFSCopyInfo : public TableFunctionInfo {
+  explicit SSHFSCopyInfo(SSHFSFileSystem &fs) : fs(fs) {}
+  SSHFSFileSystem &fs;
+};
+
+struct SSHFSCopyBindData : public TableFunctionData {
+  explicit SSHFSCopyBindData(SSHFSFileSystem &fs) : fs(fs) {}
+  SSHFSFileSystem &fs;
+  string source;
+  string target;
+};
+
+struct SSHFSCopyState : public GlobalTableFunctionState {
+  bool done = false;
+};
+
+unique_ptr<FunctionData> SSHFSCopyBind(ClientContext &context,
+                                       TableFunctionBindInput &input,
+                                       vector<LogicalType> &return_types,
+                                       vector<string> &names) {
+  auto &info = input.info->Cast<SSHFSCopyInfo>();
+  auto result = make_uniq<SSHFSCopyBindData>(info.fs);
+  result->source = input.inputs[0].GetValue<string>();
+  result->target = input.inputs[1].GetValue<string>();
+  for (auto &url : {result->source, result->target}) {
+    if (!info.fs.CanHandleFile(url)) {
+      throw InvalidInputException(
+          "sshfs_copy expects sshfs://, ssh:// or sftp:// URLs, got '%s'",
+          url);
+    }
+  }
+
+  names = {"source", "target", "bytes", "method"};
+  return_types = {LogicalType::VARCHAR, LogicalType::VARCHAR,
+                  LogicalType::UBIGINT, LogicalType::VARCHAR};
+  return std::move(result);
+}
+
+unique_ptr<GlobalTableFunctionState>
+SSHFSCopyInit(ClientContext &context, TableFunctionInitInput &input) {
+  return make_uniq<SSHFSCopyState>();
+}
+
+void SSHFSCopyScan(ClientContext &context, TableFunctionInput &data,
+                   DataChunk &output) {
+  auto &bind_data = data.bind_data->Cast<SSHFSCopyBindData>();
+  auto &state = data.global_state->Cast<SSHFSCopyState>();
+  if (state.done) {
+    output.SetCardinality(0);
+    return;
+  }
+  state.done = true;
+
+  ClientContextFileOpener opener(context);
+  string method;
+  auto bytes = bind_data.fs.CopyFile(bind_data.source, bind_data.target,
+                                     &opener, method);
+
+  output.SetValue(0, 0, Value(bind_data.source));
+  output.SetValue(1, 0, Value(bind_data.target));
+  output.SetValue(2, 0, Value::UBIGINT(bytes));
+  output.SetValue(3, 0, Value(method));
+  output.SetCardinality(1);
+}
+
+} // namespace
+
+void SSHFSCopyFunction::Register(ExtensionLoader &loader,
+                                 SSHFSFileSystem &fs) {
+  TableFunction copy_function("sshfs_copy",
+                              {LogicalType::VARCHAR, LogicalType::VARCHAR},
+                              SSHFSCopyScan, SSHFSCopyBind, SSHFSCopyInit);
+  copy_function.function_info = make_shared_ptr<SSHFSCopyInfo>(fs);
+  loader.RegisterFunction(copy_function);
+}
+
+} // namespace duckdb
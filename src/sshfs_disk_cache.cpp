@@ -0,0 +1,313 @@
+#include "sshfs_disk_cache.hpp"
+#include "duckdb/common/exception.hpp"
+#include "ssh_helpers.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <dirent.h>
+#include <fstream>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <utime.h>
+
+namespace duckdb {
+
+namespace {
+
+// Block file layout: magic, key length (uint32), key, data length (uint64),
+// data. The key is stored so a hash collision is detected instead of served.
+const char BLOCK_MAGIC[] = "SSHFSBLK1";
+const size_t BLOCK_MAGIC_SIZE = sizeof(BLOCK_MAGIC) - 1;
+const char BLOCK_SUFFIX[] = ".blk";
+
+// FilePrefix part of a block file name (hash and dash)
+std::string FilePrefixOf(const std::string &name) {
+  return name.substr(0, name.find('-') + 1);
+}
+
+bool EndsWith(const std::string &s, const std::string &suffix) {
+  return s.size() >= suffix.size() &&
+         s.compare(s.size() - suffix.size(), suffix.size(), suffix) == 0;
+}
+
+// mkdir -p
+void CreateDirectories(const std::string &path) {
+  std::string current;
+  size_t pos = 0;
+  while (pos != std::string::npos) {
+    pos = path.find('/', pos + 1);
+    current = path.substr(0, pos);
+    if (current.empty()) {
+      continue;
+    }
+    if (mkdir(current.c_str(), 0700) != 0 && errno != EEXIST) {
+      throw IOException("Failed to create sshfs cache directory '%s': %s\n"
+                        "  → Check sshfs_cache_directory points to a "
+                        "writable location",
+                        path.c_str(), strerror(errno));
+    }
+  }
+}
+
+} // namespace
+
+SSHFSDiskCache::SSHFSDiskCache(std::string directory_p, size_t max_bytes)
+    : directory(std::move(directory_p)), max_bytes(max_bytes) {
+  while (directory.size() > 1 && directory.back() == '/') {
+    directory.pop_back();
+  }
+  CreateDirectories(directory);
+  LoadIndex();
+  std::lock_guard<std::mutex> lock(mutex);
+  EvictToCapacity();
+}
+
+SSHFSBlockCache::Block SSHFSDiskCache::Get(const std::string &file_key,
+                                           const SSHFSFileVersion &version,
+                                           idx_t block_index) {
+  auto name = BlockFileName(file_key, version, block_index);
+  auto full_path = directory + "/" + name;
+
+  std::ifstream file(full_path, std::ios::binary);
+  if (!file) {
+    return nullptr;
+  }
+
+  char magic[BLOCK_MAGIC_SIZE];
+  uint32_t key_length = 0;
+  uint64_t data_length = 0;
+  bool valid = static_cast<bool>(file.read(magic, BLOCK_MAGIC_SIZE)) &&
+               std::memcmp(magic, BLOCK_MAGIC, BLOCK_MAGIC_SIZE) == 0 &&
+               file.read(reinterpret_cast<char *>(&key_length),
+                         sizeof(key_length)) &&
+               key_length == file_key.size();
+  std::string stored_key;
+  if (valid) {
+    stored_key.resize(key_length);
+    valid = file.read(&stored_key[0], key_length) && stored_key == file_key &&
+            file.read(reinterpret_cast<char *>(&data_length),
+                      sizeof(data_length)) &&
+            data_length <= version.block_size;
+  }
+  auto block = std::make_shared<std::vector<char>>();
+  if (valid) {
+    block->resize(data_length);
+    valid = static_cast<bool>(file.read(block->data(), data_length));
+  }
+  file.close();
+
+  std::lock_guard<std::mutex> lock(mutex);
+  if (!valid) {
+    // Truncated (crash during write) or collision - drop it
+    SSHFS_LOG("  [DISK-CACHE] Discarding invalid block file " << name);
+    Remove(name);
+    return nullptr;
+  }
+
+  // Refresh the mtime so other processes see the block as recently used
+  utime(full_path.c_str(), nullptr);
+  Touch(name, BlockFileSize(file_key, block->size()));
+  SSHFS_LOG("  [DISK-CACHE] Hit for block " << block_index << " of "
+                                            << file_key);
+  return block;
+}
+
+void SSHFSDiskCache::Put(const std::string &file_key,
+                         const SSHFSFileVersion &version, idx_t block_index,
+                         const std::vector<char> &data) {
+  auto name = BlockFileName(file_key, version, block_index);
+  auto file_size = BlockFileSize(file_key, data.size());
+  size_t counter;
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (max_bytes == 0 || file_size > max_bytes) {
+      return;
+    }
+    counter = temp_counter++;
+  }
+
+  // Write to a temporary file and rename, so readers (including other
+  // processes) never see a partial block
+  auto full_path = directory + "/" + name;
+  auto temp_path = full_path + ".tmp." + std::to_string(getpid()) + "." +
+                   std::to_string(counter);
+  {
+    std::ofstream file(temp_path, std::ios::binary | std::ios::trunc);
+    uint32_t key_length = static_cast<uint32_t>(file_key.size());
+    uint64_t data_length = data.size();
+    file.write(BLOCK_MAGIC, BLOCK_MAGIC_SIZE);
+    file.write(reinterpret_cast<const char *>(&key_length),
+               sizeof(key_length));
+    file.write(file_key.data(), file_key.size());
+    file.write(reinterpret_cast<const char *>(&data_length),
+               sizeof(data_length));
+    file.write(data.data(), data.size());
+    file.close();
+    if (!file) {
+      SSHFS_LOG("  [DISK-CACHE] Failed to write " << temp_path);
+      std::remove(temp_path.c_str());
+      return;
+    }
+  }
+  if (std::rename(temp_path.c_str(), full_path.c_str()) != 0) {
+    std::remove(temp_path.c_str());
+    return;
+  }
+
+  std::lock_guard<std::mutex> lock(mutex);
+  Touch(name, file_size);
+  EvictToCapacity();
+}
+
+void SSHFSDiskCache::InvalidateFile(const std::string &file_key) {
+  std::lock_guard<std::mutex> lock(mutex);
+
+  // Only indexed blocks are removed. Blocks other processes cached after
+  // LoadIndex are named after the old size and mtime, so the written file's
+  // new version never matches them, and they age out through the LRU.
+  auto it = file_blocks.find(FilePrefix(file_key));
+  if (it == file_blocks.end()) {
+    return;
+  }
+  // Copy - Remove() erases from the set
+  std::vector<std::string> names(it->second.begin(), it->second.end());
+  for (auto &name : names) {
+    Remove(name);
+  }
+  if (!names.empty()) {
+    SSHFS_LOG("  [DISK-CACHE] Invalidated " << names.size() << " blocks of "
+                                            << file_key);
+  }
+}
+
+void SSHFSDiskCache::SetMaxSize(size_t new_max_bytes) {
+  std::lock_guard<std::mutex> lock(mutex);
+  max_bytes = new_max_bytes;
+  EvictToCapacity();
+}
+
+size_t SSHFSDiskCache::GetUsedBytes() {
+  std::lock_guard<std::mutex> lock(mutex);
+  return used_bytes;
+}
+
+std::string SSHFSDiskCache::FilePrefix(const std::string &file_key) {
+  // FNV-1a - stable across processes and builds, unlike std::hash
+  uint64_t hash = 14695981039346656037ULL;
+  for (unsigned char c : file_key) {
+    hash ^= c;
+    hash *= 1099511628211ULL;
+  }
+  char hex[17];
+  snprintf(hex, sizeof(hex), "%016llx", static_cast<unsigned long long>(hash));
+  return std::string(hex) + "-";
+}
+
+size_t SSHFSDiskCache::BlockFileSize(const std::string &file_key,
+                                     size_t data_size) {
+  return BLOCK_MAGIC_SIZE + sizeof(uint32_t) + file_key.size() +
+         sizeof(uint64_t) + data_size;
+}
+
+std::string SSHFSDiskCache::BlockFileName(const std::string &file_key,
+                                          const SSHFSFileVersion &version,
+                                          idx_t block_index) {
+  return FilePrefix(file_key) + std::to_string(version.size) + "-" +
+         std::to_string(version.mtime) + "-" +
+         std::to_string(version.block_size) + "-" +
+         std::to_string(block_index) + BLOCK_SUFFIX;
+}
+
+void SSHFSDiskCache::LoadIndex() {
+  DIR *dir = opendir(directory.c_str());
+  if (!dir) {
+    return;
+  }
+
+  struct FoundBlock {
+    std::string name;
+    size_t size;
+    time_t mtime;
+  };
+  std::vector<FoundBlock> found;
+  while (auto entry = readdir(dir)) {
+    std::string name = entry->d_name;
+    struct stat st;
+    if (stat((directory + "/" + name).c_str(), &st) != 0 ||
+        !S_ISREG(st.st_mode)) {
+      continue;
+    }
+    if (name.find(".tmp.") != std::string::npos) {
+      // Left behind by a crashed process
+      if (st.st_mtime < time(nullptr) - 3600) {
+        std::remove((directory + "/" + name).c_str());
+      }
+      continue;
+    }
+    if (EndsWith(name, BLOCK_SUFFIX)) {
+      found.push_back({name, static_cast<size_t>(st.st_size), st.st_mtime});
+    }
+  }
+  closedir(dir);
+
+  // Oldest first, so the most recently used block ends up at the LRU front
+  std::sort(found.begin(), found.end(),
+            [](const FoundBlock &a, const FoundBlock &b) {
+              return a.mtime < b.mtime;
+            });
+
+  std::lock_guard<std::mutex> lock(mutex);
+  for (auto &block : found) {
+    Touch(block.name, block.size);
+  }
+  SSHFS_LOG("  [DISK-CACHE] Indexed " << index.size() << " blocks ("
+                                      << used_bytes / (1024 * 1024)
+                                      << " MB) in " << directory);
+}
+
+void SSHFSDiskCache::Touch(const std::string &name, size_t size) {
+  auto it = index.find(name);
+  if (it != index.end()) {
+    used_bytes -= it->second.size;
+    it->second.size = size;
+    used_bytes += size;
+    lru.splice(lru.begin(), lru, it->second.lru_position);
+    return;
+  }
+  lru.push_front(name);
+  IndexEntry entry;
+  entry.size = size;
+  entry.lru_position = lru.begin();
+  index[name] = entry;
+  used_bytes += size;
+  file_blocks[FilePrefixOf(name)].insert(name);
+}
+
+void SSHFSDiskCache::Remove(const std::string &name) {
+  std::remove((directory + "/" + name).c_str());
+  auto it = index.find(name);
+  if (it == index.end()) {
+    return;
+  }
+  used_bytes -= it->second.size;
+  lru.erase(it->second.lru_position);
+  index.erase(it);
+  auto blocks = file_blocks.find(FilePrefixOf(name));
+  if (blocks != file_blocks.end()) {
+    blocks->second.erase(name);
+    if (blocks->second.empty()) {
+      file_blocks.erase(blocks);
+    }
+  }
+}
+
+void SSHFSDiskCache::EvictToCapacity() {
+  while (used_bytes > max_bytes && !lru.empty()) {
+    // Copy - Remove() erases the list node
+    std::string victim = lru.back();
+    Remove(victim);
+  }
+}
+
+} // namespace duckdb
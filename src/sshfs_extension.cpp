@@ -6,7 +6,11 @@
 #include "duckdb/main/config.hpp"
 #include "duckdb/main/extension/extension_loader.hpp"
 #include "ssh_secrets.hpp"
+#include "sshfs_copy.hpp"
 #include "sshfs_filesystem.hpp"
+#include "sshfs_ls.hpp"
+#include "sshfs_prewarm.hpp"
+#include "sshfs_stats.hpp"
 
 namespace duckdb {
 
@@ -48,6 +52,181 @@ static void LoadInternal(ExtensionLoader &loader) {
       "may improve speed but use more connections)",
       LogicalType::BIGINT, Value::BIGINT(2));
 
+  config.AddExtensionOption(
+      "sshfs_upload_threads",
+      "Number of chunk uploads running at once across all files and hosts "
+      "(default: 8)",
+      LogicalType::BIGINT, Value::BIGINT(8));
+
+  config.AddExtensionOption(
+      "sshfs_max_host_uploads",
+      "Number of chunk uploads running at once against the same host "
+      "(default: 4)",
+      LogicalType::BIGINT, Value::BIGINT(4));
+
+  config.AddExtensionOption(
+      "sshfs_upload_memory_limit_mb",
+      "Memory limit in MB for upload buffers of all open files, writers wait "
+      "for running uploads when it is reached (default: 1024)",
+      LogicalType::BIGINT, Value::BIGINT(1024));
+
+  config.AddExtensionOption(
+      "sshfs_upload_spill",
+      "Stage upload chunks in memory-mapped files under temp_directory "
+      "instead of memory, so sshfs_upload_memory_limit_mb caps disk space "
+      "(default: false)",
+      LogicalType::BOOLEAN, Value(false));
+
+  config.AddExtensionOption(
+      "sshfs_atomic_uploads",
+      "Upload to a hidden temporary file and rename it to the target path "
+      "once all data is written, so readers never see a partial file "
+      "(default: false). Servers without posix-rename or SFTP v5 overwrite "
+      "leave the target missing for a moment while it is replaced",
+      LogicalType::BOOLEAN, Value(false));
+
+  config.AddExtensionOption(
+      "sshfs_verify_uploads",
+      "Verify every uploaded chunk against a sha256sum computed on the "
+      "server (or read back over SFTP) and resend it on mismatch (default: "
+      "false)",
+      LogicalType::BOOLEAN, Value(false));
+
+#ifdef SSHFS_TESTING
+  // Test hook, only in builds with -DSSHFS_TESTING=ON
+  config.AddExtensionOption(
+      "sshfs_debug_upload_fault_interval",
+      "For testing: the first attempt of every Nth chunk upload writes "
+      "corrupted data, to exercise sshfs_verify_uploads (default: 0, "
+      "disabled)",
+      LogicalType::BIGINT, Value::BIGINT(0));
+#endif
+
+  config.AddExtensionOption(
+      "sshfs_compression",
+      "Compress transfers: 'none' (default), 'ssh' (zlib compression of the "
+      "SSH connection) or 'gzip' (dd reads streamed through gzip on the "
+      "server)",
+      LogicalType::VARCHAR, Value("none"));
+
+  config.AddExtensionOption(
+      "sshfs_cipher_preference",
+      "Order of SSH ciphers and MACs: 'default' (libssh2's order), "
+      "'throughput' (AES-GCM or chacha20-poly1305 first, whichever is faster "
+      "on this machine), 'compat' (CTR and CBC modes for old servers) or a "
+      "comma-separated list of cipher names",
+      LogicalType::VARCHAR, Value("default"));
+
+  config.AddExtensionOption(
+      "sshfs_read_backend",
+      "How remote files are read: 'sftp' (default), 'dd' (dd over parallel "
+      "exec channels, falls back to SFTP on SFTP-only servers) or 'auto' (dd "
+      "for large reads on servers that can run commands)",
+      LogicalType::VARCHAR, Value("sftp"));
+
+  config.AddExtensionOption(
+      "sshfs_dd_channels",
+      "Exec channels one dd read is split across (default: 4, fewer are used "
+      "if the server limits channels per connection)",
+      LogicalType::BIGINT, Value::BIGINT(4));
+
+  config.AddExtensionOption(
+      "sshfs_read_window_kb",
+      "SFTP read data in KB kept in flight per file handle (default: 2048, "
+      "higher values help on high latency links)",
+      LogicalType::BIGINT, Value::BIGINT(2048));
+
+  config.AddExtensionOption(
+      "sshfs_read_coalesce_gap_kb",
+      "Merge concurrent reads of the same file that are less than this many "
+      "KB apart into one request (default: 0 = disabled)",
+      LogicalType::BIGINT, Value::BIGINT(0));
+
+  config.AddExtensionOption(
+      "sshfs_channel_window_kb",
+      "Receive window in KB of the SSH channels opened for SFTP and dd reads "
+      "(default: 0 = sized from the measured round trip time)",
+      LogicalType::BIGINT, Value::BIGINT(0));
+
+  config.AddExtensionOption(
+      "sshfs_socket_buffer_kb",
+      "TCP send and receive buffer size in KB of SSH connections (default: 0 "
+      "= operating system autotuning)",
+      LogicalType::BIGINT, Value::BIGINT(0));
+
+  config.AddExtensionOption(
+      "sshfs_tcp_nodelay",
+      "Disable Nagle's algorithm on SSH connections (default: true)",
+      LogicalType::BOOLEAN, Value(true));
+
+  config.AddExtensionOption(
+      "sshfs_max_sessions",
+      "Maximum number of independent SSH connections per host used for "
+      "parallel reads (default: 1, keep at 1 for servers with strict "
+      "connection limits such as Hetzner Storage Boxes)",
+      LogicalType::BIGINT, Value::BIGINT(1));
+
+  config.AddExtensionOption(
+      "sshfs_multiplex_channels",
+      "Concurrent reads multiplexed as SFTP channels over one of the pooled "
+      "SSH sessions, without an extra login (default: 0 = each read leases a "
+      "session)",
+      LogicalType::BIGINT, Value::BIGINT(0));
+
+  config.AddExtensionOption(
+      "sshfs_block_cache_size_mb",
+      "Memory budget in MB for cached blocks of remote files, shared by all "
+      "connections (default: 256, set to 0 to disable the block cache)",
+      LogicalType::BIGINT, Value::BIGINT(256));
+
+  config.AddExtensionOption(
+      "sshfs_block_size_kb",
+      "Size in KB of the blocks kept in the block cache (default: 1024)",
+      LogicalType::BIGINT, Value::BIGINT(1024));
+
+  config.AddExtensionOption(
+      "sshfs_readahead_blocks",
+      "Number of blocks prefetched in the background when a file is read "
+      "sequentially (default: 4, set to 0 to disable readahead)",
+      LogicalType::BIGINT, Value::BIGINT(4));
+
+  config.AddExtensionOption(
+      "sshfs_cache_directory",
+      "Local directory for a persistent cache of remote file blocks, shared "
+      "across DuckDB processes (default: empty, disabled)",
+      LogicalType::VARCHAR, Value(""));
+
+  config.AddExtensionOption(
+      "sshfs_cache_max_size_mb",
+      "Maximum size in MB of sshfs_cache_directory, least recently used "
+      "blocks are evicted first (default: 10240)",
+      LogicalType::BIGINT, Value::BIGINT(10240));
+
+  config.AddExtensionOption(
+      "sshfs_metadata_cache_ttl_ms",
+      "How long file attributes (including 'file not found') are cached and "
+      "shared by all file handles, in milliseconds (default: 10000, set to 0 "
+      "to disable)",
+      LogicalType::BIGINT, Value::BIGINT(10000));
+
+  config.AddExtensionOption(
+      "sshfs_max_open_handles",
+      "Maximum number of SFTP read handles kept open per SSH connection "
+      "(default: 64, set to 0 to close handles after every read)",
+      LogicalType::BIGINT, Value::BIGINT(64));
+
+  config.AddExtensionOption(
+      "sshfs_idle_timeout_seconds",
+      "Close SSH connections that have not been used for this many seconds "
+      "(default: 0, keep them open)",
+      LogicalType::BIGINT, Value::BIGINT(0));
+
+  config.AddExtensionOption(
+      "sshfs_max_connection_lifetime_seconds",
+      "Reconnect SSH connections that have been open for this many seconds "
+      "(default: 0, no limit)",
+      LogicalType::BIGINT, Value::BIGINT(0));
+
   config.AddExtensionOption(
       "ssh_keepalive",
       "SSH keepalive interval in seconds (default: 60, set to 0 to disable). "
@@ -62,10 +241,18 @@ static void LoadInternal(ExtensionLoader &loader) {
       LogicalType::BOOLEAN, Value(false));
 
   auto &fs = db.GetFileSystem();
-  fs.RegisterSubSystem(make_uniq<SSHFSFileSystem>());
+  auto sshfs = make_uniq<SSHFSFileSystem>();
+  auto &sshfs_fs = *sshfs;
+  fs.RegisterSubSystem(std::move(sshfs));
 
   // Register SSH secrets
   CreateSSHSecretFunctions::Register(loader);
+
+  // I/O statistics per host and connection warm-up
+  SSHFSStatsFunction::Register(loader);
+  SSHFSPrewarmFunction::Register(loader, sshfs_fs);
+  SSHFSCopyFunction::Register(loader, sshfs_fs);
+  SSHFSListFunction::Register(loader, sshfs_fs);
 }
 
 void SshfsExtension::Load(ExtensionLoader &loader) { LoadInternal(loader); }
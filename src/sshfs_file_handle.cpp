@@ -1,42 +1,44 @@
 #include "sshfs_file_handle.hpp"
 #include "duckdb/common/exception.hpp"
 #include "ssh_helpers.hpp"
+#include "sshfs_disk_cache.hpp"
 #include "sshfs_filesystem.hpp"
 #include <algorithm>
 #include <chrono>
+#include <cstring>
+#include <functional>
 #include <iostream>
-#include <thread>
+#include <random>
+#include <sstream>
 
 namespace duckdb {
 
-// Global mutex to serialize all SFTP reads across all file handles
-// Critical for servers with strict SFTP session limits (e.g., Hetzner)
-// Ensures only one file handle reads at a time, sharing the single SFTP session
-static std::mutex g_sftp_read_mutex;
-
-// Global cache of SFTP file handles (one per file path)
-// Allows multiple DuckDB file handles to share one SFTP file handle
-// Key: file path, Value: {sftp_session, file_handle, read_mutex}
-struct GlobalFileHandle {
-  LIBSSH2_SFTP *sftp;
-  LIBSSH2_SFTP_HANDLE *handle;
-  std::shared_ptr<SSHClient> client;
-  std::shared_ptr<std::mutex>
-      read_mutex; // Protects concurrent reads on this handle
-};
-static std::unordered_map<std::string, GlobalFileHandle> g_file_handles;
-static std::mutex g_file_handles_mutex;
-
 SSHFSFileHandle::SSHFSFileHandle(FileSystem &file_system, std::string path,
                                  FileOpenFlags flags,
-                                 std::shared_ptr<SSHClient> client,
+                                 std::shared_ptr<SSHSessionPool> session_pool,
                                  const SSHConnectionParams &params)
     : FileHandle(file_system, path, flags), path(params.remote_path),
-      ssh_client(std::move(client)), connection_params(params),
+      session_pool(std::move(session_pool)),
+      ssh_client(this->session_pool->GetPrimary()), connection_params(params),
+      buffer_pool(this->session_pool->GetBufferPool()),
       chunk_size(params.chunk_size),
-      max_concurrent_uploads(params.max_concurrent_uploads) {
-  // Initialize write buffer
-  write_buffer.reserve(chunk_size);
+      max_concurrent_uploads(params.max_concurrent_uploads),
+      block_size(std::max<size_t>(1, params.block_size)),
+      readahead_blocks(params.readahead_blocks) {
+  // Blocks of a file that is being written would go stale immediately
+  use_block_cache =
+      !flags.OpenForWriting() && this->session_pool->GetBlockCache() &&
+      (params.block_cache_size > 0 || !params.cache_directory.empty());
+  if (use_block_cache) {
+    cache_key = this->session_pool->GetCacheKey(params.remote_path);
+  }
+
+  // Atomic uploads go to a hidden file next to the target, renamed on Close
+  upload_path = path;
+  atomic_upload = flags.OpenForWriting() && params.atomic_uploads;
+  if (atomic_upload) {
+    upload_path = TempUploadPath(path);
+  }
 
   SSHFS_LOG("  [HANDLE] Created file handle for " << params.remote_path);
 }
@@ -47,17 +49,18 @@ SSHFSFileHandle::~SSHFSFileHandle() {
   } catch (...) {
     // Destructor should not throw
   }
+  ReleaseWriteBuffer();
 }
 
 void SSHFSFileHandle::Close() {
   auto close_start = std::chrono::steady_clock::now();
 
-  // No read handle cleanup needed - we open/close per read operation
+  // Read handles live in the per-connection SFTPHandleCache
 
-  if (!write_buffer.empty() || buffer_dirty) {
+  if (!write_buffer.Empty() || buffer_dirty) {
     try {
       auto flush_start = std::chrono::steady_clock::now();
-      Flush();
+      FlushChunk(true);
       auto flush_end = std::chrono::steady_clock::now();
       auto flush_ms = std::chrono::duration_cast<std::chrono::milliseconds>(
                           flush_end - flush_start)
@@ -66,23 +69,22 @@ void SSHFSFileHandle::Close() {
         std::cerr << "[TIMING] Final Flush: " << flush_ms << "ms" << std::endl;
       }
     } catch (std::exception &e) {
-      // Rethrow - no cleanup needed with direct append
+      // Don't leave a partial temp file behind
+      AbortAtomicUpload();
       throw;
     }
   }
 
   // Wait for all async uploads to complete
-  if (chunk_count > 0) {
+  if (upload_group) {
+    SSHFSWaitTimer wait_timer(session_pool->GetStats()->upload_wait_us);
     auto wait_start = std::chrono::steady_clock::now();
-    size_t initial_uploads = uploads_in_progress.load();
     if (IsDebugLoggingEnabled()) {
-      std::cerr << "[TIMING] Waiting for " << initial_uploads
+      std::cerr << "[TIMING] Waiting for " << upload_group->GetPendingCount()
                 << " async uploads to complete..." << std::endl;
     }
 
-    std::unique_lock<std::mutex> lock(buffers_lock);
-    upload_complete_cv.wait(
-        lock, [this]() { return uploads_in_progress.load() == 0; });
+    upload_group->Wait();
 
     auto wait_end = std::chrono::steady_clock::now();
     auto wait_ms = std::chrono::duration_cast<std::chrono::milliseconds>(
@@ -93,11 +95,27 @@ void SSHFSFileHandle::Close() {
                 << std::endl;
     }
 
+    // Write handles were kept open between chunks - close them now that
+    // every chunk is on the server
+    session_pool->CloseWriteHandles(upload_path);
+
     // Check for errors after all uploads complete
-    CheckUploadErrors();
+    try {
+      CheckUploadErrors();
+    } catch (...) {
+      AbortAtomicUpload();
+      throw;
+    }
+    CommitAtomicUpload();
+
+    // Cached read handles may still see the old file contents
+    session_pool->InvalidatePath(path);
   }
 
-  // No assembly or cleanup needed - chunks appended directly to final file
+  // Nothing left to stage - hand the buffer back to the pool
+  ReleaseWriteBuffer();
+
+  // No assembly needed - chunks were written at their offsets
 
   auto close_end = std::chrono::steady_clock::now();
   auto close_ms = std::chrono::duration_cast<std::chrono::milliseconds>(
@@ -117,19 +135,32 @@ int64_t SSHFSFileHandle::Write(void *buffer, int64_t nr_bytes) {
   size_t bytes_written = 0;
 
   while (bytes_written < static_cast<size_t>(nr_bytes)) {
+    // Whole chunks of a large write go straight from DuckDB's memory to the
+    // server - only an unaligned tail is staged
+    size_t remaining = static_cast<size_t>(nr_bytes) - bytes_written;
+    if (write_buffer.Empty() && remaining >= chunk_size) {
+      size_t direct = remaining - remaining % chunk_size;
+      WriteDirect(data + bytes_written, direct);
+      bytes_written += direct;
+      continue;
+    }
+
+    if (!has_write_buffer) {
+      AcquireWriteBuffer();
+    }
+
     // Calculate how much we can write to current buffer
-    size_t space_left = chunk_size - write_buffer.size();
+    size_t space_left = chunk_size - write_buffer.Size();
     size_t to_write =
         std::min(space_left, static_cast<size_t>(nr_bytes) - bytes_written);
 
     // Append to buffer
-    write_buffer.insert(write_buffer.end(), data + bytes_written,
-                        data + bytes_written + to_write);
+    write_buffer.Append(data + bytes_written, to_write);
     buffer_dirty = true;
     bytes_written += to_write;
 
     // If buffer is full, flush it
-    if (write_buffer.size() >= chunk_size) {
+    if (write_buffer.Size() >= chunk_size) {
       FlushChunk();
     }
   }
@@ -141,9 +172,15 @@ int64_t SSHFSFileHandle::Write(void *buffer, int64_t nr_bytes) {
 }
 
 void SSHFSFileHandle::Flush() {
-  if (!write_buffer.empty() && buffer_dirty) {
+  if (!write_buffer.Empty() && buffer_dirty) {
     FlushChunk();
   }
+  // FileSync / Truncate expect the data to be on the server
+  if (upload_group) {
+    SSHFSWaitTimer wait_timer(session_pool->GetStats()->upload_wait_us);
+    upload_group->Wait();
+    CheckUploadErrors();
+  }
 }
 
 int64_t SSHFSFileHandle::Read(void *buffer, int64_t nr_bytes) {
@@ -166,155 +203,302 @@ int64_t SSHFSFileHandle::Read(void *buffer, int64_t nr_bytes) {
               << " bytes at position " << file_position << std::endl;
   }
 
-  // Retry logic for transient errors (timeout, socket disconnect)
-  const int MAX_RETRIES = 5;
-  int retry_count = 0;
-  int64_t result = 0;
+  char *buf = static_cast<char *>(buffer);
+  size_t length = static_cast<size_t>(nr_bytes);
+  idx_t read_position = file_position;
+
+  size_t total_read;
+  bool from_cache = false;
+  SSHFSFileVersion version;
+  // Reads larger than the memory budget bypass it unless they can be kept in
+  // the disk cache
+  if (use_block_cache && GetFileVersion(version) &&
+      (length <= session_pool->GetBlockCache()->GetCapacity() ||
+       session_pool->GetBlockCache()->GetDiskCache())) {
+    total_read = ReadCached(version, read_position, buf, length);
+    from_cache = true;
+  } else {
+    total_read = session_pool->ReadRange(path, read_position, buf, length);
+  }
 
-  while (retry_count <= MAX_RETRIES) {
-    try {
-      // Serialize ALL SFTP operations globally (critical for thread safety)
-      // libssh2 SFTP sessions share the same SSH socket and are NOT thread-safe
-      // We borrow single SFTP session, open file, read, close file, return
-      // session
-      // - all within this lock
-      std::lock_guard<std::mutex> lock(g_sftp_read_mutex);
-
-      if (!ssh_client->IsConnected()) {
-        ssh_client->Connect();
-      }
+  // Update file position
+  file_position += total_read;
 
-      // Borrow the single SFTP session from pool (reused across all reads)
-      // This is safe because we close the file handle immediately after reading
-      auto sftp_borrow_start = std::chrono::steady_clock::now();
-      LIBSSH2_SFTP *sftp = ssh_client->BorrowSFTPSession();
-      auto sftp_borrow_ms =
-          std::chrono::duration_cast<std::chrono::milliseconds>(
-              std::chrono::steady_clock::now() - sftp_borrow_start)
-              .count();
-
-      // Open file for this read
-      auto file_open_start = std::chrono::steady_clock::now();
-      LIBSSH2_SFTP_HANDLE *handle =
-          libssh2_sftp_open(sftp, path.c_str(), LIBSSH2_FXF_READ, 0);
-      if (!handle) {
-        int sftp_error = libssh2_sftp_last_error(sftp);
-        ssh_client->ReturnSFTPSession(sftp);
-        throw IOException("Failed to open remote file for reading: %s\n"
-                          "  → SFTP error code: %d\n"
-                          "  → File may not exist, check path and permissions\n"
-                          "  → Verify file exists on server before reading",
-                          path.c_str(), sftp_error);
-      }
-      auto file_open_ms =
-          std::chrono::duration_cast<std::chrono::milliseconds>(
-              std::chrono::steady_clock::now() - file_open_start)
-              .count();
+  auto read_end = std::chrono::steady_clock::now();
+  auto read_ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+                     read_end - read_start)
+                     .count();
+  if (IsDebugLoggingEnabled()) {
+    std::cerr << "  [READ-COMPLETE] Read " << total_read << " bytes in "
+              << read_ms << "ms ("
+              << (from_cache ? "block cache" : "pooled session") << ")"
+              << std::endl;
+  }
 
-      if (IsDebugLoggingEnabled()) {
-        std::cerr << "  [READ-OPERATION] Opened file (borrow: "
-                  << sftp_borrow_ms << "ms, open: " << file_open_ms << "ms)"
-                  << std::endl;
-      }
+  // Sequential access detection - the second read that starts where the
+  // previous one ended triggers readahead of the following blocks
+  if (from_cache) {
+    if (read_position == last_read_end && read_position > 0) {
+      sequential_reads++;
+    } else {
+      sequential_reads = 0;
+    }
+    last_read_end = file_position;
+    if (sequential_reads > 0 && total_read > 0) {
+      ScheduleReadahead(version, file_position);
+    }
+  }
 
-      // Seek to position
-      libssh2_sftp_seek64(handle, file_position);
+  return static_cast<int64_t>(total_read);
+}
 
-      // Read in chunks (256KB chunks for better network throughput)
-      const size_t CHUNK_SIZE = 262144;
-      size_t total_read = 0;
-      char *buf = static_cast<char *>(buffer);
+bool SSHFSFileHandle::GetFileVersion(SSHFSFileVersion &version) {
+  LIBSSH2_SFTP_ATTRIBUTES attrs;
+  try {
+    if (!version_validated) {
+      // Cached blocks are only as fresh as their key: a file another client
+      // changed within the metadata cache TTL must get a new version
+      if (!session_pool->StatFresh(path, attrs)) {
+        return false;
+      }
+      cached_file_stats = attrs;
+      stats_cached = true;
+      version_validated = true;
+    }
+    attrs = GetCachedFileStats();
+  } catch (...) {
+    return false;
+  }
+  if (!(attrs.flags & LIBSSH2_SFTP_ATTR_SIZE)) {
+    return false;
+  }
+  version.size = attrs.filesize;
+  version.mtime =
+      (attrs.flags & LIBSSH2_SFTP_ATTR_ACMODTIME) ? attrs.mtime : 0;
+  version.block_size = block_size;
+  return true;
+}
 
-      while (total_read < static_cast<size_t>(nr_bytes)) {
-        size_t bytes_remaining = static_cast<size_t>(nr_bytes) - total_read;
-        size_t bytes_to_read = std::min(bytes_remaining, CHUNK_SIZE);
+namespace {
+
+// Complete the reservations for blocks [run_start, run_start + run_count):
+// blocks found in the disk cache are used as is, the rest are fetched with
+// one pipelined read per contiguous gap and written back to the disk cache.
+// on_block sees every block as it completes. On error all reservations that
+// are still open are released and the exception is rethrown.
+void FetchReservedBlocks(
+    SSHSessionPool &pool, SSHFSBlockCache &cache,
+    const std::string &remote_path, const std::string &cache_key,
+    const SSHFSFileVersion &version, idx_t run_start, idx_t run_count,
+    const std::function<void(idx_t, const std::vector<char> &)> &on_block) {
+  const size_t block_size = version.block_size;
+  auto expected_size = [&](idx_t block_index) {
+    idx_t block_offset = block_index * block_size;
+    return std::min<size_t>(block_size, version.size - block_offset);
+  };
+
+  std::vector<bool> done(run_count, false);
+  try {
+    auto disk = cache.GetDiskCache();
+    if (disk) {
+      for (idx_t i = 0; i < run_count; i++) {
+        auto block = disk->Get(cache_key, version, run_start + i);
+        if (block && block->size() == expected_size(run_start + i)) {
+          on_block(run_start + i, *block);
+          cache.EndFetch(cache_key, version, run_start + i, std::move(block));
+          done[i] = true;
+        }
+      }
+    }
 
-        ssize_t nread =
-            libssh2_sftp_read(handle, buf + total_read, bytes_to_read);
+    idx_t i = 0;
+    while (i < run_count) {
+      if (done[i]) {
+        i++;
+        continue;
+      }
+      idx_t gap_start = i;
+      while (i < run_count && !done[i]) {
+        i++;
+      }
 
-        if (nread < 0) {
-          int sftp_error = libssh2_sftp_last_error(sftp);
-          if (IsDebugLoggingEnabled()) {
-            std::cerr << "  [READ-ERROR] libssh2_sftp_read failed: " << nread
-                      << ", SFTP error: " << sftp_error
-                      << ", total_read so far: " << total_read << std::endl;
-          }
-          libssh2_sftp_close(handle);
-          ssh_client->ReturnSFTPSession(sftp);
-
-          // Check if this is a transient error worth retrying
-          if (nread == LIBSSH2_ERROR_TIMEOUT ||
-              nread == LIBSSH2_ERROR_SOCKET_DISCONNECT ||
-              nread == LIBSSH2_ERROR_SOCKET_SEND ||
-              nread == LIBSSH2_ERROR_SOCKET_RECV) {
-            // Throw to trigger retry logic below
-            throw IOException("Transient SFTP error: %zd", nread);
+      idx_t gap_offset = (run_start + gap_start) * block_size;
+      size_t gap_length = std::min<size_t>((i - gap_start) * block_size,
+                                           version.size - gap_offset);
+      std::vector<char> data(gap_length);
+      size_t bytes_read =
+          pool.ReadRange(remote_path, gap_offset, data.data(), gap_length);
+
+      for (idx_t j = gap_start; j < i; j++) {
+        idx_t block_index = run_start + j;
+        size_t block_offset = (j - gap_start) * block_size;
+        auto block = std::make_shared<std::vector<char>>();
+        if (block_offset < bytes_read) {
+          auto block_end =
+              std::min<size_t>(bytes_read, block_offset + block_size);
+          block->assign(data.begin() + block_offset, data.begin() + block_end);
+        }
+        on_block(block_index, *block);
+        // Only complete blocks are cached - a short read means the file
+        // changed after it was stat'ed
+        if (block->size() == expected_size(block_index)) {
+          if (disk) {
+            disk->Put(cache_key, version, block_index, *block);
           }
-
-          // Permanent error - don't retry
-          throw IOException("Failed to read from SFTP file: %s (libssh2 error: "
-                            "%zd, SFTP error: %d, read %zu/%lld bytes)",
-                            path, nread, sftp_error, total_read, nr_bytes);
-        } else if (nread == 0) {
-          break; // EOF
+          cache.EndFetch(cache_key, version, block_index, std::move(block));
+        } else {
+          cache.EndFetch(cache_key, version, block_index, nullptr);
         }
-
-        total_read += nread;
+        done[j] = true;
       }
+    }
+  } catch (...) {
+    for (idx_t i = 0; i < run_count; i++) {
+      if (!done[i]) {
+        cache.EndFetch(cache_key, version, run_start + i, nullptr);
+      }
+    }
+    throw;
+  }
+}
 
-      // Close file and return session to pool
-      libssh2_sftp_close(handle);
-      ssh_client->ReturnSFTPSession(sftp);
+} // namespace
 
-      // Update file position
-      file_position += total_read;
+size_t SSHFSFileHandle::ReadCached(const SSHFSFileVersion &version,
+                                   idx_t position, char *buffer,
+                                   size_t length) {
+  if (position >= version.size) {
+    return 0;
+  }
+  length = std::min<size_t>(length, version.size - position);
+
+  auto &cache = *session_pool->GetBlockCache();
+  idx_t end = position + length;
+  idx_t first_block = position / block_size;
+  idx_t last_block = (end - 1) / block_size;
+
+  // Copy the part of a block that overlaps [position, end) into buffer
+  size_t copied = 0;
+  bool short_block = false;
+  auto copy_block = [&](idx_t block_index, const std::vector<char> &data) {
+    if (short_block) {
+      return;
+    }
+    idx_t block_start = block_index * block_size;
+    idx_t from = std::max<idx_t>(position, block_start);
+    idx_t to = std::min<idx_t>(end, block_start + data.size());
+    if (to > from) {
+      std::memcpy(buffer + (from - position),
+                  data.data() + (from - block_start), to - from);
+      copied += to - from;
+    }
+    if (block_start + data.size() < std::min<idx_t>(end, block_start +
+                                                             block_size)) {
+      // File shrank since it was stat'ed - stop at the short block
+      short_block = true;
+    }
+  };
+
+  // Consecutive missing blocks are fetched together
+  idx_t run_start = 0;
+  idx_t run_count = 0;
+  auto fetch_run = [&]() {
+    if (run_count == 0) {
+      return;
+    }
+    idx_t count = run_count;
+    run_count = 0;
+    FetchReservedBlocks(*session_pool, cache, path, cache_key, version,
+                        run_start, count, copy_block);
+  };
 
-      auto read_end = std::chrono::steady_clock::now();
-      auto read_ms = std::chrono::duration_cast<std::chrono::milliseconds>(
-                         read_end - read_start)
-                         .count();
-      if (IsDebugLoggingEnabled()) {
-        std::cerr << "  [READ-COMPLETE] Read " << total_read << " bytes in "
-                  << read_ms << "ms (pooled session, closed file handle)"
-                  << std::endl;
+  try {
+    for (idx_t block_index = first_block; block_index <= last_block;
+         block_index++) {
+      bool reserved;
+      auto block =
+          cache.GetOrReserve(cache_key, version, block_index, reserved);
+      if (reserved) {
+        if (run_count == 0) {
+          run_start = block_index;
+        }
+        run_count++;
+        continue;
+      }
+      fetch_run();
+      copy_block(block_index, *block);
+      if (short_block) {
+        break;
       }
+    }
+    fetch_run();
+  } catch (...) {
+    // Release blocks reserved after the failed run
+    for (idx_t i = 0; i < run_count; i++) {
+      cache.EndFetch(cache_key, version, run_start + i, nullptr);
+    }
+    throw;
+  }
 
-      return static_cast<int64_t>(total_read);
+  return copied;
+}
 
-    } catch (const IOException &e) {
-      // Check if error message contains "Transient"
-      std::string error_msg = e.what();
-      bool is_transient = error_msg.find("Transient") != std::string::npos;
+void SSHFSFileHandle::ScheduleReadahead(const SSHFSFileVersion &version,
+                                        idx_t position) {
+  auto scheduler = session_pool->GetReadaheadScheduler();
+  if (readahead_blocks == 0 || position >= version.size || !scheduler) {
+    return;
+  }
 
-      if (!is_transient || retry_count >= MAX_RETRIES) {
-        // Not transient or out of retries - rethrow
-        throw;
-      }
+  idx_t first_block = (position + block_size - 1) / block_size;
+  idx_t block_count = (version.size + block_size - 1) / block_size;
+  idx_t last_block =
+      std::min<idx_t>(first_block + readahead_blocks, block_count);
+
+  // The job owns everything it touches - the handle may be closed first.
+  // Blocks are reserved when it runs, so a queued job never holds up a
+  // foreground read of the same blocks.
+  auto pool = session_pool;
+  auto cache = session_pool->GetBlockCache();
+  auto remote_path = path;
+  auto key = cache_key;
+  scheduler->Submit([pool, cache, remote_path, key, version, first_block,
+                     last_block]() {
+    // Never make a foreground read wait for a session
+    if (!pool->HasIdleSession()) {
+      return;
+    }
 
-      // Transient error - retry with reconnection
-      retry_count++;
-      if (IsDebugLoggingEnabled()) {
-        std::cerr
-            << "  [RETRY] Transient error detected, reconnecting... (attempt "
-            << retry_count << "/" << MAX_RETRIES << ")" << std::endl;
+    // Reserve the first contiguous run of blocks that aren't cached yet
+    idx_t run_start = 0;
+    idx_t run_count = 0;
+    for (idx_t block_index = first_block; block_index < last_block;
+         block_index++) {
+      if (cache->TryReserve(key, version, block_index)) {
+        if (run_count == 0) {
+          run_start = block_index;
+        }
+        run_count++;
+      } else if (run_count > 0) {
+        break;
       }
-
-      // Disconnect and reconnect
-      ssh_client->Disconnect();
-      std::this_thread::sleep_for(
-          std::chrono::milliseconds(100 * retry_count)); // Exponential backoff
-      ssh_client->Connect();
     }
-  }
+    if (run_count == 0) {
+      return;
+    }
 
-  // Should never reach here
-  throw IOException("Failed to read after %d retries", MAX_RETRIES);
+    SSHFS_LOG("  [READAHEAD] Prefetching blocks "
+              << run_start << "-" << run_start + run_count - 1 << " of "
+              << remote_path);
+    FetchReservedBlocks(*pool, *cache, remote_path, key, version, run_start,
+                        run_count, [](idx_t, const std::vector<char> &) {});
+  });
 }
 
 void SSHFSFileHandle::Seek(idx_t location) { file_position = location; }
 
-void SSHFSFileHandle::FlushChunk() {
-  if (write_buffer.empty()) {
+void SSHFSFileHandle::FlushChunk(bool last) {
+  if (write_buffer.Empty()) {
     return;
   }
 
@@ -326,36 +510,34 @@ void SSHFSFileHandle::FlushChunk() {
   // Create buffer object for async upload
   auto buffer = std::make_shared<SSHFSWriteBuffer>();
   buffer->part_no = chunk_count;
+  buffer->offset = bytes_flushed;
   buffer->data = std::move(write_buffer); // Move to avoid copy
+  write_buffer = SSHFSStagingBuffer();
+  has_write_buffer = false;
+  if (buffer_pool) {
+    buffer_pool->MarkUploading(buffer->data);
+    buffer->pool = buffer_pool;
+  }
+  bytes_flushed += buffer->data.Size();
 
   if (IsDebugLoggingEnabled()) {
-    double mb_size = buffer->data.size() / (1024.0 * 1024.0);
+    double mb_size = buffer->data.Size() / (1024.0 * 1024.0);
     std::cerr << "[TIMING] FlushChunk #" << chunk_count << " (" << mb_size
-              << " MB) - queueing for async "
-              << (chunk_count == 0 ? "upload" : "append") << std::endl;
+              << " MB at offset " << buffer->offset
+              << ") - queueing for async upload" << std::endl;
   }
 
-  // Wait if too many uploads in progress
-  {
-    std::unique_lock<std::mutex> lock(buffers_lock);
-    upload_complete_cv.wait(lock, [this]() {
-      return uploads_in_progress < max_concurrent_uploads ||
-             has_upload_error.load();
-    });
-
-    // Check for errors again after wait
-    CheckUploadErrors();
-
-    // Add buffer to active list
-    write_buffers.push_back(buffer);
+  // A file that fits in one chunk is created by that chunk's upload
+  bool truncate = chunk_count == 0 && last;
+  if (!truncate) {
+    EnsureFileCreated();
   }
 
-  // Start async upload
-  uploads_in_progress.fetch_add(1);
-  UploadChunkAsync(buffer);
+  // Queue on the shared scheduler - blocks while this handle already has
+  // max_concurrent_uploads chunks queued or uploading
+  UploadChunkAsync(buffer, truncate);
 
-  // Reset for next chunk
-  write_buffer.clear();
+  // Reset for next chunk (the next write acquires a new buffer)
   buffer_dirty = false;
   chunk_count++;
 
@@ -369,154 +551,207 @@ void SSHFSFileHandle::FlushChunk() {
   }
 }
 
-void SSHFSFileHandle::OpenForRead() {
-  if (read_initialized) {
-    return; // Already open
+void SSHFSFileHandle::AcquireWriteBuffer() {
+  if (buffer_pool) {
+    write_buffer = buffer_pool->Acquire(chunk_size);
+  } else {
+    write_buffer = SSHFSStagingBuffer::Allocate(chunk_size);
   }
+  has_write_buffer = true;
+}
 
-  auto open_start = std::chrono::steady_clock::now();
-
-  if (!ssh_client->IsConnected()) {
-    ssh_client->Connect();
+void SSHFSFileHandle::ReleaseWriteBuffer() {
+  if (!has_write_buffer) {
+    return;
   }
+  if (buffer_pool) {
+    buffer_pool->Release(std::move(write_buffer), false);
+  }
+  write_buffer = SSHFSStagingBuffer();
+  has_write_buffer = false;
+}
 
-  // Borrow SFTP session from pool (shared across file handles)
-  // This allows multiple file handles to share one SFTP session efficiently
-  // Critical for servers with strict session limits (e.g., Hetzner)
-  auto sftp_init_start = std::chrono::steady_clock::now();
-  read_sftp = ssh_client->BorrowSFTPSession();
-  auto sftp_init_ms = std::chrono::duration_cast<std::chrono::milliseconds>(
-                          std::chrono::steady_clock::now() - sftp_init_start)
-                          .count();
-
-  // Open file for reading (kept open for entire file handle lifetime)
-  auto file_open_start = std::chrono::steady_clock::now();
-  read_handle = libssh2_sftp_open(read_sftp, path.c_str(), LIBSSH2_FXF_READ, 0);
-  if (!read_handle) {
-    int sftp_error = libssh2_sftp_last_error(read_sftp);
-    char *err_msg = nullptr;
-    int session_error = libssh2_session_last_error(ssh_client->GetSession(),
-                                                   &err_msg, nullptr, 0);
-    libssh2_sftp_shutdown(read_sftp);
-    read_sftp = nullptr;
-    throw IOException("Failed to open remote file for reading: %s\n"
-                      "  SFTP error: %d\n"
-                      "  Session error: %d (%s)",
-                      path.c_str(), sftp_error, session_error,
-                      err_msg ? err_msg : "Unknown error");
-  }
-  auto file_open_ms = std::chrono::duration_cast<std::chrono::milliseconds>(
-                          std::chrono::steady_clock::now() - file_open_start)
-                          .count();
+void SSHFSFileHandle::CheckUploadErrors() {
+  if (upload_group) {
+    upload_group->CheckError();
+  }
+}
 
-  read_initialized = true;
+size_t SSHFSFileHandle::GetBytesUploaded() {
+  return upload_group ? upload_group->GetBytesCompleted() : 0;
+}
 
-  auto open_ms = std::chrono::duration_cast<std::chrono::milliseconds>(
-                     std::chrono::steady_clock::now() - open_start)
-                     .count();
+std::string SSHFSFileHandle::TempUploadPath(const std::string &remote_path) {
+  std::random_device rng;
+  std::ostringstream name;
+  auto slash = remote_path.find_last_of('/');
+  auto dir = slash == std::string::npos ? "" : remote_path.substr(0, slash + 1);
+  auto file = slash == std::string::npos ? remote_path
+                                         : remote_path.substr(slash + 1);
+  name << dir << "." << file << ".sshfs-" << std::hex << rng() << rng()
+       << ".tmp";
+  return name.str();
+}
 
-  if (IsDebugLoggingEnabled()) {
-    std::cerr << "  [READ-INIT] SFTP init: " << sftp_init_ms
-              << "ms, file open: " << file_open_ms << "ms, total: " << open_ms
-              << "ms (CACHED for file lifetime)" << std::endl;
+void SSHFSFileHandle::CommitAtomicUpload() {
+  if (!atomic_upload || chunk_count == 0 || upload_committed) {
+    return;
   }
+  try {
+    ssh_client->RenameFile(upload_path, path);
+  } catch (...) {
+    AbortAtomicUpload();
+    throw;
+  }
+  upload_committed = true;
+  session_pool->InvalidatePath(upload_path);
+  SSHFS_LOG("  [UPLOAD] Renamed " << upload_path << " to " << path);
 }
 
-void SSHFSFileHandle::CloseReadHandle() {
-  if (!read_initialized) {
-    return; // Nothing to close
+void SSHFSFileHandle::AbortAtomicUpload() {
+  if (!atomic_upload || chunk_count == 0 || upload_committed) {
+    return;
   }
-
-  if (read_handle) {
-    libssh2_sftp_close(read_handle);
-    read_handle = nullptr;
+  // Chunks still uploading would recreate the file after it is removed
+  if (upload_group) {
+    upload_group->Wait();
   }
-
-  if (read_sftp) {
-    // Return SFTP session to pool for reuse (shared across file handles)
-    ssh_client->ReturnSFTPSession(read_sftp);
-    read_sftp = nullptr;
+  try {
+    session_pool->CloseWriteHandles(upload_path);
+    ssh_client->RemoveFile(upload_path);
+    SSHFS_LOG("  [UPLOAD] Removed partial upload " << upload_path);
+  } catch (...) {
+    // Best effort - the target path was never touched
   }
-
-  read_initialized = false;
+  session_pool->InvalidatePath(upload_path);
+  // Nothing left to clean up on a second Close
+  upload_committed = true;
 }
 
-void SSHFSFileHandle::CheckUploadErrors() {
-  if (has_upload_error.load()) {
-    if (first_upload_error) {
-      std::rethrow_exception(first_upload_error);
-    }
-    throw IOException("Upload error occurred but no exception was captured");
+void SSHFSFileHandle::EnsureFileCreated() {
+  // Chunks after the first may be written before it, so the file is created
+  // (or truncated) up front and no chunk's open truncates another
+  if (chunk_count == 0) {
+    session_pool->WriteRange(upload_path, 0, nullptr, 0, true);
   }
 }
 
-void SSHFSFileHandle::UploadChunkAsync(
-    std::shared_ptr<SSHFSWriteBuffer> buffer) {
-  // Mark as uploading
-  bool expected = false;
-  if (!buffer->uploading.compare_exchange_strong(expected, true)) {
-    return; // Already uploading
+SSHFSUploadGroup &SSHFSFileHandle::GetUploadGroup() {
+  if (!upload_group) {
+    auto scheduler = session_pool->GetUploadScheduler();
+    if (!scheduler) {
+      throw IOException("No upload scheduler configured for %s", path);
+    }
+    // Every chunk is written at its own offset on a leased session, so up
+    // to max_concurrent_uploads chunks of this file upload in parallel
+    upload_group = scheduler->CreateGroup(
+        connection_params.hostname + ":" +
+            std::to_string(connection_params.port),
+        max_concurrent_uploads, max_concurrent_uploads);
   }
+  return *upload_group;
+}
 
-  // Launch detached thread for upload
-  std::thread upload_thread([this, buffer]() {
-    auto upload_start = std::chrono::steady_clock::now();
-
-    try {
-      bool is_first_chunk = (buffer->part_no == 0);
-      if (IsDebugLoggingEnabled()) {
-        std::cerr << "  [ASYNC] Starting background "
-                  << (is_first_chunk ? "upload" : "append") << " of chunk #"
-                  << buffer->part_no << " ("
-                  << buffer->data.size() / (1024.0 * 1024.0) << " MB)"
-                  << std::endl;
-      }
-
-      // Upload directly to final file (append for chunks after first)
-      ssh_client->UploadChunk(path, buffer->data.data(), buffer->data.size(),
-                              !is_first_chunk);
+void SSHFSFileHandle::WriteDirect(const char *data, size_t length) {
+  CheckUploadErrors();
+  EnsureFileCreated();
 
-      // Mark as successfully uploaded
-      buffer->uploaded.store(true);
-      chunks_uploaded.fetch_add(1);
-      bytes_uploaded.fetch_add(buffer->data.size());
+  SSHFS_LOG("  [WRITE] Sending " << length / (1024 * 1024)
+                                  << " MB directly from the caller's buffer");
 
-      auto upload_end = std::chrono::steady_clock::now();
-      auto upload_ms = std::chrono::duration_cast<std::chrono::milliseconds>(
-                           upload_end - upload_start)
-                           .count();
-      if (IsDebugLoggingEnabled()) {
-        double mb_per_sec =
-            buffer->data.size() / (1024.0 * 1024.0) / (upload_ms / 1000.0);
-        std::cerr << "  [ASYNC] Completed chunk #" << buffer->part_no << " in "
-                  << upload_ms << "ms (" << mb_per_sec << " MB/s)" << std::endl;
-      }
+  auto &group = GetUploadGroup();
+  // The caller is blocked until the whole buffer is on the server
+  SSHFSWaitTimer wait_timer(session_pool->GetStats()->upload_wait_us);
+  std::exception_ptr error;
+  try {
+    for (size_t done = 0; done < length; done += chunk_size) {
+      size_t size = std::min(chunk_size, length - done);
+      const char *chunk = data + done;
+      idx_t offset = bytes_flushed;
+      bytes_flushed += size;
+      chunk_count++;
+
+      auto pool = session_pool;
+      auto remote_path = upload_path;
+      group.Submit(
+          [pool, remote_path, offset, chunk, size]() {
+            pool->WriteRange(remote_path, offset, chunk, size, false);
+          },
+          size);
+    }
+  } catch (...) {
+    error = std::current_exception();
+  }
 
-    } catch (...) {
-      if (IsDebugLoggingEnabled()) {
-        std::cerr << "  [ASYNC] ERROR uploading chunk #" << buffer->part_no
-                  << std::endl;
-      }
+  // The jobs read the caller's memory - they must finish before Write returns
+  group.Wait();
+  if (error) {
+    std::rethrow_exception(error);
+  }
+  CheckUploadErrors();
+}
 
-      // Capture first error
-      bool expected_error = false;
-      if (has_upload_error.compare_exchange_strong(expected_error, true)) {
-        first_upload_error = std::current_exception();
-      }
-      buffer->upload_error = std::current_exception();
-    }
+void SSHFSFileHandle::UploadChunkAsync(
+    std::shared_ptr<SSHFSWriteBuffer> buffer, bool truncate) {
+  auto &group = GetUploadGroup();
+
+  // The job owns everything it touches - the handle may be destroyed while
+  // it is still queued
+  auto pool = session_pool;
+  auto remote_path = upload_path;
+  size_t size = buffer->data.Size();
+  // Submit blocks while too many uploads are pending (backpressure)
+  SSHFSWaitTimer wait_timer(pool->GetStats()->upload_wait_us);
+  group.Submit(
+      [pool, remote_path, buffer, truncate]() {
+        auto upload_start = std::chrono::steady_clock::now();
+        if (IsDebugLoggingEnabled()) {
+          std::cerr << "  [ASYNC] Starting background upload of chunk #"
+                    << buffer->part_no << " ("
+                    << buffer->data.Size() / (1024.0 * 1024.0)
+                    << " MB at offset " << buffer->offset << ")" << std::endl;
+        }
 
-    // Decrement in-progress counter and notify
-    uploads_in_progress.fetch_sub(1);
-    upload_complete_cv.notify_all();
-  });
+        try {
+          // Upload directly to final file at the chunk's offset
+          pool->WriteRange(remote_path, buffer->offset, buffer->data.Data(),
+                           buffer->data.Size(), truncate);
+        } catch (...) {
+          if (IsDebugLoggingEnabled()) {
+            std::cerr << "  [ASYNC] ERROR uploading chunk #"
+                      << buffer->part_no << std::endl;
+          }
+          throw;
+        }
 
-  upload_thread.detach();
+        // Mark as successfully uploaded
+        buffer->uploaded.store(true);
+
+        auto upload_end = std::chrono::steady_clock::now();
+        auto upload_ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+                             upload_end - upload_start)
+                             .count();
+        if (IsDebugLoggingEnabled()) {
+          double mb_per_sec =
+              buffer->data.Size() / (1024.0 * 1024.0) / (upload_ms / 1000.0);
+          std::cerr << "  [ASYNC] Completed chunk #" << buffer->part_no
+                    << " in " << upload_ms << "ms (" << mb_per_sec << " MB/s)"
+                    << std::endl;
+        }
+      },
+      size);
 }
 
 LIBSSH2_SFTP_ATTRIBUTES SSHFSFileHandle::GetCachedFileStats() {
   // Cache file stats to avoid repeated SFTP sessions
   // Stats are cached for the lifetime of this file handle
+  if (!stats_cached && !flags.OpenForWriting()) {
+    // Shared metadata cache - filled by directory listings and other stats
+    if (session_pool->StatCached(path, cached_file_stats)) {
+      stats_cached = true;
+    }
+    // Not found: fall through so GetFileStats reports the error
+  }
   if (!stats_cached) {
     cached_file_stats = ssh_client->GetFileStats(path);
     stats_cached = true;
@@ -532,7 +767,7 @@ LIBSSH2_SFTP_ATTRIBUTES SSHFSFileHandle::GetCachedFileStats() {
 idx_t SSHFSFileHandle::GetProgress() {
   // Return bytes uploaded + bytes in current write buffer
   // This provides accurate progress during both writing and uploading phases
-  return bytes_uploaded.load() + write_buffer.size();
+  return GetBytesUploaded() + write_buffer.Size();
 }
 
 } // namespace duckdb
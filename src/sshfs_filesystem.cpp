@@ -2,16 +2,90 @@
 #include "duckdb/common/exception.hpp"
 #include "duckdb/common/file_opener.hpp"
 #include "duckdb/common/string_util.hpp"
+#include "duckdb/main/database.hpp"
 #include "duckdb/main/secret/secret_manager.hpp"
 #include "ssh_config.hpp"
 #include "ssh_helpers.hpp"
+#include "sshfs_disk_cache.hpp"
 #include "sshfs_file_handle.hpp"
+#include "sshfs_glob.hpp"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstring>
 #include <ctime>
+#include <memory>
+#include <openssl/evp.h>
 #include <regex>
+#include <set>
+#include <thread>
+#include <vector>
 
 namespace duckdb {
 
-SSHFSFileSystem::SSHFSFileSystem() {}
+// How often idle pools are health checked
+static constexpr std::chrono::seconds MAINTENANCE_INTERVAL{10};
+// Lookups peek the primary's socket for a server-side close only after it
+// sat unused this long
+static constexpr std::chrono::seconds SOCKET_CHECK_IDLE_TIME{1};
+
+SSHFSSharedSettings::SSHFSSharedSettings(const SSHConnectionParams &params)
+    : block_cache_size(params.block_cache_size),
+      metadata_cache_ttl_ms(params.metadata_cache_ttl_ms),
+      upload_threads(params.upload_threads),
+      max_host_uploads(params.max_host_uploads),
+      upload_memory_limit(params.upload_memory_limit),
+      upload_spill_directory(
+          params.upload_spill ? params.upload_spill_directory : ""),
+      cache_directory(params.cache_directory),
+      cache_max_size(params.cache_max_size),
+      idle_timeout_seconds(params.idle_timeout_seconds),
+      max_connection_lifetime_seconds(params.max_connection_lifetime_seconds) {
+}
+
+SSHFSPoolSettings::SSHFSPoolSettings(const SSHConnectionParams &params)
+    : max_sessions(params.max_sessions),
+      multiplex_channels(params.multiplex_channels),
+      read_backend(params.read_backend), dd_channels(params.dd_channels),
+      read_coalesce_gap(params.read_coalesce_gap),
+      verify_uploads(params.verify_uploads),
+      upload_fault_interval(params.upload_fault_interval) {}
+
+bool SSHFSPoolSettings::operator==(const SSHFSPoolSettings &other) const {
+  return max_sessions == other.max_sessions &&
+         multiplex_channels == other.multiplex_channels &&
+         read_backend == other.read_backend &&
+         dd_channels == other.dd_channels &&
+         read_coalesce_gap == other.read_coalesce_gap &&
+         verify_uploads == other.verify_uploads &&
+         upload_fault_interval == other.upload_fault_interval;
+}
+
+SSHFSFileSystem::SSHFSFileSystem()
+    : block_cache(std::make_shared<SSHFSBlockCache>(
+          SSHConnectionParams().block_cache_size)),
+      metadata_cache(std::make_shared<SSHFSMetadataCache>(
+          SSHConnectionParams().metadata_cache_ttl_ms)),
+      upload_scheduler(std::make_shared<SSHFSUploadScheduler>(
+          SSHConnectionParams().upload_threads,
+          SSHConnectionParams().max_host_uploads)),
+      readahead_scheduler(std::make_shared<SSHFSReadaheadScheduler>()),
+      buffer_pool(std::make_shared<SSHFSBufferPool>(
+          SSHConnectionParams().upload_memory_limit)),
+      shared_settings(SSHConnectionParams()) {}
+
+SSHFSFileSystem::~SSHFSFileSystem() {
+  {
+    std::lock_guard<std::mutex> lock(maintenance_mutex);
+    maintenance_stopping = true;
+  }
+  maintenance_cv.notify_all();
+  if (maintenance_thread.joinable()) {
+    maintenance_thread.join();
+  }
+  // Pools held by open handles keep the scheduler, but not its worker
+  readahead_scheduler->Shutdown();
+}
 
 unique_ptr<FileHandle>
 SSHFSFileSystem::OpenFile(const string &path, FileOpenFlags flags,
@@ -19,16 +93,22 @@ SSHFSFileSystem::OpenFile(const string &path, FileOpenFlags flags,
   // Parse URL and get connection parameters
   auto params = ParseURL(path, opener.get());
 
-  // Get or create SSH client
-  auto client = GetOrCreateClient(path, opener.get());
+  // Get or create the session pool for this host
+  auto session_pool = GetOrCreateSessionPool(params);
+  auto client = session_pool->GetPrimary();
 
   // Ensure connection
   if (!client->IsConnected()) {
     client->Connect();
   }
 
+  // Writers replace the file contents - drop any cached read handles
+  if (flags.OpenForWriting()) {
+    session_pool->InvalidatePath(params.remote_path);
+  }
+
   // Create and return file handle
-  return make_uniq<SSHFSFileHandle>(*this, path, flags, client, params);
+  return make_uniq<SSHFSFileHandle>(*this, path, flags, session_pool, params);
 }
 
 void SSHFSFileSystem::Write(FileHandle &handle, void *buffer, int64_t nr_bytes,
@@ -74,7 +154,7 @@ idx_t SSHFSFileSystem::SeekPosition(FileHandle &handle) {
 void SSHFSFileSystem::Truncate(FileHandle &handle, int64_t new_size) {
   auto &sshfs_handle = dynamic_cast<SSHFSFileHandle &>(handle);
   auto client = sshfs_handle.GetClient();
-  const auto &remote_path = sshfs_handle.GetRemotePath();
+  const auto &remote_path = sshfs_handle.GetUploadPath();
 
   if (!client->IsConnected()) {
     client->Connect();
@@ -85,6 +165,7 @@ void SSHFSFileSystem::Truncate(FileHandle &handle, int64_t new_size) {
 
   // Always use SFTP for truncate (avoids command injection via remote_path)
   client->TruncateFileSFTP(remote_path, new_size);
+  sshfs_handle.GetSessionPool()->InvalidatePath(remote_path);
 }
 
 void SSHFSFileSystem::FileSync(FileHandle &handle) {
@@ -99,18 +180,13 @@ bool SSHFSFileSystem::FileExists(const string &filename,
     SSHFS_LOG("  [EXISTS] Checking if file exists: " << filename);
     SSHFS_LOG("  [EXISTS] Remote path: " << params.remote_path);
 
-    auto client = GetOrCreateClient(filename, opener.get());
+    auto session_pool = GetOrCreateSessionPool(params);
 
-    if (!client->IsConnected()) {
-      SSHFS_LOG("  [EXISTS] Client not connected, connecting...");
-      client->Connect();
-    }
-
-    // Use SFTP to check if file exists by getting stats
-    SSHFS_LOG("  [EXISTS] Calling GetFileStats for: " << params.remote_path);
-    client->GetFileStats(params.remote_path);
-    SSHFS_LOG("  [EXISTS] File exists!");
-    return true;
+    // Stat through the shared metadata cache (also remembers misses)
+    LIBSSH2_SFTP_ATTRIBUTES attrs;
+    bool exists = session_pool->StatCached(params.remote_path, attrs);
+    SSHFS_LOG("  [EXISTS] " << (exists ? "File exists!" : "File not found"));
+    return exists;
   } catch (const std::exception &e) {
     SSHFS_LOG("  [EXISTS] Exception: " << e.what());
     return false;
@@ -123,35 +199,117 @@ bool SSHFSFileSystem::FileExists(const string &filename,
 void SSHFSFileSystem::RemoveFile(const string &filename,
                                  optional_ptr<FileOpener> opener) {
   auto params = ParseURL(filename, opener.get());
-  auto client = GetOrCreateClient(filename, opener.get());
+  auto session_pool = GetOrCreateSessionPool(params);
+  auto client = session_pool->GetPrimary();
 
   if (!client->IsConnected()) {
     client->Connect();
   }
 
+  session_pool->InvalidatePath(params.remote_path);
   client->RemoveFile(params.remote_path);
 }
 
 void SSHFSFileSystem::MoveFile(const string &source, const string &target,
                                optional_ptr<FileOpener> opener) {
-  auto params = ParseURL(source, opener.get());
-  auto client = GetOrCreateClient(source, opener.get());
+  auto source_params = ParseURL(source, opener.get());
+  auto target_params = ParseURL(target, opener.get());
+
+  if (ExtractConnectionKey(source_params) !=
+      ExtractConnectionKey(target_params)) {
+    // Different hosts: no rename can reach the target
+    string method;
+    CopyFile(source, target, opener.get(), method);
+    RemoveFile(source, opener);
+    return;
+  }
+
+  auto session_pool = GetOrCreateSessionPool(source_params);
+  auto client = session_pool->GetPrimary();
 
   if (!client->IsConnected()) {
     client->Connect();
   }
 
-  // Extract remote paths from URLs
-  auto source_params = ParseURL(source, opener.get());
-  auto target_params = ParseURL(target, opener.get());
+  // Either side may be a directory
+  session_pool->InvalidateTree(source_params.remote_path);
+  session_pool->InvalidateTree(target_params.remote_path);
+  client->MoveFileRemote(source_params.remote_path,
+                         target_params.remote_path);
+  // Readers may have cached either side again while the move ran
+  session_pool->InvalidateTree(source_params.remote_path);
+  session_pool->InvalidateTree(target_params.remote_path);
+}
+
+idx_t SSHFSFileSystem::CopyFile(const string &source, const string &target,
+                                FileOpener *opener, string &method) {
+  auto source_params = ParseURL(source, opener);
+  auto target_params = ParseURL(target, opener);
+  auto source_pool = GetOrCreateSessionPool(source_params);
 
-  client->RenameFile(source_params.remote_path, target_params.remote_path);
+  // The size is the copied byte count for cp, so no cached attributes
+  LIBSSH2_SFTP_ATTRIBUTES attrs;
+  if (!source_pool->StatFresh(source_params.remote_path, attrs)) {
+    throw IOException("Cannot copy %s: file does not exist", source);
+  }
+  if (LIBSSH2_SFTP_S_ISDIR(attrs.permissions)) {
+    throw IOException("Cannot copy %s: it is a directory\n"
+                      "  → Copy the files inside it one by one",
+                      source);
+  }
+  idx_t file_size = attrs.filesize;
+
+  if (ExtractConnectionKey(source_params) ==
+      ExtractConnectionKey(target_params)) {
+    auto client = source_pool->GetPrimary();
+    if (!client->IsConnected()) {
+      client->Connect();
+    }
+    source_pool->InvalidatePath(target_params.remote_path);
+    if (client->CopyFileRemote(source_params.remote_path,
+                               target_params.remote_path)) {
+      // A concurrent reader may have cached the old target while cp ran
+      source_pool->InvalidatePath(target_params.remote_path);
+      method = "cp";
+      return file_size;
+    }
+  }
+
+  // Stream chunk by chunk: read from one pool, write to the other
+  auto target_pool = GetOrCreateSessionPool(target_params);
+  target_pool->InvalidatePath(target_params.remote_path);
+  size_t chunk_size =
+      std::min<size_t>(target_params.chunk_size, std::max<idx_t>(file_size, 1));
+  std::vector<char> buffer(chunk_size);
+  idx_t offset = 0;
+  do {
+    size_t length = std::min<idx_t>(chunk_size, file_size - offset);
+    size_t bytes_read = length == 0
+                            ? 0
+                            : source_pool->ReadRange(source_params.remote_path,
+                                                     offset, buffer.data(),
+                                                     length);
+    // The first write creates (or truncates) the target, also when empty
+    target_pool->WriteRange(target_params.remote_path, offset, buffer.data(),
+                            bytes_read, offset == 0);
+    offset += bytes_read;
+    if (bytes_read < length) {
+      // The source shrank while copying
+      break;
+    }
+  } while (offset < file_size);
+  target_pool->CloseWriteHandles(target_params.remote_path);
+  target_pool->InvalidatePath(target_params.remote_path);
+
+  method = "sftp";
+  return offset;
 }
 
 void SSHFSFileSystem::CreateDirectory(const string &directory,
                                       optional_ptr<FileOpener> opener) {
   auto params = ParseURL(directory, opener.get());
-  auto client = GetOrCreateClient(directory, opener.get());
+  auto session_pool = GetOrCreateSessionPool(params);
+  auto client = session_pool->GetPrimary();
 
   if (!client->IsConnected()) {
     client->Connect();
@@ -159,20 +317,20 @@ void SSHFSFileSystem::CreateDirectory(const string &directory,
 
   // Always use SFTP for directory creation (avoids command injection via path)
   client->CreateDirectorySFTP(params.remote_path);
+  session_pool->InvalidatePath(params.remote_path);
 }
 
 bool SSHFSFileSystem::DirectoryExists(const string &directory,
                                       optional_ptr<FileOpener> opener) {
   try {
     auto params = ParseURL(directory, opener.get());
-    auto client = GetOrCreateClient(directory, opener.get());
+    auto session_pool = GetOrCreateSessionPool(params);
 
-    if (!client->IsConnected()) {
-      client->Connect();
+    // Stat through the shared metadata cache (also remembers misses)
+    LIBSSH2_SFTP_ATTRIBUTES attrs;
+    if (!session_pool->StatCached(params.remote_path, attrs)) {
+      return false;
     }
-
-    // Use SFTP to check if directory exists by getting stats
-    auto attrs = client->GetFileStats(params.remote_path);
     // Check if it's actually a directory
     return (attrs.flags & LIBSSH2_SFTP_ATTR_PERMISSIONS) &&
            LIBSSH2_SFTP_S_ISDIR(attrs.permissions);
@@ -184,7 +342,8 @@ bool SSHFSFileSystem::DirectoryExists(const string &directory,
 void SSHFSFileSystem::RemoveDirectory(const string &directory,
                                       optional_ptr<FileOpener> opener) {
   auto params = ParseURL(directory, opener.get());
-  auto client = GetOrCreateClient(directory, opener.get());
+  auto session_pool = GetOrCreateSessionPool(params);
+  auto client = session_pool->GetPrimary();
 
   if (!client->IsConnected()) {
     client->Connect();
@@ -192,18 +351,395 @@ void SSHFSFileSystem::RemoveDirectory(const string &directory,
 
   // Always use SFTP for directory removal (avoids command injection via path)
   client->RemoveDirectorySFTP(params.remote_path);
+  session_pool->InvalidateTree(params.remote_path);
+}
+
+namespace {
+
+// Glob result with the attributes the listing already returned, so DuckDB
+// doesn't stat every file again (see OpenFileExtended)
+OpenFileInfo MakeOpenFileInfo(const string &url,
+                              const LIBSSH2_SFTP_ATTRIBUTES &attrs) {
+  OpenFileInfo info(url);
+  auto extended_info = make_shared_ptr<ExtendedOpenFileInfo>();
+  if (attrs.flags & LIBSSH2_SFTP_ATTR_SIZE) {
+    extended_info->options["file_size"] = Value::UBIGINT(attrs.filesize);
+  }
+  if (attrs.flags & LIBSSH2_SFTP_ATTR_ACMODTIME) {
+    extended_info->options["last_modified"] =
+        Value::TIMESTAMP(Timestamp::FromEpochSeconds(attrs.mtime));
+  }
+  info.extended_info = extended_info;
+  return info;
+}
+
+using GlobMatches = std::vector<std::pair<string, LIBSSH2_SFTP_ATTRIBUTES>>;
+
+// List directories concurrently, one worker per pooled session
+// (sshfs_max_sessions). Missing directories get an empty listing.
+void ListDirectories(SSHSessionPool &pool, const vector<string> &directories,
+                     std::unordered_map<string, vector<SFTPDirEntry>> &out) {
+  if (directories.empty()) {
+    return;
+  }
+
+  std::atomic<size_t> next_index{0};
+  std::mutex out_mutex;
+  std::exception_ptr first_error;
+
+  auto worker = [&]() {
+    try {
+      SSHClientLease client(pool);
+      if (!client->IsConnected()) {
+        client->Connect();
+      }
+      size_t i;
+      while ((i = next_index.fetch_add(1)) < directories.size()) {
+        vector<SFTPDirEntry> entries;
+        client->ListDirectory(directories[i], entries);
+        std::lock_guard<std::mutex> lock(out_mutex);
+        out[directories[i]] = std::move(entries);
+      }
+    } catch (...) {
+      std::lock_guard<std::mutex> lock(out_mutex);
+      if (!first_error) {
+        first_error = std::current_exception();
+      }
+      // Stop the other workers
+      next_index.store(directories.size());
+    }
+  };
+
+  size_t worker_count = std::min(directories.size(), pool.GetMaxSessions());
+  std::vector<std::thread> threads;
+  for (size_t i = 1; i < worker_count; i++) {
+    threads.emplace_back(worker);
+  }
+  worker();
+  for (auto &thread : threads) {
+    thread.join();
+  }
+
+  if (first_error) {
+    std::rethrow_exception(first_error);
+  }
 }
 
+// Expand the pattern with SFTP readdir, one directory level per round so
+// sibling directories are listed in parallel
+void GlobWalk(SSHSessionPool &pool, const SSHFSGlobPattern &pattern,
+              GlobMatches &matches) {
+  // Guard against symlink loops below "**"
+  const size_t MAX_GLOB_DEPTH = 64;
+
+  struct WalkState {
+    string dir;
+    size_t segment;
+    size_t depth;
+  };
+
+  vector<WalkState> frontier;
+  frontier.push_back({pattern.base, 0, 0});
+  std::unordered_map<string, vector<SFTPDirEntry>> listings;
+  std::set<std::pair<string, size_t>> visited;
+  std::set<string> matched;
+
+  while (!frontier.empty()) {
+    vector<string> to_list;
+    std::set<string> queued;
+    for (auto &state : frontier) {
+      if (!listings.count(state.dir) && queued.insert(state.dir).second) {
+        to_list.push_back(state.dir);
+      }
+    }
+    ListDirectories(pool, to_list, listings);
+
+    vector<WalkState> next;
+    auto push = [&](const string &dir, size_t segment, size_t depth) {
+      if (depth <= MAX_GLOB_DEPTH && visited.insert({dir, segment}).second) {
+        next.push_back({dir, segment, depth});
+      }
+    };
+
+    for (auto &state : frontier) {
+      const auto &segment = pattern.segments[state.segment];
+      bool last = state.segment + 1 == pattern.segments.size();
+
+      if (segment == "**") {
+        // Zero directories: the next segment applies to this directory
+        if (!last) {
+          push(state.dir, state.segment + 1, state.depth);
+        }
+        for (auto &entry : listings[state.dir]) {
+          auto child = JoinRemotePath(state.dir, entry.name);
+          if (entry.IsDirectory()) {
+            push(child, state.segment, state.depth + 1);
+          } else if (last && entry.IsRegularFile() &&
+                     matched.insert(child).second) {
+            matches.emplace_back(child, entry.attrs);
+          }
+        }
+        continue;
+      }
+
+      for (auto &entry : listings[state.dir]) {
+        if (!GlobMatchSegment(segment, entry.name)) {
+          continue;
+        }
+        auto child = JoinRemotePath(state.dir, entry.name);
+        if (!last) {
+          if (entry.IsDirectory()) {
+            push(child, state.segment + 1, state.depth + 1);
+          }
+        } else if (entry.IsRegularFile() && matched.insert(child).second) {
+          matches.emplace_back(child, entry.attrs);
+        }
+      }
+    }
+    frontier = std::move(next);
+  }
+}
+
+// sha256 of a remote file read over SFTP (hosts that can't run sha256sum)
+string Sha256OverSFTP(SSHSessionPool &pool, const string &remote_path,
+                      idx_t file_size) {
+  const size_t HASH_READ_SIZE = 4 * 1024 * 1024;
+  std::unique_ptr<EVP_MD_CTX, decltype(&EVP_MD_CTX_free)> ctx(
+      EVP_MD_CTX_new(), EVP_MD_CTX_free);
+  if (!ctx || EVP_DigestInit_ex(ctx.get(), EVP_sha256(), nullptr) != 1) {
+    throw IOException("Failed to initialize sha256 for %s", remote_path);
+  }
+  std::vector<char> buffer(std::min<idx_t>(HASH_READ_SIZE, file_size));
+  idx_t offset = 0;
+  while (offset < file_size) {
+    size_t length = std::min<idx_t>(buffer.size(), file_size - offset);
+    size_t bytes_read =
+        pool.ReadRange(remote_path, offset, buffer.data(), length);
+    if (bytes_read == 0) {
+      break;
+    }
+    EVP_DigestUpdate(ctx.get(), buffer.data(), bytes_read);
+    offset += bytes_read;
+  }
+  unsigned char digest[EVP_MAX_MD_SIZE];
+  unsigned int digest_length = 0;
+  if (EVP_DigestFinal_ex(ctx.get(), digest, &digest_length) != 1) {
+    throw IOException("Failed to compute sha256 of %s", remote_path);
+  }
+  static const char *HEX = "0123456789abcdef";
+  string hex;
+  for (unsigned int i = 0; i < digest_length; i++) {
+    hex += HEX[digest[i] >> 4];
+    hex += HEX[digest[i] & 0xf];
+  }
+  return hex;
+}
+
+} // namespace
+
 vector<OpenFileInfo> SSHFSFileSystem::Glob(const string &path,
                                            FileOpener *opener) {
-  // Basic glob implementation - just return the path if it exists
+  auto params = ParseURL(path, opener);
+  // Everything before the remote path (ssh://user@host:port or host:)
+  string url_prefix = path.substr(0, path.size() - params.remote_path.size());
+
+  auto session_pool = GetOrCreateSessionPool(params);
+
   vector<OpenFileInfo> result;
-  if (FileExists(path, opener)) {
-    result.push_back(OpenFileInfo(path));
+  if (!HasGlob(params.remote_path)) {
+    // Literal path - one stat through the metadata cache, passed on so DuckDB
+    // doesn't stat again. Only a missing file is an empty result, other
+    // errors (permissions, connection) are thrown.
+    LIBSSH2_SFTP_ATTRIBUTES attrs;
+    if (session_pool->StatCached(params.remote_path, attrs)) {
+      result.push_back(MakeOpenFileInfo(path, attrs));
+    } else {
+      SSHFS_LOG("  [GLOB] " << path << " not found");
+    }
+    return result;
   }
+
+  auto client = session_pool->GetPrimary();
+  if (!client->IsConnected()) {
+    client->Connect();
+  }
+
+  auto glob_start = std::chrono::steady_clock::now();
+  auto pattern = ParseGlobPattern(params.remote_path);
+  GlobMatches matches;
+
+  // Fast path: one remote find lists the whole tree in a single round trip
+  int max_depth = pattern.IsRecursive()
+                      ? -1
+                      : static_cast<int>(pattern.segments.size());
+  vector<SFTPDirEntry> found;
+  if (client->SupportsCommands() &&
+      client->FindFiles(pattern.base, max_depth, found)) {
+    for (auto &entry : found) {
+      if (GlobMatchPath(pattern.segments, SplitRemotePath(entry.name))) {
+        matches.emplace_back(JoinRemotePath(pattern.base, entry.name),
+                             entry.attrs);
+      }
+    }
+  } else {
+    GlobWalk(*session_pool, pattern, matches);
+  }
+
+  std::sort(matches.begin(), matches.end(),
+            [](const std::pair<string, LIBSSH2_SFTP_ATTRIBUTES> &a,
+               const std::pair<string, LIBSSH2_SFTP_ATTRIBUTES> &b) {
+              return a.first < b.first;
+            });
+  for (auto &match : matches) {
+    metadata_cache->Put(session_pool->GetCacheKey(match.first), match.second);
+    result.push_back(MakeOpenFileInfo(url_prefix + match.first, match.second));
+  }
+
+  auto glob_ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+                     std::chrono::steady_clock::now() - glob_start)
+                     .count();
+  SSHFS_LOG("  [GLOB] " << path << " matched " << result.size() << " files in "
+                        << glob_ms << "ms");
   return result;
 }
 
+void SSHFSFileSystem::ListTree(
+    SSHSessionPool &pool, const string &remote_path, bool recursive,
+    bool with_hash,
+    const std::function<bool(const SFTPDirEntry &, const string &)>
+        &on_entry) {
+  {
+    // Not the primary, so a long listing doesn't hold up other queries
+    SSHClientLease client(pool);
+    if (!client->IsConnected()) {
+      client->Connect();
+    }
+    if (client->FindEntries(remote_path, recursive, with_hash, on_entry)) {
+      return;
+    }
+  }
+
+  // SFTP fallback: one directory level per round, sibling directories listed
+  // in parallel (sshfs_max_sessions)
+  const size_t MAX_LIST_DEPTH = 64;
+  LIBSSH2_SFTP_ATTRIBUTES attrs;
+  if (!pool.StatCached(remote_path.empty() ? "." : remote_path, attrs)) {
+    throw IOException("Directory %s does not exist", remote_path);
+  }
+  if (!LIBSSH2_SFTP_S_ISDIR(attrs.permissions)) {
+    throw IOException("%s is not a directory", remote_path);
+  }
+
+  vector<string> frontier = {""};
+  for (size_t depth = 0; !frontier.empty() && depth <= MAX_LIST_DEPTH;
+       depth++) {
+    vector<string> directories;
+    for (auto &relative : frontier) {
+      directories.push_back(JoinRemotePath(remote_path, relative));
+    }
+    std::unordered_map<string, vector<SFTPDirEntry>> listings;
+    ListDirectories(pool, directories, listings);
+
+    vector<string> next;
+    for (size_t i = 0; i < frontier.size(); i++) {
+      for (auto &entry : listings[directories[i]]) {
+        if (!entry.IsDirectory() && !entry.IsRegularFile()) {
+          continue;
+        }
+        SFTPDirEntry relative_entry = entry;
+        relative_entry.name = JoinRemotePath(frontier[i], entry.name);
+        string hash;
+        if (with_hash && entry.IsRegularFile()) {
+          hash = Sha256OverSFTP(
+              pool, JoinRemotePath(directories[i], entry.name),
+              entry.attrs.filesize);
+        }
+        if (!on_entry(relative_entry, hash)) {
+          return;
+        }
+        if (recursive && entry.IsDirectory()) {
+          next.push_back(relative_entry.name);
+        }
+      }
+    }
+    frontier = std::move(next);
+  }
+}
+
+unique_ptr<FileHandle>
+SSHFSFileSystem::OpenFileExtended(const OpenFileInfo &file,
+                                  FileOpenFlags flags,
+                                  optional_ptr<FileOpener> opener) {
+  auto handle = OpenFile(file.path, flags, opener);
+
+  // Reuse the size and mtime from the Glob listing instead of a stat
+  if (file.extended_info && !flags.OpenForWriting()) {
+    auto &options = file.extended_info->options;
+    auto size_entry = options.find("file_size");
+    auto mtime_entry = options.find("last_modified");
+    if (size_entry != options.end() && mtime_entry != options.end()) {
+      LIBSSH2_SFTP_ATTRIBUTES attrs;
+      memset(&attrs, 0, sizeof(attrs));
+      attrs.flags = LIBSSH2_SFTP_ATTR_SIZE | LIBSSH2_SFTP_ATTR_ACMODTIME;
+      attrs.filesize = size_entry->second.GetValue<uint64_t>();
+      attrs.mtime = static_cast<unsigned long>(Timestamp::GetEpochSeconds(
+          mtime_entry->second.GetValue<timestamp_t>()));
+      attrs.atime = attrs.mtime;
+      dynamic_cast<SSHFSFileHandle &>(*handle).SetCachedFileStats(attrs);
+    }
+  }
+  return handle;
+}
+
+bool SSHFSFileSystem::ListFiles(
+    const string &directory,
+    const std::function<void(const string &, bool)> &callback,
+    FileOpener *opener) {
+  return ListFilesExtended(
+      directory,
+      [&](OpenFileInfo &info) {
+        bool is_directory = false;
+        if (info.extended_info) {
+          auto type = info.extended_info->options.find("type");
+          is_directory = type != info.extended_info->options.end() &&
+                         type->second.ToString() == "directory";
+        }
+        callback(info.path, is_directory);
+      },
+      opener);
+}
+
+bool SSHFSFileSystem::ListFilesExtended(
+    const string &directory,
+    const std::function<void(OpenFileInfo &info)> &callback,
+    optional_ptr<FileOpener> opener) {
+  auto params = ParseURL(directory, opener.get());
+  auto session_pool = GetOrCreateSessionPool(params);
+  auto client = session_pool->GetPrimary();
+
+  if (!client->IsConnected()) {
+    client->Connect();
+  }
+
+  vector<SFTPDirEntry> entries;
+  if (!client->ListDirectory(params.remote_path, entries)) {
+    return false;
+  }
+
+  for (auto &entry : entries) {
+    // Keep the attributes readdir returned for the GetFileSize /
+    // GetLastModifiedTime / FileExists calls that follow
+    auto remote_path = JoinRemotePath(params.remote_path, entry.name);
+    metadata_cache->Put(session_pool->GetCacheKey(remote_path), entry.attrs);
+
+    auto info = MakeOpenFileInfo(entry.name, entry.attrs);
+    info.extended_info->options["type"] =
+        Value(entry.IsDirectory() ? "directory" : "file");
+    callback(info);
+  }
+  return true;
+}
+
 bool SSHFSFileSystem::CanHandleFile(const string &fpath) {
   return StringUtil::StartsWith(fpath, "sshfs://") ||
          StringUtil::StartsWith(fpath, "ssh://") ||
@@ -213,8 +749,13 @@ bool SSHFSFileSystem::CanHandleFile(const string &fpath) {
 timestamp_t SSHFSFileSystem::GetLastModifiedTime(FileHandle &handle) {
   auto &sshfs_handle = dynamic_cast<SSHFSFileHandle &>(handle);
   try {
+    // Files being written change mtime - ask the server. Otherwise use the
+    // handle's stats, which come from the shared metadata cache.
     auto attrs =
-        sshfs_handle.GetClient()->GetFileStats(sshfs_handle.GetRemotePath());
+        handle.flags.OpenForWriting()
+            ? sshfs_handle.GetClient()->GetFileStats(
+                  sshfs_handle.GetRemotePath())
+            : sshfs_handle.GetCachedFileStats();
     if (attrs.flags & LIBSSH2_SFTP_ATTR_ACMODTIME) {
       return Timestamp::FromEpochSeconds(attrs.mtime);
     }
@@ -260,6 +801,18 @@ bool SSHFSFileSystem::OnDiskFile(FileHandle &handle) {
   return false;
 }
 
+// The caches, upload workers and maintenance are shared by all connections
+// of the database, so their settings come from the global configuration - a
+// connection's SET SESSION must not resize or detach them for the others
+static bool TryGetGlobalSetting(FileOpener *opener, const string &name,
+                                Value &value) {
+  auto db = opener->TryGetDatabase();
+  if (!db) {
+    return FileOpener::TryGetCurrentSetting(opener, name, value);
+  }
+  return static_cast<bool>(db->TryGetCurrentSetting(name, value));
+}
+
 SSHConnectionParams SSHFSFileSystem::ParseURL(const string &path,
                                               FileOpener *opener) {
   SSHConnectionParams params;
@@ -267,8 +820,9 @@ SSHConnectionParams SSHFSFileSystem::ParseURL(const string &path,
   // Parse ssh://[username@]hostname[:port]/path/to/file or sshfs://... or
   // sftp://... Support ssh://, sshfs://, and sftp:// prefixes Username is
   // optional - can be provided via secret Support both URL-style (/path) and
-  // SCP-style (:path) separators
-  std::regex url_regex(
+  // SCP-style (:path) separators. Compiled once - every filesystem call
+  // parses its URL.
+  static const std::regex url_regex(
       R"((?:ssh|sshfs|sftp)://(?:([^@]+)@)?([^:/]+)(?::(\d+))?([:/].*))");
   std::smatch matches;
 
@@ -420,6 +974,10 @@ SSHConnectionParams SSHFSFileSystem::ParseURL(const string &path,
               if (secret->TryGetValue("port", value)) {
                 params.port = value.GetValue<int>();
               }
+              if (secret->TryGetValue("max_connections", value)) {
+                params.max_connections = static_cast<size_t>(
+                    std::max<int64_t>(0, value.GetValue<int64_t>()));
+              }
               // Note: Performance tuning parameters (timeout, retries,
               // chunk_size, etc.) are configured via SET statements, not
               // secrets
@@ -484,6 +1042,208 @@ SSHConnectionParams SSHFSFileSystem::ParseURL(const string &path,
       }
     }
 
+    if (TryGetGlobalSetting(opener, "sshfs_upload_threads", value)) {
+      params.upload_threads =
+          static_cast<size_t>(std::max<int64_t>(1, value.GetValue<int64_t>()));
+    }
+
+    if (TryGetGlobalSetting(opener, "sshfs_max_host_uploads", value)) {
+      params.max_host_uploads =
+          static_cast<size_t>(std::max<int64_t>(1, value.GetValue<int64_t>()));
+    }
+
+    if (TryGetGlobalSetting(opener, "sshfs_upload_memory_limit_mb", value)) {
+      params.upload_memory_limit =
+          static_cast<size_t>(std::max<int64_t>(1, value.GetValue<int64_t>())) *
+          1024 * 1024;
+    }
+
+    if (TryGetGlobalSetting(opener, "sshfs_upload_spill", value)) {
+      params.upload_spill = value.GetValue<bool>();
+    }
+    if (params.upload_spill) {
+      if (FileOpener::TryGetCurrentSetting(opener, "temp_directory", value)) {
+        params.upload_spill_directory = value.ToString();
+      }
+      if (params.upload_spill_directory.empty()) {
+        throw InvalidInputException(
+            "sshfs_upload_spill needs a temp_directory - it is not set or "
+            "temporary files are disabled");
+      }
+    }
+
+    if (FileOpener::TryGetCurrentSetting(opener, "sshfs_atomic_uploads",
+                                         value)) {
+      params.atomic_uploads = value.GetValue<bool>();
+    }
+
+    if (FileOpener::TryGetCurrentSetting(opener, "sshfs_verify_uploads",
+                                         value)) {
+      params.verify_uploads = value.GetValue<bool>();
+    }
+
+#ifdef SSHFS_TESTING
+    if (FileOpener::TryGetCurrentSetting(
+            opener, "sshfs_debug_upload_fault_interval", value)) {
+      params.upload_fault_interval =
+          static_cast<size_t>(std::max<int64_t>(0, value.GetValue<int64_t>()));
+    }
+#endif
+
+    if (FileOpener::TryGetCurrentSetting(opener, "sshfs_compression", value)) {
+      auto compression = StringUtil::Lower(value.ToString());
+      if (compression == "none") {
+        params.compression = SSHCompression::NONE;
+      } else if (compression == "ssh") {
+        params.compression = SSHCompression::SSH;
+      } else if (compression == "gzip") {
+        params.compression = SSHCompression::GZIP;
+      } else {
+        throw InvalidInputException(
+            "Unknown sshfs_compression '%s' (expected none, ssh or gzip)",
+            value.ToString());
+      }
+    }
+
+    if (FileOpener::TryGetCurrentSetting(opener, "sshfs_cipher_preference",
+                                         value)) {
+      auto preference = StringUtil::Lower(value.ToString());
+      preference.erase(
+          std::remove(preference.begin(), preference.end(), ' '),
+          preference.end());
+      if (preference.empty() ||
+          preference.find_first_not_of(
+              "abcdefghijklmnopqrstuvwxyz0123456789@.,-") !=
+              string::npos) {
+        throw InvalidInputException(
+            "Invalid sshfs_cipher_preference '%s' (expected default, "
+            "throughput, compat or a comma-separated list of ciphers)",
+            value.ToString());
+      }
+      params.cipher_preference = preference;
+    }
+
+    if (FileOpener::TryGetCurrentSetting(opener, "sshfs_read_backend",
+                                         value)) {
+      auto backend = StringUtil::Lower(value.ToString());
+      if (backend == "sftp") {
+        params.read_backend = SSHReadBackend::SFTP;
+      } else if (backend == "dd") {
+        params.read_backend = SSHReadBackend::DD;
+      } else if (backend == "auto") {
+        params.read_backend = SSHReadBackend::AUTO;
+      } else {
+        throw InvalidInputException(
+            "Unknown sshfs_read_backend '%s' (expected sftp, dd or auto)",
+            value.ToString());
+      }
+    }
+
+    if (FileOpener::TryGetCurrentSetting(opener, "sshfs_dd_channels", value)) {
+      params.dd_channels =
+          static_cast<size_t>(std::max<int64_t>(1, value.GetValue<int64_t>()));
+    }
+
+    if (FileOpener::TryGetCurrentSetting(opener, "sshfs_read_window_kb",
+                                         value)) {
+      params.read_window =
+          static_cast<size_t>(std::max<int64_t>(4, value.GetValue<int64_t>())) *
+          1024;
+    }
+
+    if (FileOpener::TryGetCurrentSetting(opener, "sshfs_read_coalesce_gap_kb",
+                                         value)) {
+      params.read_coalesce_gap =
+          static_cast<size_t>(std::max<int64_t>(0, value.GetValue<int64_t>())) *
+          1024;
+    }
+
+    if (FileOpener::TryGetCurrentSetting(opener, "sshfs_channel_window_kb",
+                                         value)) {
+      params.channel_window_size =
+          static_cast<size_t>(std::max<int64_t>(0, value.GetValue<int64_t>())) *
+          1024;
+    }
+
+    if (FileOpener::TryGetCurrentSetting(opener, "sshfs_socket_buffer_kb",
+                                         value)) {
+      params.socket_buffer_size =
+          static_cast<size_t>(std::max<int64_t>(0, value.GetValue<int64_t>())) *
+          1024;
+    }
+
+    if (FileOpener::TryGetCurrentSetting(opener, "sshfs_tcp_nodelay", value)) {
+      params.tcp_nodelay = value.GetValue<bool>();
+    }
+
+    if (FileOpener::TryGetCurrentSetting(opener, "sshfs_max_sessions", value)) {
+      params.max_sessions =
+          static_cast<size_t>(std::max<int64_t>(1, value.GetValue<int64_t>()));
+    }
+
+    if (FileOpener::TryGetCurrentSetting(opener, "sshfs_multiplex_channels",
+                                         value)) {
+      params.multiplex_channels =
+          static_cast<size_t>(std::max<int64_t>(0, value.GetValue<int64_t>()));
+    }
+
+    // The secret's MAX_CONNECTIONS is the host's budget and replaces
+    // sshfs_max_sessions (multiplexed reads lease one of those sessions)
+    if (params.max_connections > 0) {
+      params.max_sessions = params.max_connections;
+    }
+
+    if (TryGetGlobalSetting(opener, "sshfs_block_cache_size_mb", value)) {
+      params.block_cache_size =
+          static_cast<size_t>(std::max<int64_t>(0, value.GetValue<int64_t>())) *
+          1024 * 1024;
+    }
+
+    if (FileOpener::TryGetCurrentSetting(opener, "sshfs_block_size_kb",
+                                         value)) {
+      params.block_size =
+          static_cast<size_t>(std::max<int64_t>(4, value.GetValue<int64_t>())) *
+          1024;
+    }
+
+    if (FileOpener::TryGetCurrentSetting(opener, "sshfs_readahead_blocks",
+                                         value)) {
+      params.readahead_blocks =
+          static_cast<size_t>(std::max<int64_t>(0, value.GetValue<int64_t>()));
+    }
+
+    if (TryGetGlobalSetting(opener, "sshfs_cache_directory", value)) {
+      params.cache_directory = value.ToString();
+    }
+
+    if (TryGetGlobalSetting(opener, "sshfs_cache_max_size_mb", value)) {
+      params.cache_max_size =
+          static_cast<size_t>(std::max<int64_t>(0, value.GetValue<int64_t>())) *
+          1024 * 1024;
+    }
+
+    if (TryGetGlobalSetting(opener, "sshfs_metadata_cache_ttl_ms", value)) {
+      params.metadata_cache_ttl_ms =
+          static_cast<uint64_t>(std::max<int64_t>(0, value.GetValue<int64_t>()));
+    }
+
+    if (TryGetGlobalSetting(opener, "sshfs_idle_timeout_seconds", value)) {
+      params.idle_timeout_seconds = static_cast<int>(
+          std::max<int64_t>(0, value.GetValue<int64_t>()));
+    }
+
+    if (TryGetGlobalSetting(opener, "sshfs_max_connection_lifetime_seconds",
+                            value)) {
+      params.max_connection_lifetime_seconds = static_cast<int>(
+          std::max<int64_t>(0, value.GetValue<int64_t>()));
+    }
+
+    if (FileOpener::TryGetCurrentSetting(opener, "sshfs_max_open_handles",
+                                         value)) {
+      params.max_open_handles =
+          static_cast<size_t>(std::max<int64_t>(0, value.GetValue<int64_t>()));
+    }
+
     if (FileOpener::TryGetCurrentSetting(opener, "sshfs_strict_crypto",
                                          value)) {
       params.strict_crypto = value.GetValue<bool>();
@@ -505,33 +1265,220 @@ SSHConnectionParams SSHFSFileSystem::ParseURL(const string &path,
 
 std::shared_ptr<SSHClient>
 SSHFSFileSystem::GetOrCreateClient(const string &path, FileOpener *opener) {
-  auto params = ParseURL(path, opener);
+  return GetOrCreateSessionPool(path, opener)->GetPrimary();
+}
+
+std::shared_ptr<SSHSessionPool>
+SSHFSFileSystem::GetOrCreateSessionPool(const string &path,
+                                        FileOpener *opener) {
+  return GetOrCreateSessionPool(ParseURL(path, opener));
+}
+
+std::shared_ptr<SSHSessionPool>
+SSHFSFileSystem::GetOrCreateSessionPool(const SSHConnectionParams &params) {
   string connection_key = ExtractConnectionKey(params);
+  ApplySharedSettings(params);
+  SSHFSPoolSettings settings(params);
+
+  std::shared_ptr<SSHSessionPool> pool;
+  {
+    std::lock_guard<std::mutex> lock(pool_mutex);
+    auto it = client_pool.find(connection_key);
+    if (it == client_pool.end()) {
+      if (!maintenance_thread.joinable()) {
+        maintenance_thread = std::thread([this]() { MaintenanceLoop(); });
+      }
+      return CreateSessionPool(connection_key, params);
+    }
+    pool = it->second.pool;
+    // Pick up changes to sshfs_max_sessions / sshfs_multiplex_channels etc.
+    if (it->second.settings != settings) {
+      pool->SetMaxSessions(params.max_sessions);
+      pool->SetMultiplexChannels(params.multiplex_channels);
+      pool->SetReadBackend(params.read_backend, params.dd_channels,
+                           params.compression);
+      pool->SetCoalesceGap(params.read_coalesce_gap);
+      pool->SetUploadVerification(params.verify_uploads,
+                                  params.upload_fault_interval);
+      it->second.settings = settings;
+    }
+  }
 
-  std::lock_guard<std::mutex> lock(pool_mutex);
+  // Keepalives of idle connections run on the maintenance thread; here only
+  // a connection the server already closed is replaced. Peeking the socket
+  // is a syscall, so it is skipped for a primary that was just used.
+  auto primary = pool->GetPrimary();
+  if (primary->GetIdleTime() < SOCKET_CHECK_IDLE_TIME ||
+      !primary->IsConnected() || !primary->IsSocketClosed()) {
+    return pool;
+  }
 
-  // Check if client already exists
+  std::lock_guard<std::mutex> lock(pool_mutex);
   auto it = client_pool.find(connection_key);
+  if (it != client_pool.end() && it->second.pool != pool) {
+    // Another lookup replaced it already
+    return it->second.pool;
+  }
   if (it != client_pool.end()) {
-    // Validate the pooled connection is still alive
-    if (it->second->ValidateConnection()) {
-      return it->second;
-    }
-    // Connection is dead, remove it from pool and create new one
+    // Handles that still hold the old pool reconnect it on demand; its
+    // connections don't count against MAX_CONNECTIONS while unused
+    pool->Retire();
     client_pool.erase(it);
   }
+  return CreateSessionPool(connection_key, params);
+}
+
+std::shared_ptr<SSHSessionPool>
+SSHFSFileSystem::CreateSessionPool(const string &connection_key,
+                                   const SSHConnectionParams &params) {
+  // Primary client connects lazily
+  auto session_pool = std::make_shared<SSHSessionPool>(params);
+  session_pool->SetBlockCache(block_cache);
+  session_pool->SetMetadataCache(metadata_cache);
+  session_pool->SetUploadScheduler(upload_scheduler);
+  session_pool->SetReadaheadScheduler(readahead_scheduler);
+  session_pool->SetBufferPool(buffer_pool);
+  client_pool.insert_or_assign(
+      connection_key, PoolEntry{session_pool, SSHFSPoolSettings(params)});
+  return session_pool;
+}
 
-  // Create new client
-  auto client = std::make_shared<SSHClient>(params);
-  client_pool[connection_key] = client;
+void SSHFSFileSystem::MaintenanceLoop() {
+  std::unique_lock<std::mutex> lock(maintenance_mutex);
+  while (true) {
+    maintenance_cv.wait_for(lock, MAINTENANCE_INTERVAL,
+                            [this]() { return maintenance_stopping; });
+    if (maintenance_stopping) {
+      return;
+    }
+    lock.unlock();
+    try {
+      RunMaintenance();
+    } catch (const std::exception &e) {
+      SSHFS_LOG("  [MAINTENANCE] " << e.what());
+    }
+    lock.lock();
+  }
+}
+
+void SSHFSFileSystem::RunMaintenance() {
+  std::vector<std::pair<string, std::shared_ptr<SSHSessionPool>>> pools;
+  // Old and new pool of each replaced connection
+  std::vector<std::pair<std::shared_ptr<SSHSessionPool>,
+                        std::shared_ptr<SSHSessionPool>>>
+      replaced;
+  std::chrono::seconds idle_timeout;
+  std::chrono::seconds max_lifetime;
+  {
+    std::lock_guard<std::mutex> lock(settings_mutex);
+    idle_timeout = std::chrono::seconds(shared_settings.idle_timeout_seconds);
+    max_lifetime =
+        std::chrono::seconds(shared_settings.max_connection_lifetime_seconds);
+  }
+  {
+    std::lock_guard<std::mutex> lock(pool_mutex);
+    for (auto &entry : client_pool) {
+      pools.emplace_back(entry.first, entry.second.pool);
+    }
+  }
+
+  // Pools are checked without pool_mutex - keepalives are network round
+  // trips and lookups must not wait for them
+  for (auto &entry : pools) {
+    auto &pool = entry.second;
+    auto health = pool->Maintain(idle_timeout, max_lifetime);
+    if (health == SSHSessionPool::Health::HEALTHY) {
+      continue;
+    }
+
+    std::lock_guard<std::mutex> lock(pool_mutex);
+    auto it = client_pool.find(entry.first);
+    if (it == client_pool.end() || it->second.pool != pool) {
+      continue;
+    }
+    if (health == SSHSessionPool::Health::IDLE) {
+      // Only close pools no open file handle is using (map + this copy)
+      if (pool.use_count() <= 2) {
+        SSHFS_LOG("  [MAINTENANCE] Closing idle connections to "
+                  << entry.first);
+        client_pool.erase(it);
+      }
+      continue;
+    }
+
+    // Dead or expired - new lookups get a fresh pool, handles that still
+    // hold the old one keep using it
+    SSHFS_LOG("  [MAINTENANCE] Replacing "
+              << (health == SSHSessionPool::Health::DEAD ? "dead" : "expired")
+              << " connection to " << entry.first);
+    replaced.emplace_back(pool,
+                          CreateSessionPool(entry.first, pool->GetParams()));
+  }
+
+  // The old pool closes its idle connections before the replacement
+  // connects, so both together stay within MAX_CONNECTIONS
+  for (auto &entry : replaced) {
+    entry.first->Retire();
+    entry.second->Prewarm(1);
+  }
+  // Dropped pools disconnect here, outside pool_mutex
+}
+
+void SSHFSFileSystem::ApplySharedSettings(const SSHConnectionParams &params) {
+  SSHFSSharedSettings settings(params);
+  std::lock_guard<std::mutex> lock(settings_mutex);
+  auto &current = shared_settings;
+  if (settings.block_cache_size != current.block_cache_size) {
+    block_cache->SetCapacity(settings.block_cache_size);
+  }
+  if (settings.metadata_cache_ttl_ms != current.metadata_cache_ttl_ms) {
+    metadata_cache->SetTTL(settings.metadata_cache_ttl_ms);
+  }
+  if (settings.upload_threads != current.upload_threads ||
+      settings.max_host_uploads != current.max_host_uploads) {
+    upload_scheduler->SetLimits(settings.upload_threads,
+                                settings.max_host_uploads);
+  }
+  if (settings.upload_memory_limit != current.upload_memory_limit) {
+    buffer_pool->SetLimit(settings.upload_memory_limit);
+  }
+  if (settings.upload_spill_directory != current.upload_spill_directory) {
+    buffer_pool->SetSpillDirectory(settings.upload_spill_directory);
+  }
+  // A new directory is indexed here, outside pool_mutex - lookups of pools
+  // that are already configured don't wait for the scan
+  if (settings.cache_directory != current.cache_directory ||
+      settings.cache_max_size != current.cache_max_size) {
+    ConfigureDiskCache(settings);
+  }
+  current = settings;
+}
+
+void SSHFSFileSystem::ConfigureDiskCache(const SSHFSSharedSettings &settings) {
+  auto disk_cache = block_cache->GetDiskCache();
+  if (settings.cache_directory.empty()) {
+    if (disk_cache) {
+      block_cache->SetDiskCache(nullptr);
+    }
+    return;
+  }
+
+  if (disk_cache && disk_cache->GetDirectory() == settings.cache_directory) {
+    disk_cache->SetMaxSize(settings.cache_max_size);
+    return;
+  }
 
-  return client;
+  // New or changed directory - indexes the blocks already on disk
+  block_cache->SetDiskCache(std::make_shared<SSHFSDiskCache>(
+      settings.cache_directory, settings.cache_max_size));
 }
 
 string
 SSHFSFileSystem::ExtractConnectionKey(const SSHConnectionParams &params) {
+  // Compressed and uncompressed SSH connections can't be shared
   return params.username + "@" + params.hostname + ":" +
-         std::to_string(params.port);
+         std::to_string(params.port) +
+         (params.compression == SSHCompression::SSH ? "#zlib" : "");
 }
 
 } // namespace duckdb
@@ -0,0 +1,113 @@
+#include "sshfs_glob.hpp"
+#include "duckdb/common/file_system.hpp"
+#include <fnmatch.h>
+
+namespace duckdb {
+
+bool SSHFSGlobPattern::IsRecursive() const {
+  for (auto &segment : segments) {
+    if (segment == "**") {
+      return true;
+    }
+  }
+  return false;
+}
+
+SSHFSGlobPattern ParseGlobPattern(const std::string &remote_path) {
+  SSHFSGlobPattern pattern;
+  bool absolute = !remote_path.empty() && remote_path[0] == '/';
+  auto parts = SplitRemotePath(remote_path);
+
+  size_t i = 0;
+  std::vector<std::string> literal;
+  for (; i < parts.size(); i++) {
+    if (FileSystem::HasGlob(parts[i])) {
+      break;
+    }
+    literal.push_back(parts[i]);
+  }
+  if (i == parts.size() && !literal.empty()) {
+    // No wildcard at all - the last segment is the file name itself
+    pattern.segments.push_back(literal.back());
+    literal.pop_back();
+  }
+  for (; i < parts.size(); i++) {
+    pattern.segments.push_back(parts[i]);
+  }
+
+  pattern.base = absolute ? "/" : "";
+  for (size_t j = 0; j < literal.size(); j++) {
+    if (j > 0) {
+      pattern.base += "/";
+    }
+    pattern.base += literal[j];
+  }
+  return pattern;
+}
+
+bool GlobMatchSegment(const std::string &pattern, const std::string &name) {
+  return fnmatch(pattern.c_str(), name.c_str(), 0) == 0;
+}
+
+static bool GlobMatchPath(const std::vector<std::string> &pattern,
+                          size_t pattern_index,
+                          const std::vector<std::string> &path,
+                          size_t path_index) {
+  while (pattern_index < pattern.size()) {
+    if (pattern[pattern_index] == "**") {
+      // Collapse consecutive "**" and try every possible split
+      while (pattern_index < pattern.size() && pattern[pattern_index] == "**") {
+        pattern_index++;
+      }
+      if (pattern_index == pattern.size()) {
+        return true;
+      }
+      for (size_t i = path_index; i < path.size(); i++) {
+        if (GlobMatchPath(pattern, pattern_index, path, i)) {
+          return true;
+        }
+      }
+      return false;
+    }
+    if (path_index >= path.size() ||
+        !GlobMatchSegment(pattern[pattern_index], path[path_index])) {
+      return false;
+    }
+    pattern_index++;
+    path_index++;
+  }
+  return path_index == path.size();
+}
+
+bool GlobMatchPath(const std::vector<std::string> &pattern,
+                   const std::vector<std::string> &path) {
+  return GlobMatchPath(pattern, 0, path, 0);
+}
+
+std::vector<std::string> SplitRemotePath(const std::string &path) {
+  std::vector<std::string> segments;
+  size_t start = 0;
+  while (start <= path.size()) {
+    size_t end = path.find('/', start);
+    if (end == std::string::npos) {
+      end = path.size();
+    }
+    if (end > start) {
+      segments.push_back(path.substr(start, end - start));
+    }
+    start = end + 1;
+  }
+  return segments;
+}
+
+std::string JoinRemotePath(const std::string &dir, const std::string &name) {
+  if (dir.empty()) {
+    return name;
+  }
+  if (dir.back() == '/') {
+    return dir + name;
+  }
+  return dir + "/" + name;
+}
+
+} // namespace duckdb
@@ -0,0 +1,189 @@
+#include "sshfs_ls.hpp"
+#include "duckdb/function/table_function.hpp"
+#include "duckdb/main/client_context_file_opener.hpp"
+#include "duckdb/main/extension/extension_loader.hpp"
+#include "sshfs_filesystem.hpp"
+#include "sshfs_glob.hpp"
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <mutex>
+#include <thread>
+
+namespace duckdb {
+
+namespace {
+
+struct SSHFSListInfo : public TableFunctionInfo {
+  explicit SSHFSListInfo(SSHFSFileSystem &fs) : fs(fs) {}
+  SSHFSFileSystem &fs;
+};
+
+struct SSHFSListBindData : public TableFunctionData {
+  explicit SSHFSListBindData(SSHFSFileSystem &fs) : fs(fs) {}
+  SSHFSFileSystem &fs;
+  string url;
+  bool recursive = false;
+  bool with_hash = false;
+};
+
+struct SSHFSListRow {
+  string name;
+  bool is_directory;
+  uint64_t size;
+  uint32_t mtime;
+  string sha256;
+};
+
+// Rows are produced by a background listing and consumed by the scan as they
+// arrive, so the first vectors are emitted while the remote find (and its
+// hashing) is still running. The queue is not bounded: the listing holds a
+// pooled session, and blocking it on a slow consumer could starve other
+// scans of the same query that need one.
+struct SSHFSListState : public GlobalTableFunctionState {
+  std::shared_ptr<SSHSessionPool> pool;
+  string url_prefix;
+  string remote_path;
+
+  std::mutex mutex;
+  std::condition_variable cv;
+  std::deque<SSHFSListRow> rows;
+  bool finished = false;
+  bool stopping = false;
+  std::exception_ptr error;
+  std::thread producer;
+
+  ~SSHFSListState() override {
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      stopping = true;
+    }
+    if (producer.joinable()) {
+      producer.join();
+    }
+  }
+};
+
+unique_ptr<FunctionData> SSHFSListBind(ClientContext &context,
+                                       TableFunctionBindInput &input,
+                                       vector<LogicalType> &return_types,
+                                       vector<string> &names) {
+  auto &info = input.info->Cast<SSHFSListInfo>();
+  auto result = make_uniq<SSHFSListBindData>(info.fs);
+  result->url = input.inputs[0].GetValue<string>();
+  if (!info.fs.CanHandleFile(result->url)) {
+    throw InvalidInputException(
+        "sshfs_ls expects an sshfs://, ssh:// or sftp:// URL, got '%s'",
+        result->url);
+  }
+
+  auto recursive = input.named_parameters.find("recursive");
+  if (recursive != input.named_parameters.end() &&
+      !recursive->second.IsNull()) {
+    result->recursive = recursive->second.GetValue<bool>();
+  }
+  auto with_hash = input.named_parameters.find("with_hash");
+  if (with_hash != input.named_parameters.end() &&
+      !with_hash->second.IsNull()) {
+    result->with_hash = with_hash->second.GetValue<bool>();
+  }
+
+  names = {"path", "type", "size", "last_modified", "sha256"};
+  return_types = {LogicalType::VARCHAR, LogicalType::VARCHAR,
+                  LogicalType::UBIGINT, LogicalType::TIMESTAMP,
+                  LogicalType::VARCHAR};
+  return std::move(result);
+}
+
+unique_ptr<GlobalTableFunctionState>
+SSHFSListInit(ClientContext &context, TableFunctionInitInput &input) {
+  auto &bind_data = input.bind_data->Cast<SSHFSListBindData>();
+  auto state = make_uniq<SSHFSListState>();
+
+  ClientContextFileOpener opener(context);
+  auto params = bind_data.fs.ParseURL(bind_data.url, &opener);
+  state->pool = bind_data.fs.GetOrCreateSessionPool(bind_data.url, &opener);
+  state->remote_path = params.remote_path;
+  // Everything before the remote path (ssh://user@host:port or host:)
+  state->url_prefix = bind_data.url.substr(
+      0, bind_data.url.size() - params.remote_path.size());
+
+  auto &fs = bind_data.fs;
+  bool recursive = bind_data.recursive;
+  bool with_hash = bind_data.with_hash;
+  auto &shared = *state;
+  state->producer = std::thread([&fs, &shared, recursive, with_hash]() {
+    try {
+      fs.ListTree(*shared.pool, shared.remote_path, recursive, with_hash,
+                  [&](const SFTPDirEntry &entry, const string &sha256) {
+                    std::lock_guard<std::mutex> lock(shared.mutex);
+                    if (shared.stopping) {
+                      return false;
+                    }
+                    shared.rows.push_back({entry.name, entry.IsDirectory(),
+                                           entry.attrs.filesize,
+                                           static_cast<uint32_t>(
+                                               entry.attrs.mtime),
+                                           sha256});
+                    shared.cv.notify_one();
+                    return true;
+                  });
+    } catch (...) {
+      std::lock_guard<std::mutex> lock(shared.mutex);
+      shared.error = std::current_exception();
+    }
+    std::lock_guard<std::mutex> lock(shared.mutex);
+    shared.finished = true;
+    shared.cv.notify_one();
+  });
+  return std::move(state);
+}
+
+void SSHFSListScan(ClientContext &context, TableFunctionInput &data,
+                   DataChunk &output) {
+  auto &state = data.global_state->Cast<SSHFSListState>();
+
+  std::deque<SSHFSListRow> batch;
+  {
+    std::unique_lock<std::mutex> lock(state.mutex);
+    state.cv.wait(lock,
+                  [&]() { return !state.rows.empty() || state.finished; });
+    if (state.rows.empty() && state.error) {
+      std::rethrow_exception(state.error);
+    }
+    while (!state.rows.empty() && batch.size() < STANDARD_VECTOR_SIZE) {
+      batch.push_back(std::move(state.rows.front()));
+      state.rows.pop_front();
+    }
+  }
+
+  idx_t count = 0;
+  for (auto &row : batch) {
+    output.SetValue(0, count,
+                    Value(state.url_prefix +
+                          JoinRemotePath(state.remote_path, row.name)));
+    output.SetValue(1, count, Value(row.is_directory ? "directory" : "file"));
+    output.SetValue(2, count, Value::UBIGINT(row.size));
+    output.SetValue(
+        3, count, Value::TIMESTAMP(Timestamp::FromEpochSeconds(row.mtime)));
+    output.SetValue(4, count,
+                    row.sha256.empty() ? Value(LogicalType::VARCHAR)
+                                       : Value(row.sha256));
+    count++;
+  }
+  output.SetCardinality(count);
+}
+
+} // namespace
+
+void SSHFSListFunction::Register(ExtensionLoader &loader,
+                                 SSHFSFileSystem &fs) {
+  TableFunction ls_function("sshfs_ls", {LogicalType::VARCHAR}, SSHFSListScan,
+                            SSHFSListBind, SSHFSListInit);
+  ls_function.named_parameters["recursive"] = LogicalType::BOOLEAN;
+  ls_function.named_parameters["with_hash"] = LogicalType::BOOLEAN;
+  ls_function.function_info = make_shared_ptr<SSHFSListInfo>(fs);
+  loader.RegisterFunction(ls_function);
+}
+
+} // namespace duckdb
@@ -0,0 +1,103 @@
+#include "sshfs_metadata_cache.hpp"
+#include <cstring>
+
+namespace duckdb {
+
+constexpr size_t SSHFSMetadataCache::MAX_ENTRIES;
+
+void SSHFSMetadataCache::Put(const std::string &key,
+                             const LIBSSH2_SFTP_ATTRIBUTES &attrs) {
+  Entry entry;
+  entry.attrs = attrs;
+  std::lock_guard<std::mutex> lock(mutex);
+  Insert(key, entry);
+}
+
+void SSHFSMetadataCache::PutMissing(const std::string &key) {
+  Entry entry;
+  memset(&entry.attrs, 0, sizeof(entry.attrs));
+  entry.exists = false;
+  std::lock_guard<std::mutex> lock(mutex);
+  Insert(key, entry);
+}
+
+bool SSHFSMetadataCache::Get(const std::string &key,
+                             LIBSSH2_SFTP_ATTRIBUTES &attrs, bool &exists) {
+  std::lock_guard<std::mutex> lock(mutex);
+  auto it = entries.find(key);
+  if (it == entries.end()) {
+    return false;
+  }
+  if (Clock::now() >= it->second.expires) {
+    entries.erase(it);
+    return false;
+  }
+  attrs = it->second.attrs;
+  exists = it->second.exists;
+  return true;
+}
+
+bool SSHFSMetadataCache::Get(const std::string &key,
+                             LIBSSH2_SFTP_ATTRIBUTES &attrs) {
+  bool exists;
+  return Get(key, attrs, exists) && exists;
+}
+
+void SSHFSMetadataCache::Invalidate(const std::string &key) {
+  std::lock_guard<std::mutex> lock(mutex);
+  entries.erase(key);
+}
+
+void SSHFSMetadataCache::InvalidatePrefix(const std::string &prefix) {
+  std::lock_guard<std::mutex> lock(mutex);
+  for (auto it = entries.begin(); it != entries.end();) {
+    if (it->first.compare(0, prefix.size(), prefix) == 0) {
+      it = entries.erase(it);
+    } else {
+      ++it;
+    }
+  }
+}
+
+void SSHFSMetadataCache::SetTTL(uint64_t new_ttl_ms) {
+  std::lock_guard<std::mutex> lock(mutex);
+  ttl_ms = new_ttl_ms;
+  if (ttl_ms == 0) {
+    entries.clear();
+  }
+}
+
+size_t SSHFSMetadataCache::Size() {
+  std::lock_guard<std::mutex> lock(mutex);
+  return entries.size();
+}
+
+void SSHFSMetadataCache::Insert(const std::string &key, const Entry &entry) {
+  if (ttl_ms == 0) {
+    return;
+  }
+
+  auto now = Clock::now();
+  if (entries.size() >= MAX_ENTRIES && entries.find(key) == entries.end()) {
+    PurgeExpired(now);
+    if (entries.size() >= MAX_ENTRIES) {
+      entries.clear();
+    }
+  }
+
+  auto &stored = entries[key];
+  stored = entry;
+  stored.expires = now + std::chrono::milliseconds(ttl_ms);
+}
+
+void SSHFSMetadataCache::PurgeExpired(Clock::time_point now) {
+  for (auto it = entries.begin(); it != entries.end();) {
+    if (now >= it->second.expires) {
+      it = entries.erase(it);
+    } else {
+      ++it;
+    }
+  }
+}
+
+} // namespace duckdb
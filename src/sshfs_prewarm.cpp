@@ -0,0 +1,105 @@
+#include "sshfs_prewarm.hpp"
+#include "duckdb/function/table_function.hpp"
+#include "duckdb/main/client_context_file_opener.hpp"
+#include "duckdb/main/extension/extension_loader.hpp"
+#include "sshfs_filesystem.hpp"
+
+namespace duckdb {
+
+namespace {
+
+struct SSHFSPrewarmInfo : public TableFunctionInfo {
+  explicit SSHFSPrewarmInfo(SSHFSFileSystem &fs) : fs(fs) {}
+  SSHFSFileSystem &fs;
+};
+
+struct SSHFSPrewarmBindData : public TableFunctionData {
+  explicit SSHFSPrewarmBindData(SSHFSFileSystem &fs) : fs(fs) {}
+  SSHFSFileSystem &fs;
+  string url;
+  size_t sessions = 1;
+  bool wait = false;
+};
+
+struct SSHFSPrewarmState : public GlobalTableFunctionState {
+  bool done = false;
+};
+
+unique_ptr<FunctionData> SSHFSPrewarmBind(ClientContext &context,
+                                          TableFunctionBindInput &input,
+                                          vector<LogicalType> &return_types,
+                                          vector<string> &names) {
+  auto &info = input.info->Cast<SSHFSPrewarmInfo>();
+  auto result = make_uniq<SSHFSPrewarmBindData>(info.fs);
+  result->url = input.inputs[0].GetValue<string>();
+  if (!info.fs.CanHandleFile(result->url)) {
+    throw InvalidInputException(
+        "sshfs_prewarm expects an sshfs://, ssh:// or sftp:// URL, got '%s'",
+        result->url);
+  }
+
+  auto sessions = input.named_parameters.find("sessions");
+  if (sessions != input.named_parameters.end() && !sessions->second.IsNull()) {
+    auto value = sessions->second.GetValue<int64_t>();
+    if (value < 1) {
+      throw InvalidInputException("sshfs_prewarm sessions must be at least 1");
+    }
+    result->sessions = static_cast<size_t>(value);
+  }
+  auto wait = input.named_parameters.find("wait");
+  if (wait != input.named_parameters.end() && !wait->second.IsNull()) {
+    result->wait = wait->second.GetValue<bool>();
+  }
+
+  names = {"host", "sessions", "connected"};
+  return_types = {LogicalType::VARCHAR, LogicalType::UBIGINT,
+                  LogicalType::BOOLEAN};
+  return std::move(result);
+}
+
+unique_ptr<GlobalTableFunctionState>
+SSHFSPrewarmInit(ClientContext &context, TableFunctionInitInput &input) {
+  return make_uniq<SSHFSPrewarmState>();
+}
+
+void SSHFSPrewarmScan(ClientContext &context, TableFunctionInput &data,
+                      DataChunk &output) {
+  auto &bind_data = data.bind_data->Cast<SSHFSPrewarmBindData>();
+  auto &state = data.global_state->Cast<SSHFSPrewarmState>();
+  if (state.done) {
+    output.SetCardinality(0);
+    return;
+  }
+  state.done = true;
+
+  // Same pool (and settings) the queries on this host will use
+  ClientContextFileOpener opener(context);
+  auto params = bind_data.fs.ParseURL(bind_data.url, &opener);
+  auto pool = bind_data.fs.GetOrCreateSessionPool(bind_data.url, &opener);
+  pool->Prewarm(bind_data.sessions);
+  if (bind_data.wait) {
+    pool->WaitForPrewarm();
+  }
+
+  output.SetValue(0, 0,
+                  Value(params.username + "@" + params.hostname + ":" +
+                        std::to_string(params.port)));
+  output.SetValue(1, 0, Value::UBIGINT(pool->GetSessionCount()));
+  output.SetValue(2, 0, Value::BOOLEAN(pool->GetPrimary()->IsConnected()));
+  output.SetCardinality(1);
+}
+
+} // namespace
+
+void SSHFSPrewarmFunction::Register(ExtensionLoader &loader,
+                                    SSHFSFileSystem &fs) {
+  TableFunction prewarm_function("sshfs_prewarm", {LogicalType::VARCHAR},
+                                 SSHFSPrewarmScan, SSHFSPrewarmBind,
+                                 SSHFSPrewarmInit);
+  prewarm_function.named_parameters["sessions"] = LogicalType::BIGINT;
+  prewarm_function.named_parameters["wait"] = LogicalType::BOOLEAN;
+  prewarm_function.function_info = make_shared_ptr<SSHFSPrewarmInfo>(fs);
+  loader.RegisterFunction(prewarm_function);
+}
+
+} // namespace duckdb
@@ -0,0 +1,150 @@
+#include "sshfs_read_coalescer.hpp"
+#include "ssh_helpers.hpp"
+#include <algorithm>
+#include <cstring>
+#include <numeric>
+#include <thread>
+
+namespace duckdb {
+
+constexpr std::chrono::microseconds SSHFSReadCoalescer::WINDOW;
+constexpr size_t SSHFSReadCoalescer::MAX_MERGED_SIZE;
+
+std::vector<SSHFSReadRange>
+PlanCoalescedReads(const std::vector<std::pair<idx_t, size_t>> &reads,
+                   size_t max_gap, size_t max_size) {
+  std::vector<size_t> order(reads.size());
+  std::iota(order.begin(), order.end(), 0);
+  std::sort(order.begin(), order.end(), [&reads](size_t a, size_t b) {
+    return reads[a].first < reads[b].first;
+  });
+
+  std::vector<SSHFSReadRange> ranges;
+  for (auto index : order) {
+    idx_t offset = reads[index].first;
+    idx_t end = offset + reads[index].second;
+    if (!ranges.empty()) {
+      auto &last = ranges.back();
+      idx_t last_end = last.offset + last.length;
+      idx_t merged_end = std::max(last_end, end);
+      if (offset <= last_end + max_gap &&
+          merged_end - last.offset <= max_size) {
+        last.length = merged_end - last.offset;
+        last.members.push_back(index);
+        continue;
+      }
+    }
+    SSHFSReadRange range;
+    range.offset = offset;
+    range.length = reads[index].second;
+    range.members.push_back(index);
+    ranges.push_back(std::move(range));
+  }
+  return ranges;
+}
+
+size_t SSHFSReadCoalescer::Read(const std::string &remote_path, idx_t offset,
+                                char *buffer, size_t length, size_t max_gap,
+                                const FetchFunction &fetch) {
+  Request request;
+  request.offset = offset;
+  request.length = length;
+  request.buffer = buffer;
+
+  std::unique_lock<std::mutex> lock(mutex);
+  auto &open_batch = open_batches[remote_path];
+  bool leader = !open_batch;
+  if (leader) {
+    open_batch = std::make_shared<Batch>();
+  }
+  auto batch = open_batch;
+  batch->requests.push_back(&request);
+
+  if (leader) {
+    // Give reads issued by other threads a moment to join
+    lock.unlock();
+    std::this_thread::sleep_for(WINDOW);
+    lock.lock();
+    open_batches.erase(remote_path);
+
+    std::vector<std::pair<idx_t, size_t>> reads;
+    for (auto member : batch->requests) {
+      reads.emplace_back(member->offset, member->length);
+    }
+    auto plan = PlanCoalescedReads(reads, max_gap, MAX_MERGED_SIZE);
+    if (plan.size() < reads.size()) {
+      SSHFS_LOG("  [COALESCE] " << reads.size() << " reads of " << remote_path
+                                << " sent as " << plan.size()
+                                << " requests");
+    }
+    for (auto &planned : plan) {
+      auto range = std::make_shared<PlannedRange>();
+      range->offset = planned.offset;
+      range->length = planned.length;
+      for (auto index : planned.members) {
+        range->members.push_back(batch->requests[index]);
+        batch->requests[index]->range = range;
+      }
+      range->members.front()->owner = true;
+    }
+    cv.notify_all();
+  }
+
+  cv.wait(lock, [&request]() { return request.range != nullptr; });
+  if (request.owner) {
+    auto range = request.range;
+    lock.unlock();
+    FetchRange(remote_path, *range, fetch);
+    lock.lock();
+    for (auto member : range->members) {
+      member->done = true;
+    }
+    cv.notify_all();
+  }
+
+  cv.wait(lock, [&request]() { return request.done; });
+  if (request.error) {
+    std::rethrow_exception(request.error);
+  }
+  return request.result;
+}
+
+void SSHFSReadCoalescer::FetchRange(const std::string &remote_path,
+                                    PlannedRange &range,
+                                    const FetchFunction &fetch) {
+  // Members are only touched by their owner until they are marked done
+  if (range.members.size() == 1) {
+    auto member = range.members.front();
+    try {
+      member->result =
+          fetch(remote_path, member->offset, member->buffer, member->length);
+    } catch (...) {
+      member->error = std::current_exception();
+    }
+    return;
+  }
+
+  std::vector<char> data;
+  size_t bytes_read = 0;
+  try {
+    data.resize(range.length);
+    bytes_read = fetch(remote_path, range.offset, data.data(), range.length);
+  } catch (...) {
+    auto error = std::current_exception();
+    for (auto member : range.members) {
+      member->error = error;
+    }
+    return;
+  }
+
+  for (auto member : range.members) {
+    size_t start = member->offset - range.offset;
+    member->result =
+        bytes_read > start ? std::min(member->length, bytes_read - start) : 0;
+    if (member->result > 0) {
+      std::memcpy(member->buffer, data.data() + start, member->result);
+    }
+  }
+}
+
+} // namespace duckdb
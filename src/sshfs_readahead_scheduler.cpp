@@ -0,0 +1,68 @@
+#include "sshfs_readahead_scheduler.hpp"
+#include "ssh_helpers.hpp"
+
+namespace duckdb {
+
+constexpr size_t SSHFSReadaheadScheduler::MAX_QUEUED;
+
+SSHFSReadaheadScheduler::~SSHFSReadaheadScheduler() { Shutdown(); }
+
+bool SSHFSReadaheadScheduler::Submit(std::function<void()> job) {
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (stopping || queue.size() >= MAX_QUEUED) {
+      return false;
+    }
+    queue.push_back(std::move(job));
+    // The worker starts with the first job
+    if (!worker.joinable()) {
+      worker = std::thread([this]() { WorkerLoop(); });
+    }
+  }
+  work_cv.notify_one();
+  return true;
+}
+
+void SSHFSReadaheadScheduler::Shutdown() {
+  std::deque<std::function<void()>> dropped;
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    stopping = true;
+    dropped.swap(queue);
+  }
+  work_cv.notify_all();
+  if (worker.joinable()) {
+    worker.join();
+  }
+  // Jobs hold their session pool - release them outside the lock
+  dropped.clear();
+}
+
+size_t SSHFSReadaheadScheduler::GetQueuedCount() {
+  std::lock_guard<std::mutex> lock(mutex);
+  return queue.size();
+}
+
+void SSHFSReadaheadScheduler::WorkerLoop() {
+  std::unique_lock<std::mutex> lock(mutex);
+  while (true) {
+    work_cv.wait(lock, [this]() { return stopping || !queue.empty(); });
+    if (stopping) {
+      return;
+    }
+    auto job = std::move(queue.front());
+    queue.pop_front();
+
+    lock.unlock();
+    try {
+      job();
+    } catch (const std::exception &e) {
+      // Best effort - the foreground read fetches the blocks itself
+      SSHFS_LOG("  [READAHEAD] Prefetch failed: " << e.what());
+    }
+    job = nullptr;
+    lock.lock();
+  }
+}
+
+} // namespace duckdb
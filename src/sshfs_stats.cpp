@@ -0,0 +1,168 @@
+#include "sshfs_stats.hpp"
+#include "duckdb/function/table_function.hpp"
+#include "duckdb/main/extension/extension_loader.hpp"
+#include "ssh_client.hpp"
+#include <tuple>
+
+namespace duckdb {
+
+constexpr size_t SSHFSLatencyHistogram::BUCKETS;
+
+std::mutex SSHFSStatsRegistry::mutex;
+std::map<std::string, std::shared_ptr<SSHFSHostStats>>
+    SSHFSStatsRegistry::hosts;
+
+void SSHFSLatencyHistogram::Record(uint64_t micros) {
+  // Bucket i holds latencies below 2^i microseconds
+  size_t bucket = 0;
+  while (bucket + 1 < BUCKETS && (uint64_t(1) << bucket) <= micros) {
+    bucket++;
+  }
+  buckets[bucket].fetch_add(1, std::memory_order_relaxed);
+}
+
+uint64_t SSHFSLatencyHistogram::GetCount() const {
+  uint64_t count = 0;
+  for (auto &bucket : buckets) {
+    count += bucket.load(std::memory_order_relaxed);
+  }
+  return count;
+}
+
+uint64_t SSHFSLatencyHistogram::GetPercentile(double quantile) const {
+  uint64_t count = GetCount();
+  if (count == 0) {
+    return 0;
+  }
+  auto target = static_cast<uint64_t>(quantile * count);
+  uint64_t seen = 0;
+  for (size_t i = 0; i < BUCKETS; i++) {
+    seen += buckets[i].load(std::memory_order_relaxed);
+    if (seen > target) {
+      return uint64_t(1) << i;
+    }
+  }
+  return uint64_t(1) << (BUCKETS - 1);
+}
+
+void SSHFSLatencyHistogram::Reset() {
+  for (auto &bucket : buckets) {
+    bucket.store(0, std::memory_order_relaxed);
+  }
+}
+
+std::vector<std::pair<std::string, uint64_t>>
+SSHFSHostStats::Snapshot() const {
+  return {
+      {"bytes_read", bytes_read.load()},
+      {"bytes_written", bytes_written.load()},
+      {"read_requests", read_requests.load()},
+      {"write_requests", write_requests.load()},
+      {"handle_opens", handle_opens.load()},
+      {"stat_calls", stat_calls.load()},
+      {"retries", retries.load()},
+      {"connects", connects.load()},
+      {"session_wait_us", session_wait_us.load()},
+      {"upload_wait_us", upload_wait_us.load()},
+      {"read_latency_p50_us", read_latency.GetPercentile(0.5)},
+      {"read_latency_p99_us", read_latency.GetPercentile(0.99)},
+      {"write_latency_p50_us", write_latency.GetPercentile(0.5)},
+      {"write_latency_p99_us", write_latency.GetPercentile(0.99)},
+  };
+}
+
+void SSHFSHostStats::Reset() {
+  for (auto counter : {&bytes_read, &bytes_written, &read_requests,
+                       &write_requests, &handle_opens, &stat_calls, &retries,
+                       &connects, &session_wait_us, &upload_wait_us}) {
+    counter->store(0);
+  }
+  read_latency.Reset();
+  write_latency.Reset();
+}
+
+std::shared_ptr<SSHFSHostStats>
+SSHFSStatsRegistry::ForHost(const SSHConnectionParams &params) {
+  std::string key = params.username + "@" + params.hostname + ":" +
+                    std::to_string(params.port);
+  std::lock_guard<std::mutex> lock(mutex);
+  auto &stats = hosts[key];
+  if (!stats) {
+    stats = std::make_shared<SSHFSHostStats>();
+  }
+  return stats;
+}
+
+std::vector<std::pair<std::string, std::shared_ptr<SSHFSHostStats>>>
+SSHFSStatsRegistry::GetAll() {
+  std::lock_guard<std::mutex> lock(mutex);
+  return {hosts.begin(), hosts.end()};
+}
+
+namespace {
+
+struct SSHFSStatsBindData : public TableFunctionData {
+  bool reset = false;
+};
+
+struct SSHFSStatsState : public GlobalTableFunctionState {
+  std::vector<std::tuple<std::string, std::string, uint64_t>> rows;
+  idx_t offset = 0;
+};
+
+unique_ptr<FunctionData> SSHFSStatsBind(ClientContext &context,
+                                        TableFunctionBindInput &input,
+                                        vector<LogicalType> &return_types,
+                                        vector<string> &names) {
+  auto result = make_uniq<SSHFSStatsBindData>();
+  auto reset = input.named_parameters.find("reset");
+  if (reset != input.named_parameters.end() && !reset->second.IsNull()) {
+    result->reset = reset->second.GetValue<bool>();
+  }
+
+  names = {"host", "metric", "value"};
+  return_types = {LogicalType::VARCHAR, LogicalType::VARCHAR,
+                  LogicalType::UBIGINT};
+  return std::move(result);
+}
+
+unique_ptr<GlobalTableFunctionState>
+SSHFSStatsInit(ClientContext &context, TableFunctionInitInput &input) {
+  auto &bind_data = input.bind_data->Cast<SSHFSStatsBindData>();
+  auto state = make_uniq<SSHFSStatsState>();
+  for (auto &host : SSHFSStatsRegistry::GetAll()) {
+    for (auto &metric : host.second->Snapshot()) {
+      state->rows.emplace_back(host.first, metric.first, metric.second);
+    }
+    // Returns the counters up to now, so a query can be measured on its own
+    if (bind_data.reset) {
+      host.second->Reset();
+    }
+  }
+  return std::move(state);
+}
+
+void SSHFSStatsScan(ClientContext &context, TableFunctionInput &data,
+                    DataChunk &output) {
+  auto &state = data.global_state->Cast<SSHFSStatsState>();
+  idx_t count = 0;
+  while (state.offset < state.rows.size() && count < STANDARD_VECTOR_SIZE) {
+    auto &row = state.rows[state.offset++];
+    output.SetValue(0, count, Value(std::get<0>(row)));
+    output.SetValue(1, count, Value(std::get<1>(row)));
+    output.SetValue(2, count, Value::UBIGINT(std::get<2>(row)));
+    count++;
+  }
+  output.SetCardinality(count);
+}
+
+} // namespace
+
+void SSHFSStatsFunction::Register(ExtensionLoader &loader) {
+  TableFunction stats_function("sshfs_stats", {}, SSHFSStatsScan,
+                               SSHFSStatsBind, SSHFSStatsInit);
+  stats_function.named_parameters["reset"] = LogicalType::BOOLEAN;
+  loader.RegisterFunction(stats_function);
+}
+
+} // namespace duckdb
@@ -0,0 +1,196 @@
+#include "sshfs_upload_scheduler.hpp"
+#include "ssh_helpers.hpp"
+#include <algorithm>
+
+namespace duckdb {
+
+SSHFSUploadGroup::SSHFSUploadGroup(SSHFSUploadScheduler &scheduler,
+                                   std::string host_key, size_t max_pending,
+                                   size_t max_parallel)
+    : scheduler(scheduler), host_key(std::move(host_key)),
+      max_pending(std::max<size_t>(1, max_pending)),
+      max_parallel(std::max<size_t>(1, max_parallel)) {}
+
+void SSHFSUploadGroup::Submit(std::function<void()> job, size_t bytes) {
+  std::unique_lock<std::mutex> lock(scheduler.mutex);
+  // Backpressure - the writer waits for its own uploads, not for other files
+  done_cv.wait(lock, [this]() {
+    return queue.size() + running < max_pending || first_error;
+  });
+  if (first_error) {
+    std::rethrow_exception(first_error);
+  }
+
+  queue.push_back(Job{std::move(job), bytes});
+  if (queue.size() == 1) {
+    scheduler.Enqueue(shared_from_this());
+  }
+}
+
+void SSHFSUploadGroup::Wait() {
+  std::unique_lock<std::mutex> lock(scheduler.mutex);
+  done_cv.wait(lock, [this]() { return queue.empty() && running == 0; });
+}
+
+void SSHFSUploadGroup::CheckError() {
+  std::lock_guard<std::mutex> lock(scheduler.mutex);
+  if (first_error) {
+    std::rethrow_exception(first_error);
+  }
+}
+
+size_t SSHFSUploadGroup::GetPendingCount() {
+  std::lock_guard<std::mutex> lock(scheduler.mutex);
+  return queue.size() + running;
+}
+
+size_t SSHFSUploadGroup::GetBytesCompleted() {
+  std::lock_guard<std::mutex> lock(scheduler.mutex);
+  return bytes_completed;
+}
+
+SSHFSUploadScheduler::SSHFSUploadScheduler(size_t max_total,
+                                           size_t max_per_host)
+    : max_total(std::max<size_t>(1, max_total)),
+      max_per_host(std::max<size_t>(1, max_per_host)) {}
+
+SSHFSUploadScheduler::~SSHFSUploadScheduler() {
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    stopping = true;
+  }
+  work_cv.notify_all();
+  for (auto &worker : workers) {
+    if (worker.joinable()) {
+      worker.join();
+    }
+  }
+}
+
+std::shared_ptr<SSHFSUploadGroup>
+SSHFSUploadScheduler::CreateGroup(const std::string &host_key,
+                                  size_t max_pending, size_t max_parallel) {
+  return std::make_shared<SSHFSUploadGroup>(*this, host_key, max_pending,
+                                            max_parallel);
+}
+
+void SSHFSUploadScheduler::SetLimits(size_t new_max_total,
+                                     size_t new_max_per_host) {
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    max_total = std::max<size_t>(1, new_max_total);
+    max_per_host = std::max<size_t>(1, new_max_per_host);
+    if (!ready.empty()) {
+      StartWorkers();
+    }
+  }
+  work_cv.notify_all();
+}
+
+size_t SSHFSUploadScheduler::GetRunningCount() {
+  std::lock_guard<std::mutex> lock(mutex);
+  return running_total;
+}
+
+size_t SSHFSUploadScheduler::GetQueuedCount() {
+  std::lock_guard<std::mutex> lock(mutex);
+  size_t queued = 0;
+  for (auto &group : ready) {
+    queued += group->queue.size();
+  }
+  return queued;
+}
+
+void SSHFSUploadScheduler::Enqueue(
+    const std::shared_ptr<SSHFSUploadGroup> &group) {
+  ready.push_back(group);
+  StartWorkers();
+  work_cv.notify_one();
+}
+
+void SSHFSUploadScheduler::StartWorkers() {
+  // Workers only ever grow - idle ones just wait on work_cv
+  while (workers.size() < max_total) {
+    workers.emplace_back([this]() { WorkerLoop(); });
+  }
+}
+
+bool SSHFSUploadScheduler::NextJob(std::shared_ptr<SSHFSUploadGroup> &group,
+                                   SSHFSUploadGroup::Job &job) {
+  if (running_total >= max_total) {
+    return false;
+  }
+  for (auto it = ready.begin(); it != ready.end(); ++it) {
+    auto &candidate = *it;
+    if (candidate->running >= candidate->max_parallel ||
+        running_per_host[candidate->host_key] >= max_per_host) {
+      continue;
+    }
+
+    group = candidate;
+    job = std::move(group->queue.front());
+    group->queue.pop_front();
+    group->running++;
+    running_per_host[group->host_key]++;
+    running_total++;
+
+    // Round robin - a group with more queued chunks goes to the back
+    ready.erase(it);
+    if (!group->queue.empty()) {
+      ready.push_back(group);
+    }
+    return true;
+  }
+  return false;
+}
+
+void SSHFSUploadScheduler::WorkerLoop() {
+  std::unique_lock<std::mutex> lock(mutex);
+  while (true) {
+    std::shared_ptr<SSHFSUploadGroup> group;
+    SSHFSUploadGroup::Job job;
+    work_cv.wait(lock, [&]() {
+      return NextJob(group, job) || (stopping && ready.empty());
+    });
+    if (!group) {
+      return;
+    }
+
+    lock.unlock();
+    std::exception_ptr error;
+    try {
+      job.run();
+    } catch (...) {
+      error = std::current_exception();
+    }
+    // Release the job's captures (chunk data) before taking the lock
+    job.run = nullptr;
+    lock.lock();
+
+    group->running--;
+    running_per_host[group->host_key]--;
+    running_total--;
+    if (error) {
+      SSHFS_LOG("  [UPLOAD] Chunk upload to " << group->host_key
+                                              << " failed, dropping "
+                                              << group->queue.size()
+                                              << " queued chunks");
+      if (!group->first_error) {
+        group->first_error = error;
+      }
+      // Later chunks would leave a hole in the file - don't send them
+      if (!group->queue.empty()) {
+        group->queue.clear();
+        ready.erase(std::remove(ready.begin(), ready.end(), group),
+                    ready.end());
+      }
+    } else {
+      group->bytes_completed += job.bytes;
+    }
+    group->done_cv.notify_all();
+    // A slot opened up - another group (or this one) may be runnable now
+    work_cv.notify_all();
+  }
+}
+
+} // namespace duckdb